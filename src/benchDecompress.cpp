@@ -0,0 +1,234 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ *  Compares parsing a gzip compressed GDSII file directly, with inflation
+ *  running on its own thread, against the usual route of decompressing to
+ *  disk first and parsing the result.  The input is scaled up by repeating
+ *  its structures so the timings are not dominated by start-up costs.
+ *
+ *      ./benchDecompress ../testData/Lumerical/GDS_GC_Ring.gds 400
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "benchCommon.h"
+#include "gdsBasicFileParser.h"
+
+using namespace std;
+using namespace gdsfp;
+
+static int readFile(const char *filePath, vector<unsigned char> *data)
+{
+    FILE *file = fopen(filePath, "rb");
+
+    if(file==NULL) {
+        return 1;
+    }
+
+    unsigned char block[65536];
+    size_t got;
+
+    while((got = fread(block, 1, sizeof(block), file))>0) {
+        data->insert(data->end(), block, block + got);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+// Repeats everything between the library header and ENDLIB.
+static int scale(const vector<unsigned char> &input, int copies,
+                 vector<unsigned char> *output)
+{
+    gdsRecordReader reader;
+    gdsRecord record;
+    unsigned long long first = 0, last = 0;
+    reader.open(&input[0], input.size());
+
+    while(reader.next(&record)>0) {
+        if(record.recordType==BGNSTR && first==0) {
+            first = record.offset;
+        } else if(record.recordType==ENDLIB) {
+            last = record.offset;
+        }
+    }
+
+    if(first==0 || last<first) {
+        return 1;
+    }
+
+    output->assign(input.begin(), input.begin() + first);
+
+    for(int i=0; i<copies; ++i) {
+        output->insert(output->end(), input.begin() + first,
+                       input.begin() + last);
+    }
+
+    output->insert(output->end(), input.begin() + last, input.end());
+    return 0;
+}
+
+static int writeFile(const char *filePath, const vector<unsigned char> &data)
+{
+    FILE *file = fopen(filePath, "wb");
+
+    if(file==NULL) {
+        return 1;
+    }
+
+    size_t written = fwrite(&data[0], 1, data.size(), file);
+    fclose(file);
+    return written==data.size() ? 0 : 1;
+}
+
+static int writeGzip(const char *filePath, const vector<unsigned char> &data)
+{
+    gzFile file = gzopen(filePath, "wb6");
+
+    if(file==NULL) {
+        return 1;
+    }
+
+    int written = gzwrite(file, &data[0], data.size());
+    gzclose(file);
+    return written==(int)data.size() ? 0 : 1;
+}
+
+static int inflateToDisk(const char *from, const char *to)
+{
+    gzFile input = gzopen(from, "rb");
+    FILE *output = fopen(to, "wb");
+
+    if(input==NULL || output==NULL) {
+        return 1;
+    }
+
+    gzbuffer(input, 256<<10);
+    vector<unsigned char> block(1<<20);
+    int got;
+
+    while((got = gzread(input, &block[0], block.size()))>0) {
+        fwrite(&block[0], 1, got, output);
+    }
+
+    gzclose(input);
+    fclose(output);
+    return got<0 ? 1 : 0;
+}
+
+// Creates an empty file with a unique name, so that benchmarks can run
+// side by side.
+static int makeTemporary(const char *tmp, string *path)
+{
+    *path = string(tmp) + "/benchDecompressXXXXXX";
+    int fd = mkstemp(&(*path)[0]);
+
+    if(fd<0) {
+        path->clear();
+        return 1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static void removeTemporaries(const string &plainPath,
+                              const string &gzipPath,
+                              const string &inflatedPath)
+{
+    const string *paths[3] = { &plainPath, &gzipPath, &inflatedPath };
+
+    for(int i=0; i<3; ++i) {
+        if(!paths[i]->empty()) {
+            unlink(paths[i]->c_str());
+        }
+    }
+}
+
+static void report(const char *name, double elapsed, size_t bytes,
+                   unsigned long long points)
+{
+    printf("%-28s %8.3f s %9.1f MB/s  %llu points\n", name, elapsed,
+           bytes / elapsed / 1e6, points);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<2) {
+        cerr << "Usage: ./benchDecompress /path/to/file.gds [copies]" << endl;
+        return 1;
+    }
+
+    int copies = argc>2 ? atoi(argv[2]) : 200;
+    vector<unsigned char> input, scaled;
+
+    if(readFile(argv[1], &input)!=0 || input.empty() ||
+       scale(input, copies, &scaled)!=0) {
+        cerr << "Error: something is wrong with the file." << endl;
+        return 1;
+    }
+
+    const char *tmp = getenv("TMPDIR")!=NULL ? getenv("TMPDIR") : "/tmp";
+    string plainPath, gzipPath, inflatedPath;
+
+    if(makeTemporary(tmp, &plainPath)!=0 ||
+       makeTemporary(tmp, &gzipPath)!=0 ||
+       makeTemporary(tmp, &inflatedPath)!=0 ||
+       writeFile(plainPath.c_str(), scaled)!=0 ||
+       writeGzip(gzipPath.c_str(), scaled)!=0) {
+        cerr << "Error: cannot write to " << tmp << "." << endl;
+        removeTemporaries(plainPath, gzipPath, inflatedPath);
+        return 1;
+    }
+
+    printf("%zu bytes scaled x%d\n", scaled.size(), copies);
+
+    pointCounter plain;
+    double start = seconds();
+    int status = plain.parse(plainPath.c_str());
+    report("uncompressed", seconds() - start, scaled.size(), plain.points);
+
+    pointCounter direct;
+    start = seconds();
+    status |= direct.parse(gzipPath.c_str());
+    report("gzip, pipelined", seconds() - start, scaled.size(),
+           direct.points);
+
+    pointCounter staged;
+    start = seconds();
+    status |= inflateToDisk(gzipPath.c_str(), inflatedPath.c_str());
+    status |= staged.parse(inflatedPath.c_str());
+    report("gzip, inflate to disk first", seconds() - start, scaled.size(),
+           staged.points);
+
+    removeTemporaries(plainPath, gzipPath, inflatedPath);
+    return status;
+}
@@ -0,0 +1,636 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ *  Parser throughput benchmark.  Writes a deterministic synthetic library
+ *  of the requested shape and size, then parses it and any given files
+ *  with a handler whose callbacks do nothing.  Reports MB/s and records/s
+ *  of the best of several full parses, and the time spent per record type
+ *  from a second pass that feeds the records one at a time.
+ *
+ *      ./benchParser --size 512 --json bench.json ../testData/juspertor/test.gds
+ */
+
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "benchCommon.h"
+#include "gdsBasicFileParser.h"
+#include "gdsFileWriter.h"
+
+using namespace std;
+using namespace gdsfp;
+
+class noOpParser : public basic_gdsFileParser<noOpParser>
+{
+public:
+    void onParsedGDSVersion(unsigned short version) {};
+    void onParsedModTime(short year, short month, short day, short hour,
+                         short minute, short sec) {};
+    void onParsedAccessTime(short year, short month, short day, short hour,
+                            short minute, short sec) {};
+    void onParsedLibName(const char *libName) {};
+    void onParsedUnits(double userUnits, double databaseUnits) {};
+    void onParsedStrName(const char *strName) {};
+    void onParsedBoundaryStart() {};
+    void onParsedPathStart() {};
+    void onParsedBoxStart() {};
+    void onParsedEndElement() {};
+    void onParsedEndStructure() {};
+    void onParsedEndLib() {};
+    void onParsedColumnsRows(unsigned short columns, unsigned short rows) {};
+    void onParsedPathType(unsigned short pathType) {};
+    void onParsedStrans(short strans) {};
+    void onParsedPresentation(short font, short valign, short halign) {};
+    void onParsedNodeStart() {};
+    void onParsedTextStart() {};
+    void onParsedSrefStart() {};
+    void onParsedArefStart() {};
+    void onParsedSname(const char *sname) {};
+    void onParsedString(const char *str) {};
+    void onParsedPropValue(const char *propValue) {};
+    void onParsedXY(int count, int x[], int y[]) {};
+    void onParsedLayer(unsigned short layer) {};
+    void onParsedWidth(int width) {};
+    void onParsedDataType(unsigned short dataType) {};
+    void onParsedTextType(unsigned short textType) {};
+    void onParsedAngle(double angle) {};
+    void onParsedMag(double mag) {};
+    void onParsedBeginExtension(unsigned short bext) {};
+    void onParsedEndExtension(unsigned short eext) {};
+    void onParsedPropertyNumber(unsigned short propNum) {};
+    void onParsedNodeType(unsigned short nodeType) {};
+    void onParsedBoxType(unsigned short boxType) {};
+};
+
+struct generatorOptions {
+    unsigned int cells;             // Leaf cells, at least.
+    unsigned int depth;             // Levels of cells above the leaves.
+    unsigned int polygons;          // Per leaf cell, every 4th is a PATH.
+    unsigned int vertices;          // Per polygon.
+    unsigned int texts;             // Per leaf cell.
+    unsigned short columns;         // Of the AREF in every upper cell.
+    unsigned short rows;
+    unsigned long long size;        // More leaf cells until this many bytes.
+    unsigned long long seed;
+};
+
+static const unsigned int FANOUT = 4;
+// The AREF lattice of the upper cells, which has to fit in 32 bits.
+static const long long AREF_PITCH = 120000;
+static const long long AREF_Y = -2000000;
+// The grid of the top cell, which spans at most TOP_EXTENT on each side.
+static const long long TOP_PITCH = 4000000;
+static const long long TOP_EXTENT = 2000000000;
+
+// splitmix64, so the files are the same on every platform.
+class generatorRandom
+{
+public:
+    generatorRandom(unsigned long long seed) : state(seed) {};
+
+    unsigned int next(unsigned int range)
+    {
+        unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z>>30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z>>27)) * 0x94d049bb133111ebULL;
+        return (unsigned int)((z ^ (z>>31)) % range);
+    };
+
+private:
+    unsigned long long state;
+};
+
+static void writeLeaf(gdsFileWriter *writer, generatorRandom *random,
+                      const generatorOptions &options, unsigned int index,
+                      const vector<double> &cosines,
+                      const vector<double> &sines, const short stamp[6])
+{
+    char name[32];
+    snprintf(name, sizeof(name), "C%u", index);
+    writer->writeBeginStructure(stamp, stamp);
+    writer->writeStrName(name);
+
+    unsigned int vertices = options.vertices;
+    vector<int> x(vertices + 1), y(vertices + 1);
+
+    for(unsigned int p=0; p<options.polygons; ++p) {
+        int cx = random->next(100000), cy = random->next(100000);
+        int radius = 100 + random->next(900);
+
+        for(unsigned int v=0; v<vertices; ++v) {
+            int r = radius - (int)random->next(radius / 4 + 1);
+            x[v] = cx + (int)(r * cosines[v]);
+            y[v] = cy + (int)(r * sines[v]);
+        }
+
+        x[vertices] = x[0];
+        y[vertices] = y[0];
+
+        if(p % 4==3) {
+            writer->writePath();
+            writer->writeLayer(random->next(64));
+            writer->writeDataType(0);
+            writer->writeWidth(50);
+            writer->writeXY(vertices, &x[0], &y[0]);
+        } else {
+            writer->writeBoundary();
+            writer->writeLayer(random->next(64));
+            writer->writeDataType(random->next(4));
+            writer->writeXY(vertices + 1, &x[0], &y[0]);
+        }
+
+        writer->writeEndElement();
+    }
+
+    for(unsigned int t=0; t<options.texts; ++t) {
+        int tx = random->next(100000), ty = random->next(100000);
+        snprintf(name, sizeof(name), "NET%u_%u", index, t);
+        writer->writeText();
+        writer->writeLayer(random->next(64));
+        writer->writeTextType(0);
+        writer->writeXY(1, &tx, &ty);
+        writer->writeString(name);
+        writer->writeEndElement();
+    }
+
+    writer->writeEndStructure();
+}
+
+static void writeReference(gdsFileWriter *writer, const char *name,
+                           short strans, double angle, int count,
+                           const int x[], const int y[],
+                           unsigned short columns, unsigned short rows)
+{
+    if(count==3) {
+        writer->writeAref();
+    } else {
+        writer->writeSref();
+    }
+
+    writer->writeSname(name);
+
+    if(strans!=0 || angle!=0.0) {
+        writer->writeStrans(strans);
+
+        if(angle!=0.0) {
+            writer->writeAngle(angle);
+        }
+    }
+
+    if(count==3) {
+        writer->writeColumnsRows(columns, rows);
+    }
+
+    writer->writeXY(count, x, y);
+    writer->writeEndElement();
+}
+
+static int generate(const char *filePath, const generatorOptions &options)
+{
+    gdsFileWriter writer;
+
+    if(writer.open(filePath)!=0) {
+        return 1;
+    }
+
+    generatorRandom random(options.seed);
+    const short stamp[6] = { 2017, 6, 10, 0, 0, 0 };
+    writer.writeHeader(600);
+    writer.writeBeginLib(stamp, stamp);
+    writer.writeLibName("BENCH");
+    writer.writeUnits(0.001, 1e-9);
+
+    vector<double> cosines(options.vertices), sines(options.vertices);
+
+    for(unsigned int v=0; v<options.vertices; ++v) {
+        cosines[v] = cos(2 * M_PI * v / options.vertices);
+        sines[v] = sin(2 * M_PI * v / options.vertices);
+    }
+
+    unsigned int cells = 0;
+
+    while(cells<options.cells || writer.offset()<options.size) {
+        writeLeaf(&writer, &random, options, cells++, cosines, sines, stamp);
+    }
+
+    // Each upper cell places FANOUT cells of the level below and an AREF.
+    char name[32], child[32];
+    unsigned int below = cells;
+
+    for(unsigned int level=1; level<=options.depth; ++level) {
+        unsigned int count = (below + FANOUT - 1) / FANOUT;
+
+        for(unsigned int i=0; i<count; ++i) {
+            snprintf(name, sizeof(name), "L%u_%u", level, i);
+            writer.writeBeginStructure(stamp, stamp);
+            writer.writeStrName(name);
+
+            for(unsigned int k=0; k<FANOUT; ++k) {
+                unsigned int index = (i * FANOUT + k) % below;
+
+                if(level==1) {
+                    snprintf(child, sizeof(child), "C%u", index);
+                } else {
+                    snprintf(child, sizeof(child), "L%u_%u", level - 1, index);
+                }
+
+                int x = random.next(1000000), y = random.next(1000000);
+                writeReference(&writer, child, random.next(2) ? 0x8000 : 0,
+                               90.0 * random.next(4), 1, &x, &y, 1, 1);
+            }
+
+            if(options.columns>0 && options.rows>0) {
+                int x[3] = { 0, (int)(AREF_PITCH * options.columns), 0 };
+                int y[3] = { (int)AREF_Y, (int)AREF_Y,
+                             (int)(AREF_Y + AREF_PITCH * options.rows) };
+                writeReference(&writer, child, 0, 0.0, 3, x, y,
+                               options.columns, options.rows);
+            }
+
+            writer.writeEndStructure();
+        }
+
+        below = count;
+    }
+
+    // The top cell lays the cells below out on a square grid around the
+    // origin, with a pitch that keeps the grid within 32-bit coordinates.
+    unsigned int side = (unsigned int)ceil(sqrt((double)below));
+    long long pitch = min(TOP_PITCH, TOP_EXTENT / max(side, 1u));
+    writer.writeBeginStructure(stamp, stamp);
+    writer.writeStrName("TOP");
+
+    for(unsigned int i=0; i<below; ++i) {
+        if(options.depth==0) {
+            snprintf(child, sizeof(child), "C%u", i);
+        } else {
+            snprintf(child, sizeof(child), "L%u_%u", options.depth, i);
+        }
+
+        int x = (int)(((long long)(i % side) - side / 2) * pitch);
+        int y = (int)(((long long)(i / side) - side / 2) * pitch);
+        writeReference(&writer, child, 0, 0.0, 1, &x, &y, 1, 1);
+    }
+
+    writer.writeEndStructure();
+    writer.writeEndLib();
+    return writer.close();
+}
+
+struct typeResult {
+    unsigned long long count;
+    unsigned long long bytes;
+    double seconds;
+};
+
+struct fileResult {
+    string path;
+    unsigned long long bytes;
+    unsigned long long records;
+    unsigned int runs;
+    double seconds;                 // Best full parse.
+    typeResult types[256];
+};
+
+// Cost of one pair of clock reads, taken off every timed record.
+static double clockCost()
+{
+    const int pairs = 100000;
+    double sum = 0;
+
+    for(int i=0; i<pairs; ++i) {
+        double start = seconds();
+        sum += seconds() - start;
+    }
+
+    return sum / pairs;
+}
+
+static int benchmark(const char *filePath, unsigned int repeat,
+                     double overhead, fileResult *result)
+{
+    result->path = filePath;
+    result->bytes = result->records = 0;
+    result->runs = 0;
+    result->seconds = 0;
+    memset(result->types, 0, sizeof(result->types));
+
+    // Best of a few full parses, and of enough of them to run for a
+    // quarter of a second on small files.
+    double total = 0;
+
+    while(result->runs<repeat || total<0.25) {
+        noOpParser parser;
+        double start = seconds();
+
+        if(parser.parse(filePath)!=0) {
+            return 1;
+        }
+
+        double elapsed = seconds() - start;
+        total += elapsed;
+
+        if(result->runs==0 || elapsed<result->seconds) {
+            result->seconds = elapsed;
+        }
+
+        ++result->runs;
+    }
+
+    // Feed the records one by one and time each by its type.
+    gdsRecordReader reader;
+
+    if(reader.open(filePath)!=0) {
+        return 1;
+    }
+
+    noOpParser parser;
+    gdsRecord record;
+    vector<unsigned char> scratch(4 + 65536);
+    int status;
+
+    while((status = reader.next(&record))>0) {
+        unsigned int length = 4 + record.length;
+        scratch[0] = length>>8;
+        scratch[1] = length;
+        scratch[2] = record.recordType;
+        scratch[3] = record.dataType;
+        memcpy(&scratch[4], record.data, record.length);
+
+        double start = seconds();
+        parser.feed(&scratch[0], length);
+        double elapsed = seconds() - start - overhead;
+
+        typeResult &type = result->types[record.recordType];
+        ++type.count;
+        type.bytes += length;
+        type.seconds += elapsed>0 ? elapsed : 0;
+        result->bytes += length;
+        ++result->records;
+    }
+
+    parser.finish();
+    reader.close();
+    return status<0 ? 1 : 0;
+}
+
+static void printResult(const fileResult &result)
+{
+    printf("%s\n", result.path.c_str());
+    printf("    %llu bytes, %llu records, best of %u: %.6f s, %.1f MB/s,"
+           " %.2f Mrecords/s\n", result.bytes, result.records, result.runs,
+           result.seconds, result.bytes / result.seconds / 1e6,
+           result.records / result.seconds / 1e6);
+
+    for(int t=0; t<256; ++t) {
+        const typeResult &type = result.types[t];
+
+        if(type.count>0) {
+            const char *name = recordTypeName(t);
+            printf("    %-12s %10llu records %12llu bytes %9.1f ns/record\n",
+                   name!=NULL ? name : "?", type.count, type.bytes,
+                   type.seconds / type.count * 1e9);
+        }
+    }
+}
+
+static void jsonString(FILE *out, const string &text)
+{
+    fputc('"', out);
+
+    for(size_t i=0; i<text.size(); ++i) {
+        unsigned char c = text[i];
+
+        if(c=='"' || c=='\\') {
+            fprintf(out, "\\%c", c);
+        } else if(c<0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+static int writeJson(const char *filePath, const vector<fileResult> &results)
+{
+    bool useStdout = strcmp(filePath, "-")==0;
+    FILE *out = useStdout ? stdout : fopen(filePath, "w");
+
+    if(out==NULL) {
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"files\": [");
+
+    for(size_t i=0; i<results.size(); ++i) {
+        const fileResult &result = results[i];
+        fprintf(out, "%s\n    {\n      \"path\": ", i>0 ? "," : "");
+        jsonString(out, result.path);
+        fprintf(out, ",\n      \"bytes\": %llu,\n      \"records\": %llu,\n"
+                "      \"runs\": %u,\n      \"seconds\": %.6f,\n"
+                "      \"megabytesPerSecond\": %.3f,\n"
+                "      \"recordsPerSecond\": %.0f,\n      \"types\": {",
+                result.bytes, result.records, result.runs, result.seconds,
+                result.bytes / result.seconds / 1e6,
+                result.records / result.seconds);
+        bool first = true;
+
+        for(int t=0; t<256; ++t) {
+            const typeResult &type = result.types[t];
+
+            if(type.count>0) {
+                const char *name = recordTypeName(t);
+                fprintf(out, "%s\n        ", first ? "" : ",");
+
+                if(name!=NULL) {
+                    fprintf(out, "\"%s\"", name);
+                } else {
+                    fprintf(out, "\"0x%02x\"", t);
+                }
+
+                fprintf(out, ": { \"count\": %llu, \"bytes\": %llu,"
+                        " \"seconds\": %.6f }", type.count, type.bytes,
+                        type.seconds);
+                first = false;
+            }
+        }
+
+        fprintf(out, "\n      }\n    }");
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    int status = ferror(out) ? 1 : 0;
+
+    if(!useStdout) {
+        status |= fclose(out)!=0 ? 1 : 0;
+    }
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    generatorOptions options = { 1000, 3, 20, 8, 2, 10, 10, 64ULL<<20, 1 };
+    const char *generated = NULL;
+    const char *json = NULL;
+    bool generating = true;
+    unsigned int repeat = 3;
+    vector<const char *> files;
+
+    for(int i=1; i<argc; ++i) {
+        if(strcmp(argv[i], "--no-generate")==0) {
+            generating = false;
+        } else if(argv[i][0]!='-' || argv[i][1]!='-') {
+            files.push_back(argv[i]);
+        } else if(i + 1==argc) {
+            cerr << "Error: " << argv[i] << " needs a value." << endl;
+            return 1;
+        } else if(strcmp(argv[i], "--generate")==0) {
+            generated = argv[++i];
+        } else if(strcmp(argv[i], "--json")==0) {
+            json = argv[++i];
+        } else if(strcmp(argv[i], "--repeat")==0) {
+            repeat = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--size")==0) {
+            options.size = strtoull(argv[++i], NULL, 10)<<20;
+        } else if(strcmp(argv[i], "--cells")==0) {
+            options.cells = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--depth")==0) {
+            options.depth = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--polygons")==0) {
+            options.polygons = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--vertices")==0) {
+            options.vertices = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--texts")==0) {
+            options.texts = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--seed")==0) {
+            options.seed = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--aref")==0) {
+            unsigned int columns, rows;
+
+            if(sscanf(argv[++i], "%ux%u", &columns, &rows)!=2 ||
+               columns>32767 || rows>32767) {
+                cerr << "Error: bad AREF size " << argv[i] << endl;
+                return 1;
+            }
+
+            if(AREF_PITCH * columns>INT_MAX ||
+               AREF_Y + AREF_PITCH * rows>INT_MAX) {
+                cerr << "Error: an AREF of " << argv[i] << " does not fit in"
+                        " 32-bit coordinates." << endl;
+                return 1;
+            }
+
+            options.columns = columns;
+            options.rows = rows;
+        } else {
+            cerr << "Usage: ./benchParser [--generate OUT] [--no-generate]"
+                    " [--size MB] [--cells N] [--depth N] [--polygons N]"
+                    " [--vertices N] [--texts N] [--aref CxR] [--seed N]"
+                    " [--repeat N] [--json FILE] [file.gds ...]" << endl;
+            return 1;
+        }
+    }
+
+    if(options.vertices<3 || options.vertices>8190) {
+        cerr << "Error: polygons need 3 to 8190 vertices." << endl;
+        return 1;
+    }
+
+    string generatedPath;
+
+    if(generating) {
+        if(generated!=NULL) {
+            generatedPath = generated;
+        } else {
+            // A unique name, so that benchmarks can run side by side.
+            const char *tmp = getenv("TMPDIR")!=NULL ? getenv("TMPDIR")
+                                                     : "/tmp";
+            generatedPath = string(tmp) + "/benchParserXXXXXX";
+            int fd = mkstemp(&generatedPath[0]);
+
+            if(fd<0) {
+                cerr << "Error: cannot create " << generatedPath << endl;
+                return 1;
+            }
+
+            close(fd);
+        }
+
+        double start = seconds();
+
+        if(generate(generatedPath.c_str(), options)!=0) {
+            cerr << "Error: cannot write " << generatedPath << endl;
+
+            if(generated==NULL) {
+                unlink(generatedPath.c_str());
+            }
+
+            return 1;
+        }
+
+        printf("Generated %s in %.2f s\n", generatedPath.c_str(),
+               seconds() - start);
+        files.insert(files.begin(), generatedPath.c_str());
+    }
+
+    double overhead = clockCost();
+    vector<fileResult> results;
+    int status = 0;
+
+    for(size_t i=0; i<files.size(); ++i) {
+        results.push_back(fileResult());
+
+        if(benchmark(files[i], repeat, overhead, &results.back())!=0) {
+            cerr << "Error: cannot parse " << files[i] << endl;
+            results.pop_back();
+            status = 1;
+            continue;
+        }
+
+        printResult(results.back());
+    }
+
+    if(json!=NULL && writeJson(json, results)!=0) {
+        cerr << "Error: cannot write " << json << endl;
+        status = 1;
+    }
+
+    if(generating && generated==NULL) {
+        unlink(generatedPath.c_str());
+    }
+
+    return status;
+}
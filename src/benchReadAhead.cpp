@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ *  Compares reading a GDSII file cold, straight from the storage, through
+ *  the memory mapping parse() uses by default against read-ahead with a
+ *  reader thread, with io_uring and with O_DIRECT.  The file's pages are
+ *  dropped from the page cache before every run with posix_fadvise(), so
+ *  use a file that is larger than what the disk cache in front of it holds.
+ *
+ *      ./benchReadAhead --block 8 --repeat 3 /data/chip.gds
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "benchCommon.h"
+#include "gdsBasicFileParser.h"
+
+using namespace std;
+using namespace gdsfp;
+
+// Evicts the file from the page cache.  Only clean pages go, so it is
+// synced first.
+static int dropCache(const char *filePath)
+{
+    int fd = open(filePath, O_RDONLY);
+
+    if(fd<0) {
+        return 1;
+    }
+
+    fdatasync(fd);
+    int status = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return status!=0;
+}
+
+struct readMode {
+    const char *name;
+    bool readAhead;
+    bool uring;
+    bool direct;
+};
+
+int main(int argc, char *argv[])
+{
+    const char *filePath = NULL;
+    size_t blockSize = gdsReadAhead::DEFAULT_BLOCK_SIZE;
+    unsigned int repeat = 3;
+    bool cold = true;
+
+    for(int i=1; i<argc; ++i) {
+        if(strcmp(argv[i], "--warm")==0) {
+            cold = false;
+        } else if(strcmp(argv[i], "--block")==0 && i + 1<argc) {
+            blockSize = strtoull(argv[++i], NULL, 10)<<20;
+        } else if(strcmp(argv[i], "--repeat")==0 && i + 1<argc) {
+            repeat = atoi(argv[++i]);
+        } else if(argv[i][0]!='-') {
+            filePath = argv[i];
+        } else {
+            filePath = NULL;
+            break;
+        }
+    }
+
+    if(filePath==NULL || repeat==0) {
+        cerr << "Usage: ./benchReadAhead [--block MB] [--repeat N] [--warm]"
+                " file.gds" << endl;
+        return 1;
+    }
+
+    // Learn what this kernel and file system allow before timing anything.
+    gdsReadAhead probe;
+
+    if(probe.open(filePath, blockSize, true)!=0) {
+        cerr << "Error: cannot open " << filePath << endl;
+        return 1;
+    }
+
+    bool haveUring = probe.method()==GDS_READ_URING;
+    bool haveDirect = probe.isDirect();
+    probe.close();
+
+    const readMode modes[] = {
+        { "mmap", false, false, false },
+        { "thread", true, false, false },
+        { "thread+direct", true, false, true },
+        { "io_uring", true, true, false },
+        { "io_uring+direct", true, true, true }
+    };
+
+    printf("%s, %zu MB blocks, %s cache, io_uring %s, O_DIRECT %s\n",
+           filePath, blockSize>>20, cold ? "cold" : "warm",
+           haveUring ? "available" : "not available",
+           haveDirect ? "available" : "not available");
+
+    for(size_t m=0; m<sizeof(modes) / sizeof(modes[0]); ++m) {
+        const readMode &mode = modes[m];
+
+        if((mode.uring && !haveUring) || (mode.direct && !haveDirect)) {
+            continue;
+        }
+
+        gdsReadAhead::allowUring(mode.uring);
+        double best = 0;
+        double total = 0;
+        unsigned long long points = 0;
+
+        for(unsigned int r=0; r<repeat; ++r) {
+            if(cold && dropCache(filePath)!=0) {
+                cerr << "Error: cannot drop " << filePath
+                     << " from the page cache." << endl;
+                return 1;
+            }
+
+            pointCounter parser;
+
+            if(mode.readAhead) {
+                parser.enableReadAhead(blockSize, mode.direct);
+            }
+
+            double start = seconds();
+
+            if(parser.parse(filePath)!=0) {
+                return 1;
+            }
+
+            double elapsed = seconds() - start;
+            total += elapsed;
+            best = r==0 || elapsed<best ? elapsed : best;
+            points = parser.points;
+        }
+
+        off_t size = 0;
+        int fd = open(filePath, O_RDONLY);
+
+        if(fd>=0) {
+            size = lseek(fd, 0, SEEK_END);
+            close(fd);
+        }
+
+        printf("    %-16s best %.3f s, mean %.3f s, %.1f MB/s, %llu points\n",
+               mode.name, best, total / repeat, size / best / 1e6, points);
+    }
+
+    gdsReadAhead::allowUring(true);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ *  Checks decodeReal8() and decodeReal8Array() bit for bit against the
+ *  loop over the fraction bytes with pow() that the parser used before,
+ *  and against an exact long double reference.  Every exponent is tried
+ *  with both signs and a spread of random fractions, along with the zero
+ *  and extreme fractions.  Each decoded value must also come back the
+ *  same through encodeReal8().  Then all three decoders are timed on the
+ *  same values, unless only the check is asked for.
+ *
+ *      ./benchReal8 [--check]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "benchCommon.h"
+#include "gdsReal8.h"
+
+using namespace std;
+using namespace gdsfp;
+
+// The decoder that gdsFileParser had before decodeReal8().
+static double oldDecodeReal8(const unsigned char *p)
+{
+    static const unsigned long p_256[8] = { 0x1, 0x100, 0x10000, 0x1000000,
+                                            0x100000000, 0x10000000000,
+                                            0x1000000000000,
+                                            0x100000000000000 };
+    short neg = 1;
+    int exp = 0;
+    double man = 0.0;
+
+    if(p[0]>127) {
+        neg = -1;
+        exp = p[0] - 192;
+    } else {
+        exp = p[0] - 64;
+    }
+
+    for(int i=1; i<8; ++i) {
+        man+=(double)p[i]/(double)p_256[i];
+    }
+
+    return man * pow(16, exp) * neg;
+}
+
+// The 56 bit fraction is exact in a long double with a 64 bit
+// significand, so only the final conversion rounds.
+static double exactReal8(const unsigned char *p)
+{
+    uint64_t fraction = 0;
+
+    for(int i=1; i<8; ++i) {
+        fraction = (fraction<<8) | p[i];
+    }
+
+    long double value = ldexpl((long double)fraction,
+                               4 * ((p[0] & 0x7f) - 64) - 56);
+    return (double)((p[0] & 0x80) ? -value : value);
+}
+
+static bool sameBits(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double))==0;
+}
+
+// Nanoseconds per value of the best of a few passes over all of them.
+template<class Decode>
+static double timeDecoder(const vector<unsigned char> &words, Decode decode,
+                          double *sum)
+{
+    size_t count = words.size() / 8;
+    double best = HUGE_VAL;
+
+    for(int pass=0; pass<5; ++pass) {
+        double start = seconds();
+        *sum += decode(words.data(), count);
+        best = min(best, seconds() - start);
+    }
+
+    return best * 1e9 / count;
+}
+
+int main(int argc, char *argv[])
+{
+    bool checkOnly = argc>1 && strcmp(argv[1], "--check")==0;
+
+    const unsigned int FRACTIONS = 4096;
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    vector<unsigned char> words;
+
+    for(unsigned int head=0; head<256; ++head) {
+        for(unsigned int f=0; f<FRACTIONS; ++f) {
+            uint64_t fraction;
+
+            if(f==0) {
+                fraction = 0;
+            } else if(f==1) {
+                fraction = 0x00ffffffffffffffULL;
+            } else if(f==2) {
+                fraction = 1;
+            } else {
+                state ^= state<<13;
+                state ^= state>>7;
+                state ^= state<<17;
+                // Also fractions with leading zero digits, which are not
+                // normalized.
+                fraction = (state & 0x00ffffffffffffffULL)>>(4 * (f % 14));
+            }
+
+            unsigned char word[8];
+            word[0] = head;
+
+            for(int i=7; i>=1; --i, fraction>>=8) {
+                word[i] = fraction & 0xff;
+            }
+
+            words.insert(words.end(), word, word + 8);
+        }
+    }
+
+    size_t count = words.size() / 8;
+    vector<double> decoded(count);
+    decodeReal8Array(words.data(), decoded.data(), count);
+    size_t failures = 0;
+
+    for(size_t i=0; i<count; ++i) {
+        const unsigned char *word = &words[i * 8];
+        double value = decodeReal8(word);
+        double old = oldDecodeReal8(word);
+        double exact = exactReal8(word);
+        bool ok = sameBits(value, exact) && sameBits(value, decoded[i]) &&
+                  sameBits(value, old);
+
+        // The decoded double must survive a round trip, although the
+        // word it comes back as may differ in the digits that rounded away.
+        if(ok) {
+            unsigned char again[8];
+            encodeReal8(value, again);
+            ok = sameBits(decodeReal8(again), value);
+        }
+
+        if(!ok && failures++<10) {
+            printf("Mismatch for %02x%02x%02x%02x%02x%02x%02x%02x: "
+                   "%.17g, old %.17g, exact %.17g\n", word[0], word[1],
+                   word[2], word[3], word[4], word[5], word[6], word[7],
+                   value, old, exact);
+        }
+    }
+
+    printf("%zu REAL_8 values, %zu mismatches\n", count, failures);
+
+    if(failures>0 || checkOnly) {
+        return failures==0 ? 0 : 1;
+    }
+
+    // The sum, printed at the end, keeps the conversions from being
+    // optimized away.
+    double sum = 0.0;
+    double old = timeDecoder(words, [](const unsigned char *p, size_t n) {
+        double total = 0.0;
+
+        for(size_t i=0; i<n; ++i) {
+            total += oldDecodeReal8(p + i * 8);
+        }
+
+        return total;
+    }, &sum);
+    double single = timeDecoder(words, [](const unsigned char *p, size_t n) {
+        double total = 0.0;
+
+        for(size_t i=0; i<n; ++i) {
+            total += decodeReal8(p + i * 8);
+        }
+
+        return total;
+    }, &sum);
+    double batch = timeDecoder(words, [&](const unsigned char *p, size_t n) {
+        decodeReal8Array(p, decoded.data(), n);
+        return decoded[n - 1];
+    }, &sum);
+
+    printf("    pow() loop         %.2f ns/value\n", old);
+    printf("    decodeReal8        %.2f ns/value\n", single);
+    printf("    decodeReal8Array   %.2f ns/value\n", batch);
+    printf("    checksum           %g\n", sum);
+    return 0;
+}
@@ -0,0 +1,465 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*
+ *  Round trip of PATH extensions, which are signed 32-bit values: a small
+ *  library of pathtype 4 paths is copied with gdsFileRewriter, loaded
+ *  into a gdsLibrary and written back, and parsed on two threads, and
+ *  every route must keep the extensions it was written with.  A small
+ *  hierarchy with a cycle must have every structure on the cycle marked
+ *  cyclic by gdsStructureHasher.  Every file given on the command line is
+ *  then copied with gdsFileRewriter, and the copy, and the replay of a
+ *  snapshot of the file, must fire the same callbacks with the same values
+ *  as the file.  Its library written on four threads must fire the
+ *  callbacks of the library written on one.
+ *
+ *      make check
+ *      ./checkRoundTrip ../testData/juspertor/test.gds
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "gdsFileWriter.h"
+#include "gdsLibrary.h"
+#include "gdsParallelParser.h"
+#include "gdsSnapshot.h"
+#include "gdsStructureHash.h"
+
+using namespace std;
+using namespace gdsfp;
+
+static const int EXTENSIONS[][2] = {
+    { -100, 70000 }, { 70000, -100 }, { -70000, 65535 }, { 65536, -1 },
+    { 2147483647, -2147483647 - 1 }, { 1, 2 }
+};
+static const size_t PATHS = sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]);
+
+static void writePaths(gdsFileWriter *writer)
+{
+    const short stamp[6] = { 2017, 6, 10, 0, 0, 0 };
+    writer->writeHeader(600);
+    writer->writeBeginLib(stamp, stamp);
+    writer->writeLibName("EXTENSIONS");
+    writer->writeUnits(0.001, 1e-9);
+    writer->writeBeginStructure(stamp, stamp);
+    writer->writeStrName("TOP");
+
+    for(size_t i=0; i<PATHS; ++i) {
+        int x[2] = { 0, 1000 }, y[2] = { (int)i * 100, (int)i * 100 };
+        writer->writePath();
+        writer->writeLayer(1);
+        writer->writeDataType(0);
+        writer->writePathType(4);
+        writer->writeWidth(10);
+        writer->writeBeginExtension(EXTENSIONS[i][0]);
+        writer->writeEndExtension(EXTENSIONS[i][1]);
+        writer->writeXY(2, x, y);
+        writer->writeEndElement();
+    }
+
+    writer->writeEndStructure();
+    writer->writeEndLib();
+}
+
+// The extensions of the paths of the library must be the written ones.
+static int checkLibrary(const gdsLibrary &library, const char *route)
+{
+    int failures = 0;
+    uint32_t layer = library.findLayer(1);
+
+    if(layer==GDS_NONE || library.layers()[layer].shapes.length()!=PATHS) {
+        printf("%s: the paths are missing\n", route);
+        return 1;
+    }
+
+    const gdsLayer &paths = library.layers()[layer];
+
+    for(uint32_t i=0; i<PATHS; ++i) {
+        const gdsShape &shape = paths.shapes[i];
+
+        if(shape.beginExtension!=EXTENSIONS[i][0] ||
+           shape.endExtension!=EXTENSIONS[i][1]) {
+            printf("%s: path %u has extensions %d and %d instead of %d and "
+                   "%d\n", route, i, shape.beginExtension,
+                   shape.endExtension, EXTENSIONS[i][0], EXTENSIONS[i][1]);
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+// Structures on a cycle, however they join it, are marked cyclic: R and A
+// reference each other, and B closes R -> B -> A -> R through A, which is
+// finished before B is reached.  TOP only references the cycle.
+static int checkCycles()
+{
+    const short stamp[6] = { 2017, 6, 10, 0, 0, 0 };
+    const char *cells[][3] = {
+        { "R", "A", "B" }, { "A", "R", NULL }, { "B", "A", NULL },
+        { "TOP", "R", NULL }
+    };
+    gdsFileWriter writer;
+    writer.writeHeader(600);
+    writer.writeBeginLib(stamp, stamp);
+    writer.writeLibName("CYCLES");
+    writer.writeUnits(0.001, 1e-9);
+
+    for(size_t i=0; i<sizeof(cells) / sizeof(cells[0]); ++i) {
+        writer.writeBeginStructure(stamp, stamp);
+        writer.writeStrName(cells[i][0]);
+
+        for(int r=1; r<3 && cells[i][r]!=NULL; ++r) {
+            int x = 0, y = 0;
+            writer.writeSref();
+            writer.writeSname(cells[i][r]);
+            writer.writeXY(1, &x, &y);
+            writer.writeEndElement();
+        }
+
+        writer.writeEndStructure();
+    }
+
+    writer.writeEndLib();
+    gdsStructureHasher hasher;
+
+    if(hasher.hash(writer.data(), writer.size())!=0) {
+        printf("cycles: cannot hash the library\n");
+        return 1;
+    }
+
+    int failures = 0;
+
+    for(size_t i=0; i<sizeof(cells) / sizeof(cells[0]); ++i) {
+        const gdsStructureHash *hash = hasher.find(cells[i][0]);
+        bool cyclic = strcmp(cells[i][0], "TOP")!=0;
+
+        if(hash==NULL || hash->cyclic!=cyclic) {
+            printf("cycles: %s is %s\n", cells[i][0],
+                   cyclic ? "not marked cyclic" : "marked cyclic");
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+// Every callback with its values, one per line.
+class gdsTranscript : public gdsFileParser
+{
+public:
+    // Without times the MODTIME and ACCTIME lines are left out.
+    gdsTranscript(bool times = true) : times(times) {};
+
+    string text;
+
+protected:
+    void add(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char line[256];
+        va_list arguments;
+        va_start(arguments, format);
+        vsnprintf(line, sizeof(line), format, arguments);
+        va_end(arguments);
+        text += line;
+        text += '\n';
+    };
+
+    void addTime(const char *what, short year, short month, short day,
+                 short hour, short minute, short sec)
+    {
+        if(!times) {
+            return;
+        }
+
+        add("%s %d-%d-%d %d:%d:%d", what, year, month, day, hour, minute,
+            sec);
+    };
+
+    void onParsedGDSVersion(unsigned short version)
+    {
+        add("HEADER %u", version);
+    };
+    void onParsedModTime(short year, short month, short day, short hour,
+                         short minute, short sec)
+    {
+        addTime("MODTIME", year, month, day, hour, minute, sec);
+    };
+    void onParsedAccessTime(short year, short month, short day, short hour,
+                            short minute, short sec)
+    {
+        addTime("ACCTIME", year, month, day, hour, minute, sec);
+    };
+    void onParsedLibName(const char *libName)
+    {
+        add("LIBNAME %s", libName);
+    };
+    void onParsedUnits(double userUnits, double databaseUnits)
+    {
+        add("UNITS %.17g %.17g", userUnits, databaseUnits);
+    };
+    void onParsedStrName(const char *strName) { add("STRNAME %s", strName); };
+    void onParsedBoundaryStart() { add("BOUNDARY"); };
+    void onParsedPathStart() { add("PATH"); };
+    void onParsedBoxStart() { add("BOX"); };
+    void onParsedEndElement() { add("ENDEL"); };
+    void onParsedEndStructure() { add("ENDSTR"); };
+    void onParsedEndLib() { add("ENDLIB"); };
+    void onParsedColumnsRows(unsigned short columns, unsigned short rows)
+    {
+        add("COLROW %u %u", columns, rows);
+    };
+    void onParsedPathType(unsigned short pathType)
+    {
+        add("PATHTYPE %u", pathType);
+    };
+    void onParsedStrans(short strans) { add("STRANS %d", strans); };
+    void onParsedPresentation(short font, short valign, short halign)
+    {
+        add("PRESENTATION %d %d %d", font, valign, halign);
+    };
+    void onParsedNodeStart() { add("NODE"); };
+    void onParsedTextStart() { add("TEXT"); };
+    void onParsedSrefStart() { add("SREF"); };
+    void onParsedArefStart() { add("AREF"); };
+    void onParsedSname(const char *sname) { add("SNAME %s", sname); };
+    void onParsedString(const char *str) { add("STRING %s", str); };
+    void onParsedPropValue(const char *propValue)
+    {
+        add("PROPVALUE %s", propValue);
+    };
+    void onParsedXY(int count, int x[], int y[])
+    {
+        add("XY %d", count);
+
+        for(int i=0; i<count; ++i) {
+            add("  %d %d", x[i], y[i]);
+        }
+    };
+    void onParsedLayer(unsigned short layer) { add("LAYER %u", layer); };
+    void onParsedWidth(int width) { add("WIDTH %d", width); };
+    void onParsedDataType(unsigned short dataType)
+    {
+        add("DATATYPE %u", dataType);
+    };
+    void onParsedTextType(unsigned short textType)
+    {
+        add("TEXTTYPE %u", textType);
+    };
+    void onParsedAngle(double angle) { add("ANGLE %.17g", angle); };
+    void onParsedMag(double mag) { add("MAG %.17g", mag); };
+    void onParsedBeginExtension(unsigned short bext) {};
+    void onParsedEndExtension(unsigned short eext) {};
+    void onParsedBeginExtension32(int bext) { add("BGNEXTN %d", bext); };
+    void onParsedEndExtension32(int eext) { add("ENDEXTN %d", eext); };
+    void onParsedPropertyNumber(unsigned short propNum)
+    {
+        add("PROPATTR %u", propNum);
+    };
+    void onParsedNodeType(unsigned short nodeType)
+    {
+        add("NODETYPE %u", nodeType);
+    };
+    void onParsedBoxType(unsigned short boxType)
+    {
+        add("BOXTYPE %u", boxType);
+    };
+
+private:
+    bool times;
+};
+
+// A copy of the file must fire the callbacks of the file.
+static int compareTranscripts(const char *filePath, const char *route,
+                              const gdsTranscript &original,
+                              const gdsTranscript &copied)
+{
+    if(copied.text==original.text) {
+        return 0;
+    }
+
+    size_t line = 1;
+
+    for(size_t i=0; i<original.text.size() && i<copied.text.size() &&
+        original.text[i]==copied.text[i]; ++i) {
+        line += original.text[i]=='\n';
+    }
+
+    printf("%s: the %s differs at callback line %zu\n", filePath, route,
+           line);
+    return 1;
+}
+
+static int checkFile(const char *filePath)
+{
+    gdsTranscript original;
+
+    if(original.parse(filePath)!=0) {
+        printf("%s: cannot parse the file\n", filePath);
+        return 1;
+    }
+
+    gdsFileWriter copy;
+    gdsFileRewriter rewriter(&copy);
+    gdsTranscript copied;
+
+    if(rewriter.parse(filePath)!=0 ||
+       copied.parse(copy.data(), copy.size())!=0) {
+        printf("%s: cannot parse the copy\n", filePath);
+        return 1;
+    }
+
+    int failures = compareTranscripts(filePath, "copy", original, copied);
+
+    // A snapshot of the file, in a scratch file so that none is left next
+    // to it, must replay the same callbacks too.
+    gdsLibrary library;
+    gdsSnapshot snapshot;
+    gdsTranscript replayed;
+    string snapshotPath = string(P_tmpdir) + "/checkRoundTripXXXXXX";
+    int fd = mkstemp(&snapshotPath[0]);
+    int loaded = library.load(filePath);
+
+    if(fd>=0) {
+        close(fd);
+    }
+
+    if(fd<0 || loaded!=0 ||
+       gdsSnapshot::write(library, filePath, snapshotPath.c_str())!=0 ||
+       snapshot.load(snapshotPath.c_str(), filePath)!=0 ||
+       snapshot.replay(&replayed)!=0) {
+        printf("%s: cannot replay a snapshot\n", filePath);
+        ++failures;
+    } else {
+        failures += compareTranscripts(filePath, "snapshot", original,
+                                       replayed);
+    }
+
+    if(fd>=0) {
+        remove(snapshotPath.c_str());
+    }
+
+    // writeLibrary() serializes the structures on several threads into
+    // buffers of their own, which must join to the serial stream.  Both
+    // are stamped with the time they are written, which may differ.
+    gdsFileWriter serial, parallel;
+    gdsTranscript serialCallbacks(false), parallelCallbacks(false);
+
+    if(loaded!=0 || serial.writeLibrary(library)!=0 ||
+       parallel.writeLibrary(library, 4)!=0 ||
+       serialCallbacks.parse(serial.data(), serial.size())!=0 ||
+       parallelCallbacks.parse(parallel.data(), parallel.size())!=0) {
+        printf("%s: cannot write the library\n", filePath);
+        ++failures;
+    } else {
+        failures += compareTranscripts(filePath, "parallel writeLibrary",
+                                       serialCallbacks, parallelCallbacks);
+    }
+
+    return failures;
+}
+
+int main(int argc, char *argv[])
+{
+    gdsFileWriter original;
+    writePaths(&original);
+    int failures = 0;
+
+    gdsLibrary library;
+    gdsLibraryBuilder builder(&library);
+
+    if(builder.parse(original.data(), original.size())!=0) {
+        printf("parse: failed\n");
+        return 1;
+    }
+
+    failures += checkLibrary(library, "parse");
+
+    // The copy must be the same stream, byte for byte.
+    gdsFileWriter copy;
+    gdsFileRewriter rewriter(&copy);
+
+    if(rewriter.parse(original.data(), original.size())!=0 ||
+       copy.size()!=original.size() ||
+       memcmp(copy.data(), original.data(), original.size())!=0) {
+        printf("rewrite: the copy differs\n");
+        ++failures;
+    }
+
+    gdsFileWriter written;
+    written.writeLibrary(library);
+    gdsLibrary reloaded;
+    gdsLibraryBuilder reloader(&reloaded);
+
+    if(reloader.parse(written.data(), written.size())!=0) {
+        printf("writeLibrary: failed\n");
+        ++failures;
+    } else {
+        failures += checkLibrary(reloaded, "writeLibrary");
+    }
+
+    // The parallel parser replays recorded callbacks, from a file.  Its
+    // name is unique, so that checks can run side by side.
+    string filePath = string(P_tmpdir) + "/checkRoundTripXXXXXX";
+    int fd = mkstemp(&filePath[0]);
+    FILE *file = fd<0 ? NULL : fdopen(fd, "wb");
+
+    if(file==NULL || fwrite(original.data(), 1, original.size(), file)!=
+       original.size() || fclose(file)!=0) {
+        printf("cannot write %s\n", filePath.c_str());
+
+        if(fd>=0) {
+            unlink(filePath.c_str());
+        }
+
+        return 1;
+    }
+
+    gdsLibrary ordered;
+    gdsLibraryBuilder orderedBuilder(&ordered);
+    gdsParallelParser parallel(2);
+
+    if(parallel.parseOrdered(filePath.c_str(), &orderedBuilder)!=0) {
+        printf("parseOrdered: failed\n");
+        ++failures;
+    } else {
+        failures += checkLibrary(ordered, "parseOrdered");
+    }
+
+    remove(filePath.c_str());
+    failures += checkCycles();
+
+    for(int i=1; i<argc; ++i) {
+        failures += checkFile(argv[i]);
+    }
+
+    printf("%zu paths, %d files, %d failures\n", PATHS, argc - 1, failures);
+    return failures==0 ? 0 : 1;
+}
@@ -0,0 +1,2102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSBASICFILEPARSER_H_
+#define GDSBASICFILEPARSER_H_
+
+#include "gdsCalmaRecords.h"
+#include "gdsDecompressor.h"
+#include "gdsElement.h"
+#include "gdsLayerFilter.h"
+#include "gdsNameTable.h"
+#include "gdsParseStats.h"
+#include "gdsReadAhead.h"
+#include "gdsReal8.h"
+#include "gdsRecordReader.h"
+#include "gdsStructureIndex.h"
+#include "gdsXYDecoder.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Record decoder with statically bound callbacks.  Handler derives from
+     *  basic_gdsFileParser<Handler> and implements only the onParsed*
+     *  callbacks it cares about, with the same signatures as gdsFileParser
+     *  (non-virtual, public or with basic_gdsFileParser<Handler> as a
+     *  friend).  Calls are resolved at compile time so they can be inlined
+     *  into the decode loop, and records whose callback is missing are not
+     *  decoded at all.  A callback that is declared but can't be called
+     *  that way, such as a protected one without the friend, is a compile
+     *  error rather than a callback that never fires.
+     *
+     *      class layerCounter : public basic_gdsFileParser<layerCounter>
+     *      {
+     *      public:
+     *          void onParsedLayer(unsigned short layer) { ++count[layer]; }
+     *          unsigned long count[65536];
+     *      };
+     *
+     *  String callbacks (onParsedLibName, onParsedStrName, onParsedSname,
+     *  onParsedString and onParsedPropValue) may take a std::string_view
+     *  instead of a const char *.  The view then points straight into the
+     *  record, with the NUL padding trimmed, and is only valid during the
+     *  call.  The same views go to onParsedLibNameView and the like, with
+     *  View appended to the name, which is how gdsFileParser offers them
+     *  next to its const char * callbacks.
+     *
+     *  BGNEXTN and ENDEXTN hold signed 32-bit values, of which
+     *  onParsedBeginExtension and onParsedEndExtension only get the low 16
+     *  bits.  A handler that implements
+     *
+     *      void onParsedBeginExtension32(int bext);
+     *      void onParsedEndExtension32(int eext);
+     *
+     *  gets the whole values there instead.
+     *
+     *  gdsFileParser is the same decoder with every callback virtual.
+     *  Parsers keep no state outside their instance, so any number of them
+     *  may run on different threads at the same time (see gdsBatchParser).
+     */
+    template<class Handler>
+    class basic_gdsFileParser
+    {
+    public:
+        basic_gdsFileParser();
+
+        // Files compressed with gzip or zstd are recognized by their magic
+        // bytes and inflated on a second thread while they are decoded.
+        // The path is opened once, so it may also name a pipe.
+        int parse(const char *filePath);
+        // Reads an open descriptor (file, pipe or socket) from its current
+        // position to its end.  The descriptor stays open.
+        int parse(int fd);
+        // Parses a complete GDSII image that is already in memory.
+        int parse(const void *data, size_t size);
+
+        /*
+         *  Push interface for data that arrives in pieces, e.g. from a
+         *  socket or a decompressor.  Each chunk may end anywhere, also in
+         *  the middle of a record header; only the part of a record that
+         *  spans two chunks is copied, everything else is decoded in place.
+         *  finish() ends the stream and reports a truncated last record.
+         *  Both return 0 on success and 1 on malformed data, after which
+         *  feed() ignores its input until finish() is called.
+         */
+        int feed(const void *data, size_t length);
+        int finish();
+
+        // Fires the callbacks of a single structure, from its BGNSTR to its
+        // ENDSTR, by seeking to it with the help of a structure index.  The
+        // first form uses the sidecar index of the file when it is up to
+        // date, and otherwise builds the index without saving it.  Callers
+        // that look up many structures pass an index of their own, or keep
+        // the sidecar with testParser --index.
+        int parseStructure(const char *filePath, const char *strName);
+        int parseStructure(const char *filePath,
+                           const gdsStructureIndex &index,
+                           const char *strName);
+
+        /*
+         *  Record subscription.  Records whose type is not subscribed are
+         *  skipped by their length without looking at the payload.  When the
+         *  record that starts an element (BOUNDARY, PATH, SREF, AREF, TEXT,
+         *  NODE or BOX) is not subscribed, the whole element up to and
+         *  including its ENDEL is skipped.  Everything is subscribed by
+         *  default.
+         */
+        static const unsigned long long SUBSCRIBE_ALL = ~0ULL;
+
+        static unsigned long long recordBit(RecordType type);
+        void subscribe(RecordType type);
+        void unsubscribe(RecordType type);
+        void setSubscription(unsigned long long mask);
+        unsigned long long subscription() const;
+
+        /*
+         *  Layer filter.  BOUNDARY, PATH, BOX, TEXT and NODE elements whose
+         *  layer and datatype (texttype, boxtype, nodetype) are not accepted
+         *  by the filter are dropped before their start callback, and their
+         *  XY and everything else up to and including ENDEL are skipped
+         *  without being decoded.  SREF and AREF have no layer and always
+         *  pass.  An element without a datatype record counts as datatype 0.
+         */
+        void setLayerFilter(const gdsLayerFilter &filter);
+        void clearLayerFilter();
+        bool hasLayerFilter() const;
+        const gdsLayerFilter &layerFilter() const;
+
+        /*
+         *  Statistics, off by default.  While they are on every record is
+         *  counted and the clock is read around each record and each
+         *  callback; while they are off they cost one test per record.  They
+         *  add up over parses until they are cleared.  Records that
+         *  gdsParallelParser decodes on its workers are not counted.
+         */
+        void enableStats(bool enable = true);
+        const gdsParseStats &getStats() const;
+        void clearStats();
+
+        /*
+         *  Element assembly, off by default.  While it is on, the records of
+         *  every element are collected into a gdsElement instead of firing
+         *  their own callbacks, and the handler's
+         *
+         *      void onParsedElement(const gdsElement &element);
+         *
+         *  is called once per element.  With a batch size above one the
+         *  elements are held back and handed over together to
+         *
+         *      void onParsedElements(const gdsElement elements[],
+         *                            unsigned int count);
+         *
+         *  when the handler has it.  A batch is also handed over before the
+         *  next structure or library record, so callbacks stay in file
+         *  order.  gdsParallelParser::parseOrdered() replays record
+         *  callbacks, so it refuses a handler with elements enabled.
+         */
+        void enableElements(unsigned int batch = 1);
+        void disableElements();
+        bool elementsEnabled() const;
+
+        /*
+         *  Structure name ids, off by default.  While they are on, STRNAME
+         *  and SNAME records go to
+         *
+         *      void onParsedStrNameId(unsigned int id, std::string_view name);
+         *      void onParsedSnameId(unsigned int id, std::string_view name);
+         *
+         *  instead of onParsedStrName and onParsedSname, where id is the
+         *  dense index of the name in nameTable().  A structure and the
+         *  SNAMEs that refer to it get the same id, and ids stay the same
+         *  over parses until the table is cleared.
+         */
+        void enableNameIds(bool enable = true);
+        bool nameIdsEnabled() const;
+        gdsNameTable &nameTable();
+        const gdsNameTable &nameTable() const;
+
+        /*
+         *  Read-ahead, off by default, in which case parse(filePath) maps
+         *  regular files.  While it is on, the file is read in blocks of the
+         *  given size by gdsReadAhead while the blocks before them are
+         *  decoded, and with direct it is opened with O_DIRECT.  This keeps
+         *  the decoder busy on cold files on slow or network storage, where
+         *  it would otherwise wait on each page fault of the mapping.
+         */
+        void enableReadAhead(
+            size_t blockSize = gdsReadAhead::DEFAULT_BLOCK_SIZE,
+            bool direct = false);
+        void disableReadAhead();
+
+    protected:
+        int parseRecords(gdsRecordReader *reader, unsigned long long end);
+        void parseBuffer(unsigned char recType, const unsigned char *input,
+                         unsigned int length);
+
+    private:
+#define GDSFP_DETECT_CALLBACK(name, ...)                                     \
+        template<class H, class = void>                                      \
+        struct has_##name : std::false_type {};                              \
+        template<class H>                                                    \
+        struct has_##name<H, std::void_t<decltype(                           \
+            std::declval<H &>().name(__VA_ARGS__))> > : std::true_type {};
+
+        GDSFP_DETECT_CALLBACK(onParsedGDSVersion, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedModTime, (short)0, (short)0, (short)0,
+                              (short)0, (short)0, (short)0)
+        GDSFP_DETECT_CALLBACK(onParsedAccessTime, (short)0, (short)0, (short)0,
+                              (short)0, (short)0, (short)0)
+        GDSFP_DETECT_CALLBACK(onParsedLibName, (const char *)0)
+        GDSFP_DETECT_CALLBACK(onParsedUnits, 0.0, 0.0)
+        GDSFP_DETECT_CALLBACK(onParsedStrName, (const char *)0)
+        GDSFP_DETECT_CALLBACK(onParsedBoundaryStart)
+        GDSFP_DETECT_CALLBACK(onParsedPathStart)
+        GDSFP_DETECT_CALLBACK(onParsedBoxStart)
+        GDSFP_DETECT_CALLBACK(onParsedEndElement)
+        GDSFP_DETECT_CALLBACK(onParsedEndStructure)
+        GDSFP_DETECT_CALLBACK(onParsedEndLib)
+        GDSFP_DETECT_CALLBACK(onParsedColumnsRows, (unsigned short)0,
+                              (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedPathType, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedStrans, (short)0)
+        GDSFP_DETECT_CALLBACK(onParsedPresentation, (short)0, (short)0,
+                              (short)0)
+        GDSFP_DETECT_CALLBACK(onParsedNodeStart)
+        GDSFP_DETECT_CALLBACK(onParsedTextStart)
+        GDSFP_DETECT_CALLBACK(onParsedSrefStart)
+        GDSFP_DETECT_CALLBACK(onParsedArefStart)
+        GDSFP_DETECT_CALLBACK(onParsedSname, (const char *)0)
+        GDSFP_DETECT_CALLBACK(onParsedString, (const char *)0)
+        GDSFP_DETECT_CALLBACK(onParsedPropValue, (const char *)0)
+        GDSFP_DETECT_CALLBACK(onParsedXY, 0, (int *)0, (int *)0)
+        GDSFP_DETECT_CALLBACK(onParsedLayer, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedWidth, 0)
+        GDSFP_DETECT_CALLBACK(onParsedDataType, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedTextType, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedAngle, 0.0)
+        GDSFP_DETECT_CALLBACK(onParsedMag, 0.0)
+        GDSFP_DETECT_CALLBACK(onParsedBeginExtension, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedEndExtension, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedBeginExtension32, 0)
+        GDSFP_DETECT_CALLBACK(onParsedEndExtension32, 0)
+        GDSFP_DETECT_CALLBACK(onParsedPropertyNumber, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedNodeType, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedBoxType, (unsigned short)0)
+        GDSFP_DETECT_CALLBACK(onParsedElement,
+                              std::declval<const gdsElement &>())
+        GDSFP_DETECT_CALLBACK(onParsedElements, (const gdsElement *)0, 0u)
+        GDSFP_DETECT_CALLBACK(onParsedStrNameId, 0u, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedSnameId, 0u, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedLibNameView, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedStrNameView, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedSnameView, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedStringView, std::string_view())
+        GDSFP_DETECT_CALLBACK(onParsedPropValueView, std::string_view())
+#undef GDSFP_DETECT_CALLBACK
+
+        // Every callback name, for the checks below.
+#define GDSFP_CALLBACK_NAMES(X)                                              \
+        X(onParsedGDSVersion)                                                \
+        X(onParsedModTime)                                                   \
+        X(onParsedAccessTime)                                                \
+        X(onParsedLibName)                                                   \
+        X(onParsedUnits)                                                     \
+        X(onParsedStrName)                                                   \
+        X(onParsedBoundaryStart)                                             \
+        X(onParsedPathStart)                                                 \
+        X(onParsedBoxStart)                                                  \
+        X(onParsedEndElement)                                                \
+        X(onParsedEndStructure)                                              \
+        X(onParsedEndLib)                                                    \
+        X(onParsedColumnsRows)                                               \
+        X(onParsedPathType)                                                  \
+        X(onParsedStrans)                                                    \
+        X(onParsedPresentation)                                              \
+        X(onParsedNodeStart)                                                 \
+        X(onParsedTextStart)                                                 \
+        X(onParsedSrefStart)                                                 \
+        X(onParsedArefStart)                                                 \
+        X(onParsedSname)                                                     \
+        X(onParsedString)                                                    \
+        X(onParsedPropValue)                                                 \
+        X(onParsedXY)                                                        \
+        X(onParsedLayer)                                                     \
+        X(onParsedWidth)                                                     \
+        X(onParsedDataType)                                                  \
+        X(onParsedTextType)                                                  \
+        X(onParsedAngle)                                                     \
+        X(onParsedMag)                                                       \
+        X(onParsedBeginExtension)                                            \
+        X(onParsedEndExtension)                                              \
+        X(onParsedBeginExtension32)                                          \
+        X(onParsedEndExtension32)                                            \
+        X(onParsedPropertyNumber)                                            \
+        X(onParsedNodeType)                                                  \
+        X(onParsedBoxType)                                                   \
+        X(onParsedElement)                                                   \
+        X(onParsedElements)                                                  \
+        X(onParsedStrNameId)                                                 \
+        X(onParsedSnameId)                                                   \
+        X(onParsedLibNameView)                                               \
+        X(onParsedStrNameView)                                               \
+        X(onParsedSnameView)                                                 \
+        X(onParsedStringView)                                                \
+        X(onParsedPropValueView)
+
+        // Callbacks that take a std::string_view, which only the string
+        // callbacks may.  A const char * does not convert to one, so these
+        // only match the view forms.
+#define GDSFP_DETECT_CALLBACK(name)                                          \
+        template<class H, class = void>                                      \
+        struct has_##name##_view : std::false_type {};                       \
+        template<class H>                                                    \
+        struct has_##name##_view<H, std::void_t<decltype(                    \
+            std::declval<H &>().name(std::string_view()))> >                 \
+            : std::true_type {};
+        GDSFP_CALLBACK_NAMES(GDSFP_DETECT_CALLBACK)
+#undef GDSFP_DETECT_CALLBACK
+
+        // A callback the handler declares but the decoder can not call,
+        // because it is protected or private without the friend, or because
+        // its parameters don't fit, would silently never be called, so it
+        // fails to compile instead.  A name is declared when it makes the
+        // lookup in callbackProbe ambiguous, whatever its access.
+#define GDSFP_CALLBACK_NAME(name) int name;
+        struct callbackNames { GDSFP_CALLBACK_NAMES(GDSFP_CALLBACK_NAME) };
+#undef GDSFP_CALLBACK_NAME
+
+        template<class H, bool = std::is_final<H>::value>
+        struct callbackProbe : H, callbackNames {};
+        template<class H>
+        struct callbackProbe<H, true> : callbackNames {};
+
+#define GDSFP_CALLBACK_NAME(name)                                            \
+        template<class H, class = void>                                      \
+        struct declares_##name : std::true_type {};                          \
+        template<class H>                                                    \
+        struct declares_##name<H, std::void_t<decltype(                      \
+            &callbackProbe<H>::name)> > : std::false_type {};
+        GDSFP_CALLBACK_NAMES(GDSFP_CALLBACK_NAME)
+#undef GDSFP_CALLBACK_NAME
+
+        static void checkCallbacks();
+
+        Handler &handler() {
+            return *static_cast<Handler *>(this);
+        };
+
+        static unsigned int minimumLength(unsigned char recType);
+        static std::string_view readView(const unsigned char *input,
+                                         unsigned int length,
+                                         std::string *scratch);
+        static void readString(const unsigned char *input, unsigned int length,
+                               std::string *str);
+        static void readTimeStamp(const unsigned char *input, short *year,
+                                  short *month, short *day, short *hour,
+                                  short *minute, short *sec);
+        static short readShort(const unsigned char *input);
+        static unsigned int readUInt(const unsigned char *input);
+        static int readInt(const unsigned char *input);
+        static double readDouble(const unsigned char *input);
+        void readHeader(const unsigned char *input, unsigned int length);
+        void readModTimeStamp(const unsigned char *input, unsigned int length);
+        void readAccessTimeStamp(const unsigned char *input,
+                                 unsigned int length);
+        void readLibName(const unsigned char *input, unsigned int length);
+        void readUnits(const unsigned char *input, unsigned int length);
+        void readStrName(const unsigned char *input, unsigned int length);
+        void readBoundary(const unsigned char *input, unsigned int length);
+        void readPath(const unsigned char *input, unsigned int length);
+        void readNode(const unsigned char *input, unsigned int length);
+        void readBox(const unsigned char *input, unsigned int length);
+        void readEndElement(const unsigned char *input, unsigned int length);
+        void readEndStructure(const unsigned char *input, unsigned int length);
+        void readEndLib(const unsigned char *input, unsigned int length);
+        void readColumnRow(const unsigned char *input, unsigned int length);
+        void readPathType(const unsigned char *input, unsigned int length);
+        void readStrans(const unsigned char *input, unsigned int length);
+        void readPresentation(const unsigned char *input, unsigned int length);
+        void readText(const unsigned char *input, unsigned int length);
+        void readSref(const unsigned char *input, unsigned int length);
+        void readAref(const unsigned char *input, unsigned int length);
+        void readSname(const unsigned char *input, unsigned int length);
+        void readString(const unsigned char *input, unsigned int length);
+        void readPropValue(const unsigned char *input, unsigned int length);
+        void readXY(const unsigned char *input, unsigned int length);
+        void readLayer(const unsigned char *input, unsigned int length);
+        void readWidth(const unsigned char *input, unsigned int length);
+        void readDataType(const unsigned char *input, unsigned int length);
+        void readTextType(const unsigned char *input, unsigned int length);
+        void readAngle(const unsigned char *input, unsigned int length);
+        void readMag(const unsigned char *input, unsigned int length);
+        void readBeginExtension(const unsigned char *input,
+                                unsigned int length);
+        void readEndExtension(const unsigned char *input, unsigned int length);
+        void readPropertyNumber(const unsigned char *input,
+                                unsigned int length);
+        void readNodeType(const unsigned char *input, unsigned int length);
+        void readBoxType(const unsigned char *input, unsigned int length);
+
+        void assembleRecord(unsigned char recType,
+                            const unsigned char *input, unsigned int length);
+        unsigned int addElementString(const unsigned char *input,
+                                      unsigned int length);
+        void flushElements();
+
+        void parseRecord(const gdsRecord &record);
+        void dispatchRecord(const gdsRecord &record);
+        void parseCounted(const gdsRecord &record);
+        void resetState();
+        void feedRecord(const unsigned char *input, unsigned int length);
+        int streamError(unsigned int recordLength);
+        int parseCompressed(const gdsSniffedFile &file);
+        int parseReadAhead(int fd);
+        int parseStream(const gdsSniffedFile &file);
+
+        static bool isElementStart(unsigned char recType);
+        bool filterRecord(unsigned char recType, const unsigned char *input,
+                          unsigned int length);
+
+        std::string text;
+        gdsCoordinateBuffer coordinates;
+        unsigned long long subscribed;
+        bool skippingElement;
+
+        gdsLayerFilter filter;
+        bool filtering;
+        unsigned char pendingElement;   // Element start held by the filter.
+        bool pendingLayer;
+        unsigned char layerBytes[2];
+        bool pendingFlags;
+        unsigned char flagBytes[2];
+        bool pendingPlex;
+        unsigned char plexBytes[4];
+
+        std::vector<unsigned char> carry;   // Record split between chunks.
+        unsigned long long streamOffset;
+        bool streaming;
+        bool streamEnded;
+        bool streamFailed;
+
+        gdsParseStats statistics;
+        gdsParseStats *stats;           // NULL while they are off.
+        unsigned char statsElement;     // Element the XY points belong to.
+
+        // Where the variable parts of an element start while its batch is
+        // being collected.  The points of the batch are decoded one after
+        // the other into coordinates, the buffer that readXY() uses, and
+        // the pointers of the element are set when the batch is handed
+        // over, since the buffers may still move until then.
+        struct elementSpan {
+            unsigned int firstPoint;
+            unsigned int name;          // In elementStrings, plus one.
+            unsigned int firstProperty;
+        };
+
+        std::vector<gdsElement> elements;
+        gdsElement blankElement;        // What a new element starts as.
+        std::vector<elementSpan> spans;
+        unsigned int elementPoints;     // Used part of coordinates.
+        std::vector<char> elementStrings;
+        std::vector<gdsElementProperty> elementProperties;
+        std::vector<unsigned int> propertyValues;   // Like elementSpan::name.
+        unsigned int elementBatch;      // 0 while assembly is off.
+        bool elementOpen;
+
+        gdsNameTable names;
+        bool nameIds;
+
+        size_t readAheadBlock;          // 0 while read-ahead is off.
+        bool readAheadDirect;
+    };
+
+    template<class Handler>
+    basic_gdsFileParser<Handler>::basic_gdsFileParser()
+        : subscribed(SUBSCRIBE_ALL), skippingElement(false), filtering(false),
+          pendingElement(0), pendingLayer(false), pendingFlags(false),
+          pendingPlex(false), streamOffset(0),
+          streaming(false), streamEnded(false), streamFailed(false),
+          stats(NULL), statsElement(0), elementPoints(0), elementBatch(0),
+          elementOpen(false), nameIds(false), readAheadBlock(0),
+          readAheadDirect(false)
+    {
+        checkCallbacks();
+
+        // Copying this is much cheaper than zero filling every element.
+        memset(&blankElement, 0, sizeof(blankElement));
+        blankElement.mag = 1.0;
+        blankElement.columns = blankElement.rows = 1;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::checkCallbacks()
+    {
+#define GDSFP_CALLBACK_NAME(name)                                            \
+        static_assert(!declares_##name<Handler>::value ||                    \
+                      has_##name<Handler>::value ||                          \
+                      has_##name##_view<Handler>::value,                     \
+                      #name " is declared but basic_gdsFileParser can not "  \
+                      "call it: make it public or befriend "                 \
+                      "basic_gdsFileParser<Handler>, and check its "         \
+                      "parameters");
+        GDSFP_CALLBACK_NAMES(GDSFP_CALLBACK_NAME)
+#undef GDSFP_CALLBACK_NAME
+#undef GDSFP_CALLBACK_NAMES
+    }
+
+    template<class Handler>
+    unsigned long long basic_gdsFileParser<Handler>::recordBit(RecordType type)
+    {
+        return 1ULL<<type;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::subscribe(RecordType type)
+    {
+        subscribed |= recordBit(type);
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::unsubscribe(RecordType type)
+    {
+        subscribed &= ~recordBit(type);
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::setSubscription(unsigned long long mask)
+    {
+        subscribed = mask;
+    }
+
+    template<class Handler>
+    unsigned long long basic_gdsFileParser<Handler>::subscription() const
+    {
+        return subscribed;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::setLayerFilter(
+        const gdsLayerFilter &filter)
+    {
+        this->filter = filter;
+        filtering = true;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::clearLayerFilter()
+    {
+        filter.clear();
+        filtering = false;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::enableStats(bool enable)
+    {
+        stats = enable ? &statistics : NULL;
+    }
+
+    template<class Handler>
+    const gdsParseStats &basic_gdsFileParser<Handler>::getStats() const
+    {
+        return statistics;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::clearStats()
+    {
+        statistics.clear();
+        statsElement = 0;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::enableElements(unsigned int batch)
+    {
+        elementBatch = batch>0 ? batch : 1;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::disableElements()
+    {
+        elementBatch = 0;
+    }
+
+    template<class Handler>
+    bool basic_gdsFileParser<Handler>::elementsEnabled() const
+    {
+        return elementBatch>0;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::enableNameIds(bool enable)
+    {
+        nameIds = enable;
+    }
+
+    template<class Handler>
+    bool basic_gdsFileParser<Handler>::nameIdsEnabled() const
+    {
+        return nameIds;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::enableReadAhead(size_t blockSize,
+                                                       bool direct)
+    {
+        readAheadBlock = blockSize>0 ? blockSize
+                                     : gdsReadAhead::DEFAULT_BLOCK_SIZE;
+        readAheadDirect = direct;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::disableReadAhead()
+    {
+        readAheadBlock = 0;
+    }
+
+    template<class Handler>
+    gdsNameTable &basic_gdsFileParser<Handler>::nameTable()
+    {
+        return names;
+    }
+
+    template<class Handler>
+    const gdsNameTable &basic_gdsFileParser<Handler>::nameTable() const
+    {
+        return names;
+    }
+
+    template<class Handler>
+    bool basic_gdsFileParser<Handler>::hasLayerFilter() const
+    {
+        return filtering;
+    }
+
+    template<class Handler>
+    const gdsLayerFilter &basic_gdsFileParser<Handler>::layerFilter() const
+    {
+        return filter;
+    }
+
+    /*
+     *  Holds back the start of a layered element until its LAYER and
+     *  datatype records have been seen.  Returns true when the record was
+     *  consumed here, either held back or dropped with its element.
+     */
+    template<class Handler>
+    bool basic_gdsFileParser<Handler>::filterRecord(
+        unsigned char recType, const unsigned char *input, unsigned int length)
+    {
+        if(pendingElement==0) {
+            switch(recType) {
+                case BOUNDARY:
+                case PATH:
+                case BOX:
+                case TEXT:
+                case NODE:
+                    if(subscribed & (1ULL<<recType)) {
+                        pendingElement = recType;
+                        pendingLayer = false;
+                        pendingFlags = false;
+                        pendingPlex = false;
+                        return true;
+                    }
+
+                    return false;
+
+                default:
+                    return false;
+            }
+        }
+
+        unsigned short dataType = 0;
+
+        switch(recType) {
+            // Held like the layer until the filter decides.
+            case ELFLAGS:
+                if(length>=2) {
+                    flagBytes[0] = input[0];
+                    flagBytes[1] = input[1];
+                    pendingFlags = true;
+                }
+
+                return true;
+
+            case PLEX:
+                if(length>=4) {
+                    memcpy(plexBytes, input, 4);
+                    pendingPlex = true;
+                }
+
+                return true;
+
+            case LAYER:
+                if(length>=2) {
+                    layerBytes[0] = input[0];
+                    layerBytes[1] = input[1];
+                    pendingLayer = true;
+                }
+
+                return true;
+
+            case DATATYPE:
+            case TEXTTYPE:
+            case BOXTYPE:
+            case NODETYPE:
+                if(length>=2) {
+                    dataType = readShort(input);
+                }
+
+                break;
+
+            default:
+                break;
+        }
+
+        unsigned char element = pendingElement;
+        unsigned short layer = pendingLayer ? readShort(layerBytes) : 0;
+        pendingElement = 0;
+
+        if(!filter.accepts(layer, dataType)) {
+            skippingElement = recType!=ENDEL;
+            return true;
+        }
+
+        parseBuffer(element, NULL, 0);
+
+        if(pendingFlags && (subscribed & (1ULL<<ELFLAGS))) {
+            parseBuffer(ELFLAGS, flagBytes, 2);
+        }
+
+        if(pendingPlex && (subscribed & (1ULL<<PLEX))) {
+            parseBuffer(PLEX, plexBytes, 4);
+        }
+
+        if(pendingLayer && (subscribed & (1ULL<<LAYER))) {
+            parseBuffer(LAYER, layerBytes, 2);
+        }
+
+        return false;
+    }
+
+    template<class Handler>
+    bool basic_gdsFileParser<Handler>::isElementStart(unsigned char recType)
+    {
+        switch(recType) {
+            case BOUNDARY:
+            case PATH:
+            case SREF:
+            case AREF:
+            case TEXT:
+            case NODE:
+            case BOX:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    /*
+     *  Smallest payload, in bytes, that each decoded record type needs.
+     *  Records that are shorter than this are malformed and are skipped.
+     */
+    template<class Handler>
+    unsigned int basic_gdsFileParser<Handler>::minimumLength(
+        unsigned char recType)
+    {
+        switch(recType) {
+            case BGNLIB:
+            case BGNSTR:
+                return 24;
+
+            case UNITS:
+                return 16;
+
+            case COLROW:
+            case PLEX:
+                return 4;
+
+            case HEADER:
+            case ELFLAGS:
+            case PATHTYPE:
+            case STRANS:
+            case PRESENTATION:
+            case LAYER:
+            case DATATYPE:
+            case TEXTTYPE:
+            case PROPATTR:
+            case NODETYPE:
+            case BOXTYPE:
+                return 2;
+
+            case WIDTH:
+            case BGNEXTN:
+            case ENDEXTN:
+                return 4;
+
+            case ANGLE:
+            case MAG:
+                return 8;
+
+            default:
+                return 0;
+        }
+    }
+
+    template<class Handler>
+    short basic_gdsFileParser<Handler>::readShort(const unsigned char *input)
+    {
+        return ((input[0]<<8) | input[1]);
+    }
+
+    template<class Handler>
+    double basic_gdsFileParser<Handler>::readDouble(const unsigned char *input)
+    {
+        return decodeReal8(input);
+    }
+
+    // Strings are NUL padded to an even length.  The view points into the
+    // record unless it holds other characters that aren't viewable, which
+    // are then dropped in a copy in scratch.
+    template<class Handler>
+    std::string_view basic_gdsFileParser<Handler>::readView(
+        const unsigned char *input, unsigned int length, std::string *scratch)
+    {
+        while(length>0 && input[length - 1]=='\0') {
+            --length;
+        }
+
+        for(unsigned int i=0; i<length; ++i) {
+            if(input[i]<32||input[i]>127) { // We only want viewable characters.
+                scratch->clear();
+
+                for(unsigned int j=0; j<length; ++j) {
+                    if(input[j]>=32 && input[j]<=127) {
+                        (*scratch)+=(char)input[j];
+                    }
+                }
+
+                return *scratch;
+            }
+        }
+
+        return std::string_view((const char *)input, length);
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readString(
+        const unsigned char *input, unsigned int length, std::string *str)
+    {
+        std::string_view view = readView(input, length, str);
+
+        if(view.data()!=str->data()) {
+            str->assign(view.data(), view.size());
+        }
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::readInt(const unsigned char *input)
+    {
+        const unsigned char *p = input;
+        return ((p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3]);
+    }
+
+    template<class Handler>
+    unsigned int basic_gdsFileParser<Handler>::readUInt(
+        const unsigned char *input)
+    {
+        const unsigned char *p = input;
+        return ((p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3]);
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readTimeStamp(
+        const unsigned char *input, short *year, short *month, short *day,
+        short *hour, short *minute, short *sec)
+    {
+        (*year) = readShort(input);
+        (*month) = readShort(input + 2);
+        (*day) = readShort(input + 4);
+        (*hour) = readShort(input + 6);
+        (*minute) = readShort(input + 8);
+        (*sec) = readShort(input + 10);
+
+        if((*year)<1000) {
+            (*year)+=1900;
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readHeader(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedGDSVersion<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedGDSVersion(readShort(input));
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readModTimeStamp(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedModTime<Handler>::value) {
+            short year, month, day, hour, minute, sec;
+            readTimeStamp(input, &year, &month, &day, &hour, &minute, &sec);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedModTime(year, month, day, hour, minute, sec);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readAccessTimeStamp(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedAccessTime<Handler>::value) {
+            short year, month, day, hour, minute, sec;
+            readTimeStamp(input + 12, &year, &month, &day, &hour, &minute,
+                          &sec);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedAccessTime(year, month, day, hour, minute, sec);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readLibName(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedLibName_view<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedLibName(view);
+        } else if constexpr(has_onParsedLibNameView<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedLibNameView(view);
+        } else if constexpr(has_onParsedLibName<Handler>::value) {
+            readString(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedLibName(text.c_str());
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readUnits(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedUnits<Handler>::value) {
+            double uu = readDouble(input);
+            double db = readDouble(input + 8);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedUnits(uu, db);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readStrName(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedStrNameId<Handler>::value) {
+            if(nameIds) {
+                std::string_view view = readView(input, length, &text);
+                unsigned int id = names.intern(view);
+                gdsCallbackTimer timer(stats);
+                handler().onParsedStrNameId(id, view);
+                return;
+            }
+        }
+
+        if constexpr(has_onParsedStrName_view<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedStrName(view);
+        } else if constexpr(has_onParsedStrNameView<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedStrNameView(view);
+        } else if constexpr(has_onParsedStrName<Handler>::value) {
+            readString(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedStrName(text.c_str());
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readBoundary(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedBoundaryStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedBoundaryStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readPath(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedPathStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPathStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readBox(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedBoxStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedBoxStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readEndElement(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedEndElement<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedEndElement();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readEndStructure(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedEndStructure<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedEndStructure();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readEndLib(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedEndLib<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedEndLib();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readColumnRow(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedColumnsRows<Handler>::value) {
+            unsigned short column, row;
+            column = readShort(input);
+            row = readShort(input + 2);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedColumnsRows(column, row);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readPathType(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedPathType<Handler>::value) {
+            unsigned short path;
+            path = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPathType(path);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readStrans(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedStrans<Handler>::value) {
+            short strans;
+            strans = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedStrans(strans);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readPresentation(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedPresentation<Handler>::value) {
+            short present;
+            present = readShort(input);
+            short font, valign, halign;
+            font = (present & (0x10 | 0x20 | 0x30));
+            valign = (present & (0x04 | 0x08));
+            halign = (present & (0x01 | 0x02));
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPresentation(font, valign, halign);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readNode(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedNodeStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedNodeStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readText(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedTextStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedTextStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readSref(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedSrefStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedSrefStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readAref(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedArefStart<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedArefStart();
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readSname(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedSnameId<Handler>::value) {
+            if(nameIds) {
+                std::string_view view = readView(input, length, &text);
+                unsigned int id = names.intern(view);
+                gdsCallbackTimer timer(stats);
+                handler().onParsedSnameId(id, view);
+                return;
+            }
+        }
+
+        if constexpr(has_onParsedSname_view<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedSname(view);
+        } else if constexpr(has_onParsedSnameView<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedSnameView(view);
+        } else if constexpr(has_onParsedSname<Handler>::value) {
+            readString(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedSname(text.c_str());
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readString(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedString_view<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedString(view);
+        } else if constexpr(has_onParsedStringView<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedStringView(view);
+        } else if constexpr(has_onParsedString<Handler>::value) {
+            readString(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedString(text.c_str());
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readPropValue(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedPropValue_view<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPropValue(view);
+        } else if constexpr(has_onParsedPropValueView<Handler>::value) {
+            std::string_view view = readView(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPropValueView(view);
+        } else if constexpr(has_onParsedPropValue<Handler>::value) {
+            readString(input, length, &text);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPropValue(text.c_str());
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readXY(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedXY<Handler>::value) {
+            int count = length/8;
+            coordinates.reserve(count);
+            int *x = coordinates.x();
+            int *y = coordinates.y();
+            decodeXY(input, x, y, count);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedXY(count, x, y);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readLayer(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedLayer<Handler>::value) {
+            unsigned short layer;
+            layer = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedLayer(layer);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readWidth(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedWidth<Handler>::value) {
+            int width;
+            width = readInt(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedWidth(width);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readDataType(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedDataType<Handler>::value) {
+            unsigned short dataType;
+            dataType = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedDataType(dataType);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readTextType(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedTextType<Handler>::value) {
+            unsigned short textType;
+            textType = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedTextType(textType);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readAngle(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedAngle<Handler>::value) {
+            double angle;
+            angle = readDouble(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedAngle(angle);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readMag(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedMag<Handler>::value) {
+            double mag;
+            mag = readDouble(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedMag(mag);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readBeginExtension(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedBeginExtension32<Handler>::value) {
+            int bext = readInt(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedBeginExtension32(bext);
+        } else if constexpr(has_onParsedBeginExtension<Handler>::value) {
+            unsigned int bext;
+            bext = readInt(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedBeginExtension(bext);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readEndExtension(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedEndExtension32<Handler>::value) {
+            int eext = readInt(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedEndExtension32(eext);
+        } else if constexpr(has_onParsedEndExtension<Handler>::value) {
+            unsigned int eext;
+            eext = readInt(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedEndExtension(eext);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readPropertyNumber(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedPropertyNumber<Handler>::value) {
+            unsigned short propNum;
+            propNum = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedPropertyNumber(propNum);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readNodeType(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedNodeType<Handler>::value) {
+            unsigned short nodeType;
+            nodeType = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedNodeType(nodeType);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::readBoxType(
+        const unsigned char *input, unsigned int length)
+    {
+        if constexpr(has_onParsedBoxType<Handler>::value) {
+            unsigned short boxType;
+            boxType = readShort(input);
+            gdsCallbackTimer timer(stats);
+            handler().onParsedBoxType(boxType);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::parseBuffer(
+        unsigned char recType, const unsigned char *input, unsigned int length)
+    {
+        if(length<minimumLength(recType)) {
+            return;     // Malformed record, there is nothing to decode.
+        }
+
+        if constexpr(has_onParsedElement<Handler>::value ||
+                     has_onParsedElements<Handler>::value) {
+            if(elementBatch>0) {
+                if(recType==BGNSTR || recType==ENDSTR || recType==ENDLIB) {
+                    if(elementOpen) {
+                        assembleRecord(ENDEL, NULL, 0);
+                    }
+                } else if(elementOpen || isElementStart(recType)) {
+                    assembleRecord(recType, input, length);
+                    return;
+                }
+
+                if(!elements.empty()) {
+                    flushElements();
+                }
+            }
+        }
+
+        switch(recType) {
+            case HEADER:        readHeader(input, length);              break;
+
+            case BGNLIB:        readModTimeStamp(input, length);
+                readAccessTimeStamp(input, length);     break;
+
+            case LIBNAME:       readLibName(input, length);             break;
+
+            case BGNSTR:        readModTimeStamp(input, length);
+                readAccessTimeStamp(input, length);     break;
+
+            case UNITS:         readUnits(input, length);               break;
+
+            case STRNAME:       readStrName(input, length);             break;
+
+            case BOUNDARY:      readBoundary(input, length);            break;
+
+            case PATH:          readPath(input, length);                break;
+
+            case ENDEL:         readEndElement(input, length);          break;
+
+            case ENDSTR:        readEndStructure(input, length);        break;
+
+            case ENDLIB:        readEndLib(input, length);              break;
+
+            case COLROW:        readColumnRow(input, length);           break;
+
+            case PATHTYPE:      readPathType(input, length);            break;
+
+            case STRANS:        readStrans(input, length);              break;
+
+            case PRESENTATION:  readPresentation(input, length);        break;
+
+            case TEXT:          readText(input, length);                break;
+
+            case SREF:          readSref(input, length);                break;
+
+            case AREF:          readAref(input, length);                break;
+
+            case SNAME:         readSname(input, length);               break;
+
+            case STRING:        readString(input, length);              break;
+
+            case PROPVALUE:     readPropValue(input, length);           break;
+
+            case XY:            readXY(input, length);                  break;
+
+            case LAYER:         readLayer(input, length);               break;
+
+            case WIDTH:         readWidth(input, length);               break;
+
+            case DATATYPE:      readDataType(input, length);            break;
+
+            case TEXTTYPE:      readTextType(input, length);            break;
+
+            case ANGLE:         readAngle(input, length);               break;
+
+            case MAG:           readMag(input, length);                 break;
+
+            case BGNEXTN:       readBeginExtension(input, length);      break;
+
+            case ENDEXTN:       readEndExtension(input, length);        break;
+
+            case PROPATTR:      readPropertyNumber(input, length);      break;
+
+            case NODE:          readNode(input, length);                break;
+
+            case NODETYPE:      readNodeType(input, length);            break;
+
+            case BOX:           readBox(input, length);                 break;
+
+            case BOXTYPE:       readBoxType(input, length);             break;
+
+            default:
+                break;
+        }
+    }
+
+    template<class Handler>
+    unsigned int basic_gdsFileParser<Handler>::addElementString(
+        const unsigned char *input, unsigned int length)
+    {
+        unsigned int start = elementStrings.size();
+        elementStrings.resize(start + length + 1);
+        char *p = &elementStrings[start];
+
+        for(unsigned int i=0; i<length; ++i) {
+            if(input[i]>=32 && input[i]<=127) {     // As readString().
+                *p++ = input[i];
+            }
+        }
+
+        *p = '\0';
+        elementStrings.resize(p + 1 - elementStrings.data());
+        return start + 1;
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::assembleRecord(
+        unsigned char recType, const unsigned char *input, unsigned int length)
+    {
+        if(!elementOpen) {
+            elements.push_back(blankElement);
+            elements.back().type = recType;
+
+            elementSpan span = { elementPoints, 0,
+                                 (unsigned int)elementProperties.size() };
+            spans.push_back(span);
+            elementOpen = true;
+            return;
+        }
+
+        gdsElement &element = elements.back();
+
+        switch(recType) {
+            case BOUNDARY:
+            case PATH:
+            case SREF:
+            case AREF:
+            case TEXT:
+            case NODE:
+            case BOX:
+                // An element without ENDEL ends where the next one starts,
+                // as the records of both reach the record callbacks anyway.
+                assembleRecord(ENDEL, NULL, 0);
+                assembleRecord(recType, input, length);
+                break;
+
+            case LAYER:         element.layer = readShort(input);       break;
+
+            case DATATYPE:
+            case TEXTTYPE:
+            case NODETYPE:
+            case BOXTYPE:       element.dataType = readShort(input);    break;
+
+            case WIDTH:         element.width = readInt(input);         break;
+
+            case PATHTYPE:      element.pathType = readShort(input);    break;
+
+            case BGNEXTN:       element.beginExtension = readInt(input); break;
+
+            case ENDEXTN:       element.endExtension = readInt(input);  break;
+
+            case STRANS:        element.strans = readShort(input);      break;
+
+            case MAG:           element.mag = readDouble(input);        break;
+
+            case ANGLE:         element.angle = readDouble(input);      break;
+
+            case PRESENTATION:  element.presentation = readShort(input); break;
+
+            case ELFLAGS:       element.elementFlags = readShort(input); break;
+
+            case PLEX:          element.plex = readInt(input);          break;
+
+            case COLROW:
+                element.columns = readShort(input);
+                element.rows = readShort(input + 2);
+                break;
+
+            case SNAME:
+            case STRING: {
+                unsigned int name = addElementString(input, length);
+                spans.back().name = name;
+                element.nameLength = elementStrings.size() - name;
+                break;
+            }
+
+            case XY: {
+                // Decoded straight to where the element will point.  The
+                // points before are only copied when the buffer grows.
+                unsigned int count = length / 8;
+
+                if(elementPoints + count>coordinates.capacity()) {
+                    coordinates.reserve(elementPoints + count, elementPoints);
+                }
+
+                decodeXY(input, coordinates.x() + elementPoints,
+                         coordinates.y() + elementPoints, count);
+                elementPoints += count;
+                break;
+            }
+
+            case PROPATTR: {
+                gdsElementProperty property = { (unsigned short)
+                                                readShort(input), "", 0 };
+                elementProperties.push_back(property);
+                propertyValues.push_back(0);
+                break;
+            }
+
+            case PROPVALUE:
+                if(elementProperties.size()>spans.back().firstProperty) {
+                    unsigned int value = addElementString(input, length);
+                    propertyValues.back() = value;
+                    elementProperties.back().length =
+                        elementStrings.size() - value;
+                }
+
+                break;
+
+            case ENDEL: {
+                const elementSpan &span = spans.back();
+                element.count = elementPoints - span.firstPoint;
+                element.propertyCount = elementProperties.size() -
+                                        span.firstProperty;
+                elementOpen = false;
+
+                if(elements.size()>=elementBatch) {
+                    flushElements();
+                }
+
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::flushElements()
+    {
+        for(size_t i=0; i<elementProperties.size(); ++i) {
+            if(propertyValues[i]!=0) {
+                elementProperties[i].value =
+                    &elementStrings[propertyValues[i] - 1];
+            }
+        }
+
+        for(size_t i=0; i<elements.size(); ++i) {
+            gdsElement &element = elements[i];
+            const elementSpan &span = spans[i];
+            element.x = coordinates.x() + span.firstPoint;
+            element.y = coordinates.y() + span.firstPoint;
+            element.properties = elementProperties.data() +
+                                 span.firstProperty;
+
+            if(span.name!=0) {
+                element.name = &elementStrings[span.name - 1];
+            } else {
+                element.name = "";
+            }
+        }
+
+        if constexpr(has_onParsedElements<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+            handler().onParsedElements(elements.data(), elements.size());
+        } else if constexpr(has_onParsedElement<Handler>::value) {
+            gdsCallbackTimer timer(stats);
+
+            for(size_t i=0; i<elements.size(); ++i) {
+                handler().onParsedElement(elements[i]);
+            }
+        }
+
+        elements.clear();
+        spans.clear();
+        elementPoints = 0;
+        elementStrings.clear();
+        elementProperties.clear();
+        propertyValues.clear();
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::resetState()
+    {
+        skippingElement = false;
+        pendingElement = 0;
+        elementOpen = false;
+        elements.clear();
+        spans.clear();
+        elementPoints = 0;
+        elementStrings.clear();
+        elementProperties.clear();
+        propertyValues.clear();
+    }
+
+    template<class Handler>
+    inline void basic_gdsFileParser<Handler>::parseRecord(
+        const gdsRecord &record)
+    {
+        if(stats!=NULL) {
+            parseCounted(record);
+        } else {
+            dispatchRecord(record);
+        }
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::parseCounted(const gdsRecord &record)
+    {
+        unsigned char type = record.recordType;
+        unsigned int length = 4 + record.length;
+        ++stats->records[type];
+        stats->bytes[type] += length;
+
+        if(length>stats->maxRecordLength) {
+            stats->maxRecordLength = length;
+        }
+
+        if(isElementStart(type)) {
+            statsElement = type;
+        } else if(type==XY) {
+            stats->points[statsElement] += record.length / 8;
+        } else if(type==BGNSTR) {
+            ++stats->structures;
+        }
+
+        double callbacks = stats->callbackSeconds;
+        double start = gdsParseStats::now();
+        dispatchRecord(record);
+        stats->decodeSeconds += gdsParseStats::now() - start -
+                                (stats->callbackSeconds - callbacks);
+    }
+
+    template<class Handler>
+    inline void basic_gdsFileParser<Handler>::dispatchRecord(
+        const gdsRecord &record)
+    {
+        unsigned char type = record.recordType;
+
+        if(skippingElement) {
+            skippingElement = type!=ENDEL;
+        } else if(filtering &&
+                  filterRecord(type, record.data, record.length)) {
+            // Held back or dropped by the layer filter.
+        } else if(type<64 && (subscribed & (1ULL<<type))) {
+            parseBuffer(type, record.data, record.length);
+        } else {
+            skippingElement = isElementStart(type);
+        }
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseRecords(
+        gdsRecordReader *reader, unsigned long long end)
+    {
+        gdsRecord record;
+        int status;
+        resetState();
+
+        while((status = reader->next(&record))>0) {
+            parseRecord(record);
+
+            if(record.offset + record.length + 4>=end) {
+                break;
+            }
+        }
+
+        if(status<0) {
+            std::cerr << "Error: malformed record at offset "
+                      << record.offset << "." << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parse(const char *filePath)
+    {
+        gdsSniffedFile file;
+
+        if(gdsDecompressor::sniff(filePath, &file)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            return 1;
+        }
+
+        if(file.format!=GDS_UNCOMPRESSED) {
+            return parseCompressed(file);
+        }
+
+        if(!file.regular) {
+            return parseStream(file);
+        }
+
+        if(readAheadBlock>0) {
+            return parseReadAhead(file.fd);
+        }
+
+        gdsRecordReader reader;
+        int result;
+
+        if(reader.open(file.fd)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            result = 1;
+        } else {
+            result = parseRecords(&reader, ~0ULL);
+        }
+
+        reader.close();
+        ::close(file.fd);
+        return result;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseCompressed(
+        const gdsSniffedFile &file)
+    {
+        gdsDecompressor input;
+
+        if(input.open(file.fd, file.format, file.head, file.length)!=0) {
+            std::cerr << "Error: cannot decompress the file";
+
+            if(file.format==GDS_ZSTD) {
+                std::cerr << ", zstd support is not built in";
+            }
+
+            std::cerr << "." << std::endl;
+            return 1;
+        }
+
+        const unsigned char *data;
+        size_t length;
+        int status;
+
+        while((status = input.next(&data, &length))>0 && !streamEnded) {
+            if(feed(data, length)!=0) {
+                break;
+            }
+        }
+
+        int result = finish();
+
+        if(status<0) {
+            std::cerr << "Error: the compressed data is corrupt."
+                      << std::endl;
+            result = 1;
+        }
+
+        return result;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseReadAhead(int fd)
+    {
+        gdsReadAhead input;
+
+        if(input.open(fd, readAheadBlock, readAheadDirect)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            return 1;
+        }
+
+        const unsigned char *data;
+        size_t length;
+        int status;
+
+        while((status = input.next(&data, &length))>0 && !streamEnded) {
+            if(feed(data, length)!=0) {
+                break;
+            }
+        }
+
+        int result = finish();
+
+        if(status<0) {
+            std::cerr << "Error: cannot read the file." << std::endl;
+            result = 1;
+        }
+
+        return result;
+    }
+
+    // A pipe or device, whose first bytes sniff() has already consumed, so
+    // they go through feed() ahead of the rest.
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseStream(const gdsSniffedFile &file)
+    {
+        std::vector<unsigned char> block(1<<20);
+        ssize_t count = 0;
+
+        if(feed(file.head, file.length)==0) {
+            while(!streamEnded) {
+                count = read(file.fd, &block[0], block.size());
+
+                if(count<0 && errno==EINTR) {
+                    continue;
+                }
+
+                if(count<=0 || feed(&block[0], count)!=0) {
+                    break;
+                }
+            }
+        }
+
+        ::close(file.fd);
+        int result = finish();
+
+        if(count<0) {
+            std::cerr << "Error: cannot read the file." << std::endl;
+            result = 1;
+        }
+
+        return result;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parse(int fd)
+    {
+        gdsRecordReader reader;
+
+        if(reader.open(fd)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            return 1;
+        }
+
+        return parseRecords(&reader, ~0ULL);
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parse(const void *data, size_t size)
+    {
+        gdsRecordReader reader;
+        reader.open(data, size);
+        return parseRecords(&reader, ~0ULL);
+    }
+
+    template<class Handler>
+    void basic_gdsFileParser<Handler>::feedRecord(const unsigned char *input,
+                                                  unsigned int length)
+    {
+        gdsRecord record;
+        record.data = input + 4;
+        record.length = length - 4;
+        record.recordType = input[2];
+        record.dataType = input[3];
+        record.offset = streamOffset;
+        parseRecord(record);
+        streamOffset += length;
+    }
+
+    // A zero length record ends the stream like it ends a file, anything
+    // else shorter than a record header is malformed.
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::streamError(unsigned int recordLength)
+    {
+        if(recordLength==0) {
+            streamEnded = true;
+            return 0;
+        }
+
+        streamFailed = true;
+        std::cerr << "Error: malformed record at offset " << streamOffset
+                  << "." << std::endl;
+        return 1;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::feed(const void *data, size_t length)
+    {
+        const unsigned char *p = (const unsigned char *)data;
+        const unsigned char *end = p + length;
+
+        if(!streaming) {
+            resetState();
+            carry.clear();
+            streamOffset = 0;
+            streaming = true;
+            streamEnded = false;
+            streamFailed = false;
+        }
+
+        if(streamFailed) {
+            return 1;
+        }
+
+        if(streamEnded) {
+            return 0;   // Padding after the end of the library.
+        }
+
+        // First complete the record left over from the previous chunk.
+        if(!carry.empty()) {
+            while(carry.size()<2 && p<end) {
+                carry.push_back(*p++);
+            }
+
+            if(carry.size()<2) {
+                return 0;
+            }
+
+            unsigned int recordLength = (carry[0]<<8) | carry[1];
+
+            if(recordLength<4) {
+                carry.clear();
+                return streamError(recordLength);
+            }
+
+            size_t take = recordLength - carry.size();
+
+            if(take>(size_t)(end - p)) {
+                take = end - p;
+            }
+
+            carry.insert(carry.end(), p, p + take);
+            p += take;
+
+            if(carry.size()<recordLength) {
+                return 0;
+            }
+
+            feedRecord(&carry[0], recordLength);
+            carry.clear();
+        }
+
+        while(end - p>=2) {
+            unsigned int recordLength = (p[0]<<8) | p[1];
+
+            if(recordLength<4) {
+                return streamError(recordLength);
+            }
+
+            if((size_t)(end - p)<recordLength) {
+                break;
+            }
+
+            feedRecord(p, recordLength);
+            p += recordLength;
+        }
+
+        carry.assign(p, end);
+        return 0;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::finish()
+    {
+        bool truncated = !carry.empty() && !streamEnded && !streamFailed;
+        bool failed = streamFailed;
+        carry.clear();
+        streaming = false;
+        streamEnded = false;
+        streamFailed = false;
+
+        if(truncated) {
+            std::cerr << "Error: malformed record at offset "
+                      << streamOffset << "." << std::endl;
+            return 1;
+        }
+
+        return failed ? 1 : 0;
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseStructure(
+        const char *filePath, const char *strName)
+    {
+        gdsStructureIndex index;
+
+        if(index.open(filePath, false)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            return 1;
+        }
+
+        return parseStructure(filePath, index, strName);
+    }
+
+    template<class Handler>
+    int basic_gdsFileParser<Handler>::parseStructure(
+        const char *filePath, const gdsStructureIndex &index,
+        const char *strName)
+    {
+        const gdsStructureEntry *entry = index.find(strName);
+
+        if(entry==NULL) {
+            std::cerr << "Error: structure " << strName
+                      << " is not in the index." << std::endl;
+            return 1;
+        }
+
+        gdsRecordReader reader;
+
+        if(reader.open(filePath)!=0 || reader.seek(entry->offset)!=0) {
+            std::cerr << "Error: something is wrong with the file."
+                      << std::endl;
+            return 1;
+        }
+
+        return parseRecords(&reader, entry->offset + entry->length);
+    }
+} // End namespace gdsfp
+
+#endif //GDSBASICFILEPARSER_H_
@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsBatchParser.h"
+#include "gdsFileParser.h"
+#include "gdsParseStats.h"
+#include "gdsThreadCount.h"
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+namespace gdsfp
+{
+    gdsBatchParser::gdsBatchParser(unsigned int threads)
+        : threads(gdsThreadCount(threads))
+    {
+    }
+
+    unsigned int gdsBatchParser::threadCount() const
+    {
+        return threads;
+    }
+
+    const vector<gdsBatchResult> &gdsBatchParser::results() const
+    {
+        return outcomes;
+    }
+
+    int gdsBatchParser::readList(const char *listPath, vector<string> *paths)
+    {
+        ifstream list(listPath);
+
+        if(!list) {
+            return 1;
+        }
+
+        string line;
+
+        while(getline(list, line)) {
+            size_t first = line.find_first_not_of(" \t\r");
+            size_t last = line.find_last_not_of(" \t\r");
+
+            if(first==string::npos || line[first]=='#') {
+                continue;
+            }
+
+            paths->push_back(line.substr(first, last - first + 1));
+        }
+
+        return list.bad() ? 1 : 0;
+    }
+
+    int gdsBatchParser::parse(const vector<string> &paths, gdsBatchJob *job)
+    {
+        gdsBatchResult empty = { 0, 0, 0, 0 };
+        outcomes.assign(paths.size(), empty);
+
+        // Largest first; files that can't be looked at go last and fail in
+        // parse() with its usual message.
+        vector<size_t> order(paths.size());
+
+        for(size_t i=0; i<paths.size(); ++i) {
+            struct stat info;
+            order[i] = i;
+
+            if(stat(paths[i].c_str(), &info)==0) {
+                outcomes[i].bytes = info.st_size;
+            }
+        }
+
+        stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return outcomes[a].bytes>outcomes[b].bytes;
+        });
+
+        atomic<size_t> next(0);
+        atomic<bool> failed(false);
+        unsigned int workers = min<size_t>(threads, paths.size());
+
+        auto work = [&](unsigned int thread) {
+            size_t n;
+
+            while((n = next.fetch_add(1))<order.size()) {
+                size_t file = order[n];
+                gdsBatchResult &result = outcomes[file];
+                gdsFileParser *parser = job->createParser(thread, file);
+                double start = gdsParseStats::now();
+                result.status = parser!=NULL ? parser->parse(
+                                                   paths[file].c_str()) : 1;
+                result.seconds = gdsParseStats::now() - start;
+                result.thread = thread;
+
+                if(result.status!=0) {
+                    failed = true;
+                }
+
+                job->onFileParsed(thread, file, parser, result);
+            }
+        };
+
+        vector<std::thread> pool;
+
+        for(unsigned int t=1; t<workers; ++t) {
+            pool.push_back(std::thread(work, t));
+        }
+
+        if(workers>0) {
+            work(0);
+        }
+
+        for(size_t t=0; t<pool.size(); ++t) {
+            pool[t].join();
+        }
+
+        return failed ? 1 : 0;
+    }
+} // End namespace gdsfp
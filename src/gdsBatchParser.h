@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSBATCHPARSER_H_
+#define GDSBATCHPARSER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gdsfp
+{
+    class gdsFileParser;
+
+    // Outcome of one file of a batch.
+    struct gdsBatchResult {
+        int status;                     // What gdsFileParser::parse returned.
+        unsigned long long bytes;       // Size of the file.
+        double seconds;                 // Wall time of its parse.
+        unsigned int thread;            // Worker that parsed it.
+    };
+
+    /*
+     *  Supplies one handler per file of a batch.  Both calls are made on the
+     *  worker that parses the file, from all workers at once; thread is the
+     *  index of that worker, from 0 to gdsBatchParser::threadCount() - 1,
+     *  so a job can keep per thread state without locking.  onFileParsed()
+     *  gets the handler back once its file is done and is where it is
+     *  deleted or reused.
+     */
+    class gdsBatchJob
+    {
+    public:
+        virtual ~gdsBatchJob() {};
+        virtual gdsFileParser *createParser(unsigned int thread,
+                                            size_t file) = 0;
+        virtual void onFileParsed(unsigned int thread, size_t file,
+                                  gdsFileParser *parser,
+                                  const gdsBatchResult &result) = 0;
+    };
+
+    /*
+     *  Parses many files at once on a fixed number of threads, each with
+     *  its own handler, to keep every core busy on batches of small and
+     *  medium files that a single parse can't spread out.  Files are
+     *  started largest first so that a big file at the end of the list
+     *  doesn't leave one worker running on its own.
+     *
+     *      gdsBatchParser batch(8);
+     *      batch.parse(paths, &job);
+     *      const std::vector<gdsBatchResult> &results = batch.results();
+     */
+    class gdsBatchParser
+    {
+    public:
+        // The thread count goes through gdsThreadCount().
+        explicit gdsBatchParser(unsigned int threads = 0);
+
+        // Returns 0 when every file was parsed and 1 when any failed.
+        int parse(const std::vector<std::string> &paths, gdsBatchJob *job);
+
+        // By file, in the order of the paths.
+        const std::vector<gdsBatchResult> &results() const;
+        unsigned int threadCount() const;
+
+        // Adds the paths of a list file, one per line.  Blank lines and
+        // lines starting with # are skipped.
+        static int readList(const char *listPath,
+                            std::vector<std::string> *paths);
+
+    private:
+        unsigned int threads;
+        std::vector<gdsBatchResult> outcomes;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSBATCHPARSER_H_
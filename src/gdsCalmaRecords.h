@@ -37,6 +37,8 @@
 #ifndef GDSCALMARECORDS_H_
 #define GDSCALMARECORDS_H_
 
+#include <cstddef>
+
 namespace gdsfp
 {
     /*
@@ -227,6 +229,28 @@ namespace gdsfp
                                        library. Had 1 to 32 entries with group
                                        numbers, user numbers and access rights. */
     };
+
+    /*
+     *  Name of a record type as spelled above, or NULL for an unknown type.
+     */
+    inline const char *recordTypeName(unsigned char type)
+    {
+        static const char *const names[] = {
+            "HEADER", "BGNLIB", "LIBNAME", "UNITS", "ENDLIB", "BGNSTR",
+            "STRNAME", "ENDSTR", "BOUNDARY", "PATH", "SREF", "AREF", "TEXT",
+            "LAYER", "DATATYPE", "WIDTH", "XY", "ENDEL", "SNAME", "COLROW",
+            "TEXTNODE", "NODE", "TEXTTYPE", "PRESENTATION", "SPACING",
+            "STRING", "STRANS", "MAG", "ANGLE", "UINTEGER", "USTRING",
+            "REFLIBS", "FONTS", "PATHTYPE", "GENERATIONS", "ATTRTABLE",
+            "STYPTABLE", "STRTYPE", "ELFLAGS", "ELKEY", "LINKTYPE",
+            "LINKKEYS", "NODETYPE", "PROPATTR", "PROPVALUE", "BOX", "BOXTYPE",
+            "PLEX", "BGNEXTN", "ENDEXTN", "TAPENUM", "TAPECODE", "STRCLASS",
+            "RESERVED", "FORMAT", "MASK", "ENDMASKS", "LIBDIRSIZE", "SRFNAME",
+            "LIBSECUR"
+        };
+
+        return type<sizeof(names) / sizeof(names[0]) ? names[type] : NULL;
+    }
 } // End namespace gdsfp
 
 #endif // GDSCALMARECORDS_H_
@@ -0,0 +1,408 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsDecompressor.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <zlib.h>
+
+#ifdef GDSFP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace gdsfp
+{
+    static const size_t BUFFER_SIZE = 1<<20;
+    static const size_t INPUT_SIZE = 256<<10;
+
+    gdsDecompressor::gdsDecompressor()
+        : fd(-1), format(GDS_UNCOMPRESSED), head(0), tail(0), count(0),
+          holding(false), done(false), failed(false), stopping(false)
+    {
+        for(int i=0; i<RING_SIZE; ++i) {
+            ring[i].data = NULL;
+            ring[i].length = 0;
+        }
+    }
+
+    gdsDecompressor::~gdsDecompressor()
+    {
+        close();
+    }
+
+    gdsCompression gdsDecompressor::detect(const unsigned char *magic,
+                                           size_t length)
+    {
+        if(length>=2 && magic[0]==0x1f && magic[1]==0x8b) {
+            return GDS_GZIP;
+        }
+
+        if(length>=4 && magic[0]==0x28 && magic[1]==0xb5 &&
+           magic[2]==0x2f && magic[3]==0xfd) {
+            return GDS_ZSTD;
+        }
+
+        return GDS_UNCOMPRESSED;
+    }
+
+    int gdsDecompressor::sniff(const char *filePath, gdsSniffedFile *file)
+    {
+        file->fd = ::open(filePath, O_RDONLY);
+        file->length = 0;
+
+        if(file->fd<0) {
+            return 1;
+        }
+
+        struct stat info;
+        file->regular = fstat(file->fd, &info)==0 && S_ISREG(info.st_mode);
+        size_t got = 0;
+
+        while(got<sizeof(file->head)) {
+            ssize_t count;
+
+            if(file->regular) {
+                count = pread(file->fd, file->head + got,
+                              sizeof(file->head) - got, got);
+            } else {
+                count = read(file->fd, file->head + got,
+                             sizeof(file->head) - got);
+            }
+
+            if(count<0 && errno==EINTR) {
+                continue;
+            }
+
+            if(count<=0) {
+                break;
+            }
+
+            got += count;
+        }
+
+        file->format = detect(file->head, got);
+
+        if(!file->regular) {
+            file->length = got;
+        }
+
+        return 0;
+    }
+
+    int gdsDecompressor::open(const char *filePath)
+    {
+        gdsSniffedFile file;
+
+        if(sniff(filePath, &file)!=0) {
+            close();
+            return 1;
+        }
+
+        return open(file.fd, file.format, file.head, file.length);
+    }
+
+    int gdsDecompressor::open(int fd, gdsCompression format,
+                              const unsigned char *consumed,
+                              size_t length)
+    {
+        close();
+        this->fd = fd;
+        this->format = format;
+
+#ifndef GDSFP_HAVE_ZSTD
+        if(format==GDS_ZSTD) {
+            close();
+            return 1;
+        }
+#endif
+
+        if(format==GDS_UNCOMPRESSED || fd<0) {
+            close();
+            return 1;
+        }
+
+        prefix.assign(consumed, consumed + length);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        for(int i=0; i<RING_SIZE; ++i) {
+            ring[i].data = (unsigned char *)malloc(BUFFER_SIZE);
+
+            if(ring[i].data==NULL) {
+                close();
+                return 1;
+            }
+        }
+
+        worker = std::thread(&gdsDecompressor::run, this);
+        return 0;
+    }
+
+    void gdsDecompressor::close()
+    {
+        if(worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            emptied.notify_all();
+            worker.join();
+        }
+
+        for(int i=0; i<RING_SIZE; ++i) {
+            free(ring[i].data);
+            ring[i].data = NULL;
+        }
+
+        if(fd>=0) {
+            ::close(fd);
+            fd = -1;
+        }
+
+        prefix.clear();
+        head = tail = count = 0;
+        holding = done = failed = stopping = false;
+    }
+
+    // The bytes sniff() consumed come first.
+    ssize_t gdsDecompressor::readInput(unsigned char *data, size_t size)
+    {
+        if(prefix.empty()) {
+            return read(fd, data, size);
+        }
+
+        size_t count = prefix.size()<size ? prefix.size() : size;
+        memcpy(data, &prefix[0], count);
+        prefix.erase(prefix.begin(), prefix.begin() + count);
+        return count;
+    }
+
+    int gdsDecompressor::next(const unsigned char **data, size_t *length)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if(holding) {
+            tail = (tail + 1) % RING_SIZE;
+            --count;
+            holding = false;
+            emptied.notify_one();
+        }
+
+        while(count==0 && !done && !failed) {
+            filled.wait(lock);
+        }
+
+        if(count==0) {
+            return failed ? -1 : 0;
+        }
+
+        (*data) = ring[tail].data;
+        (*length) = ring[tail].length;
+        holding = true;
+        return 1;
+    }
+
+    // Waits for a free buffer, or returns NULL when the reader went away.
+    unsigned char *gdsDecompressor::acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(count==RING_SIZE && !stopping) {
+            emptied.wait(lock);
+        }
+
+        return stopping ? NULL : ring[head].data;
+    }
+
+    void gdsDecompressor::publish(size_t length)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ring[head].length = length;
+            head = (head + 1) % RING_SIZE;
+            ++count;
+        }
+
+        filled.notify_one();
+    }
+
+    void gdsDecompressor::run()
+    {
+        int status = format==GDS_GZIP ? inflateGzip() : inflateZstd();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            failed = status!=0;
+        }
+
+        filled.notify_one();
+    }
+
+    int gdsDecompressor::inflateGzip()
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+
+        // 15 + 32 accepts both the gzip and the zlib header.
+        if(inflateInit2(&stream, 15 + 32)!=Z_OK) {
+            return 1;
+        }
+
+        std::vector<unsigned char> input(INPUT_SIZE);
+        unsigned char *output = acquire();
+        bool eof = false;
+        bool ended = false;
+        int result = 0;
+
+        stream.next_out = output;
+        stream.avail_out = BUFFER_SIZE;
+
+        while(output!=NULL) {
+            if(stream.avail_in==0 && !eof) {
+                ssize_t got = readInput(&input[0], INPUT_SIZE);
+
+                if(got<0 && errno==EINTR) {
+                    continue;
+                }
+
+                if(got<0) {
+                    result = 1;
+                    break;
+                }
+
+                eof = got==0;
+                stream.next_in = &input[0];
+                stream.avail_in = got;
+            }
+
+            if(ended) {
+                if(stream.avail_in==0) {
+                    if(eof) {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                inflateReset(&stream);  // Another gzip member follows.
+                ended = false;
+            }
+
+            int status = inflate(&stream, Z_NO_FLUSH);
+
+            if(status==Z_STREAM_END) {
+                ended = true;
+            } else if(status==Z_BUF_ERROR && eof && stream.avail_in==0) {
+                result = 1;             // Truncated.
+                break;
+            } else if(status!=Z_OK && status!=Z_BUF_ERROR) {
+                result = 1;
+                break;
+            }
+
+            if(stream.avail_out==0) {
+                publish(BUFFER_SIZE);
+                output = acquire();
+                stream.next_out = output;
+                stream.avail_out = BUFFER_SIZE;
+            }
+        }
+
+        if(output!=NULL && stream.avail_out<BUFFER_SIZE) {
+            publish(BUFFER_SIZE - stream.avail_out);
+        }
+
+        inflateEnd(&stream);
+        return result;
+    }
+
+    int gdsDecompressor::inflateZstd()
+    {
+#ifdef GDSFP_HAVE_ZSTD
+        ZSTD_DStream *stream = ZSTD_createDStream();
+
+        if(stream==NULL) {
+            return 1;
+        }
+
+        ZSTD_initDStream(stream);
+        std::vector<unsigned char> input(INPUT_SIZE);
+        ZSTD_inBuffer in = { &input[0], 0, 0 };
+        ZSTD_outBuffer out = { acquire(), BUFFER_SIZE, 0 };
+        size_t remaining = 0;   // Non zero inside an unfinished frame.
+        bool eof = false;
+        int result = 0;
+
+        while(out.dst!=NULL) {
+            if(in.pos==in.size && !eof) {
+                ssize_t got = readInput(&input[0], INPUT_SIZE);
+
+                if(got<0 && errno==EINTR) {
+                    continue;
+                }
+
+                if(got<0) {
+                    result = 1;
+                    break;
+                }
+
+                eof = got==0;
+                in.size = got;
+                in.pos = 0;
+            }
+
+            remaining = ZSTD_decompressStream(stream, &out, &in);
+
+            if(ZSTD_isError(remaining)) {
+                result = 1;
+                break;
+            }
+
+            if(out.pos==out.size) {
+                publish(BUFFER_SIZE);
+                out.dst = acquire();
+                out.pos = 0;
+            } else if(eof && in.pos==in.size) {
+                result = remaining!=0;  // Truncated when still inside a frame.
+                break;
+            }
+        }
+
+        if(out.dst!=NULL && out.pos>0) {
+            publish(out.pos);
+        }
+
+        ZSTD_freeDStream(stream);
+        return result;
+#else
+        return 1;
+#endif
+    }
+} // End namespace gdsfp
@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSDECOMPRESSOR_H_
+#define GDSDECOMPRESSOR_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+namespace gdsfp
+{
+    enum gdsCompression {
+        GDS_UNCOMPRESSED,
+        GDS_GZIP,
+        GDS_ZSTD
+    };
+
+    // A file opened by gdsDecompressor::sniff().  The magic bytes of a
+    // regular file are read in place.  Those of a pipe or device are
+    // consumed, so the first length bytes of the stream are in head.
+    struct gdsSniffedFile {
+        int fd;
+        bool regular;
+        gdsCompression format;
+        unsigned char head[4];
+        size_t length;
+    };
+
+    /*
+     *  Streams a gzip or zstd compressed GDSII file.  A worker thread reads
+     *  and inflates the file into a small ring of buffers while the caller
+     *  consumes the filled ones, so decompression and decoding overlap.
+     *  Concatenated gzip members are read as one stream.  zstd support is
+     *  compiled in with GDSFP_HAVE_ZSTD (make ZSTD=1).
+     *
+     *      gdsDecompressor input;
+     *      input.open("chip.gds.gz");
+     *      while(input.next(&data, &length)>0) { ... }
+     */
+    class gdsDecompressor
+    {
+    public:
+        gdsDecompressor();
+        ~gdsDecompressor();
+
+        // Looks at the magic bytes at the start of a stream.
+        static gdsCompression detect(const unsigned char *magic,
+                                     size_t length);
+        // Opens the file once and looks at its magic bytes, so that a named
+        // pipe works too.  The caller closes file->fd.
+        static int sniff(const char *filePath, gdsSniffedFile *file);
+
+        int open(const char *filePath);
+        // Takes over a descriptor holding a stream of the given format, also
+        // when it fails.  Bytes at the start of the stream that were
+        // already read from the descriptor are passed in consumed.
+        int open(int fd, gdsCompression format,
+                 const unsigned char *consumed = NULL, size_t length = 0);
+        void close();
+
+        // Returns 1 with the next piece of decompressed data, 0 at the end
+        // of the stream and -1 when the input is corrupt.  The data stays
+        // valid until the following call.
+        int next(const unsigned char **data, size_t *length);
+
+    private:
+        gdsDecompressor(const gdsDecompressor &);
+        gdsDecompressor &operator=(const gdsDecompressor &);
+
+        static const int RING_SIZE = 4;
+
+        struct slot {
+            unsigned char *data;
+            size_t length;
+        };
+
+        void run();
+        int inflateGzip();
+        int inflateZstd();
+        unsigned char *acquire();
+        void publish(size_t length);
+        ssize_t readInput(unsigned char *data, size_t size);
+
+        int fd;
+        gdsCompression format;
+        std::vector<unsigned char> prefix;  // Read before the descriptor.
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable filled;
+        std::condition_variable emptied;
+        slot ring[RING_SIZE];
+        unsigned int head;      // Next slot the worker fills.
+        unsigned int tail;      // Next slot the reader takes.
+        unsigned int count;     // Filled slots, including the one in use.
+        bool holding;           // The reader still uses the slot at tail.
+        bool done;
+        bool failed;
+        bool stopping;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSDECOMPRESSOR_H_
@@ -0,0 +1,1114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsDensityMap.h"
+#include "gdsCalmaRecords.h"
+#include "gdsThreadCount.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+namespace gdsfp
+{
+    static const char DENSITY_MAGIC[16] = "gdsfp-density";
+    static const uint32_t DENSITY_VERSION = 1;
+    static const uint32_t DENSITY_BYTE_ORDER = 0x01020304;
+
+    // Beyond this many tiles over all layers, a gigabyte of areas, the
+    // grid is refused.
+    static const unsigned long long MAX_TILES = 1ULL<<27;
+    // Instances of structures that span up to this many tiles are stamped
+    // from footprints, of which a band keeps up to MAX_FOOTPRINT_CELLS
+    // areas, 32 megabytes.
+    static const long long FOOTPRINT_TILES = 64;
+    static const size_t MAX_FOOTPRINT_CELLS = 1<<22;
+    // Offsets from the tile grid are told apart down to 2^-32 tiles, far
+    // below the rounding of the placements.
+    static const double PHASE_STEPS = 4294967296.0;
+
+    struct point {
+        double x, y;
+    };
+
+    struct densityHeader {
+        char magic[16];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t layerCount;
+        uint32_t columns;
+        uint32_t rows;
+        uint32_t reserved;
+        double left;
+        double bottom;
+        double tileSize;
+        double databaseUnits;
+    };
+
+    // Part of the tile lattice that areas are added to, by absolute tile
+    // index: a band of the grid, or the footprint of a structure.
+    struct densityTarget {
+        double *cells;                  // Of the first slot.
+        size_t stride;                  // From one slot to the next.
+        long long column0;              // Tile of cells[0].
+        long long row0;
+        long long columns;              // Per row of cells.
+        long long firstColumn;          // Tiles that may be written.
+        long long lastColumn;
+        long long firstRow;
+        long long lastRow;
+    };
+
+    // A structure placed with the same linear transform at the same
+    // offset from the tile grid covers the tiles around its origin in the
+    // same way.
+    struct footprintKey {
+        uint32_t structure;
+        double a, b, c, d;
+        long long phaseX;
+        long long phaseY;
+
+        bool operator==(const footprintKey &other) const
+        {
+            return structure==other.structure && a==other.a &&
+                   b==other.b && c==other.c && d==other.d &&
+                   phaseX==other.phaseX && phaseY==other.phaseY;
+        };
+    };
+
+    struct footprintHash {
+        size_t operator()(const footprintKey &key) const
+        {
+            uint64_t words[7];
+            words[0] = key.structure;
+            memcpy(&words[1], &key.a, sizeof(double));
+            memcpy(&words[2], &key.b, sizeof(double));
+            memcpy(&words[3], &key.c, sizeof(double));
+            memcpy(&words[4], &key.d, sizeof(double));
+            words[5] = key.phaseX;
+            words[6] = key.phaseY;
+            uint64_t hash = 14695981039346656037ULL;
+
+            for(int i=0; i<7; ++i) {
+                hash = (hash ^ words[i]) * 1099511628211ULL;
+            }
+
+            return hash ^ (hash>>32);
+        };
+    };
+
+    // Areas per slot of the structure, row and column, from the tile of
+    // the placement origin offset by column and row.
+    struct footprint {
+        long long column;
+        long long row;
+        long long columns;
+        long long rows;
+        vector<double> cells;
+    };
+
+    // The tile rows of one task, and the scratch space of the thread that
+    // works on it.
+    struct gdsDensityMap::band {
+        unsigned int firstRow;
+        unsigned int lastRow;
+        densityTarget grid;
+        densityTarget *out;             // The grid or a footprint.
+        unordered_map<footprintKey, footprint, footprintHash> footprints;
+        size_t footprintCells;
+        vector<point> points;           // Outlines of one shape.
+        vector<uint32_t> sizes;         // Points per outline.
+        vector<point> polygon;          // Placed outline.
+        vector<point> strip;            // Clipped to a tile row.
+        vector<point> piece;            // Clipped to a tile.
+        vector<point> scratch;
+    };
+
+    // Shoelace area, with the points taken relative to the first one to
+    // keep the products small.
+    static double polygonArea(const point *p, size_t count)
+    {
+        if(count<3) {
+            return 0.0;
+        }
+
+        double sum = 0.0;
+        double x0 = p[0].x, y0 = p[0].y;
+
+        for(size_t i=1; i + 1<count; ++i) {
+            sum += (p[i].x - x0) * (p[i + 1].y - y0) -
+                   (p[i + 1].x - x0) * (p[i].y - y0);
+        }
+
+        return fabs(sum) / 2.0;
+    }
+
+    // One Sutherland-Hodgman step against an axis parallel line, keeping
+    // the side above value (or below it with keepAbove false).  Concave
+    // polygons may come out with degenerate edges, which add no area.
+    static void clip(const vector<point> &in, vector<point> *out, bool alongX,
+                     double value, bool keepAbove)
+    {
+        out->clear();
+        size_t count = in.size();
+
+        for(size_t i=0; i<count; ++i) {
+            const point &a = in[i];
+            const point &b = in[(i + 1) % count];
+            double va = alongX ? a.x : a.y;
+            double vb = alongX ? b.x : b.y;
+            bool ina = keepAbove ? va>=value : va<=value;
+            bool inb = keepAbove ? vb>=value : vb<=value;
+
+            if(ina) {
+                out->push_back(a);
+            }
+
+            if(ina!=inb) {
+                double t = (value - va) / (vb - va);
+                point cut;
+
+                if(alongX) {
+                    cut.x = value;
+                    cut.y = a.y + t * (b.y - a.y);
+                } else {
+                    cut.x = a.x + t * (b.x - a.x);
+                    cut.y = value;
+                }
+
+                out->push_back(cut);
+            }
+        }
+    }
+
+    // The outlines of a shape: the ring of a BOUNDARY or BOX without its
+    // closing point, or one rectangle per segment of a PATH.
+    static void outline(const gdsLayer &layer, const gdsShape &shape,
+                        vector<point> *points, vector<uint32_t> *sizes)
+    {
+        points->clear();
+        sizes->clear();
+        const int *x = layer.x.data() + shape.firstPoint;
+        const int *y = layer.y.data() + shape.firstPoint;
+        uint32_t count = shape.pointCount;
+
+        if(shape.type==BOUNDARY || shape.type==BOX) {
+            if(count>1 && x[0]==x[count - 1] && y[0]==y[count - 1]) {
+                --count;
+            }
+
+            if(count<3) {
+                return;
+            }
+
+            for(uint32_t i=0; i<count; ++i) {
+                point p = { (double)x[i], (double)y[i] };
+                points->push_back(p);
+            }
+
+            sizes->push_back(count);
+            return;
+        }
+
+        if(shape.type!=PATH || shape.width==0 || count<2) {
+            return;
+        }
+
+        double half = fabs((double)shape.width) / 2.0;
+        double begin = 0.0, end = 0.0;
+
+        if(shape.pathType==1 || shape.pathType==2) {
+            begin = end = half;
+        } else if(shape.pathType==4) {
+            begin = shape.beginExtension;
+            end = shape.endExtension;
+        }
+
+        for(uint32_t i=0; i + 1<count; ++i) {
+            double dx = (double)x[i + 1] - x[i];
+            double dy = (double)y[i + 1] - y[i];
+            double length = sqrt(dx * dx + dy * dy);
+
+            if(length==0.0) {
+                continue;
+            }
+
+            double ux = dx / length, uy = dy / length;
+            double back = i==0 ? begin : 0.0;
+            double ahead = i + 2==count ? end : 0.0;
+            point s = { x[i] - ux * back, y[i] - uy * back };
+            point e = { x[i + 1] + ux * ahead, y[i + 1] + uy * ahead };
+            double nx = -uy * half, ny = ux * half;
+            point quad[4] = { { s.x + nx, s.y + ny }, { e.x + nx, e.y + ny },
+                              { e.x - nx, e.y - ny }, { s.x - nx, s.y - ny } };
+            points->insert(points->end(), quad, quad + 4);
+            sizes->push_back(4);
+        }
+    }
+
+    static void addToBox(gdsBox *box, const point &p)
+    {
+        double x = floor(p.x), y = floor(p.y);
+        double xr = ceil(p.x), yt = ceil(p.y);
+        box->add(x<INT_MIN ? INT_MIN : (int)x, y<INT_MIN ? INT_MIN : (int)y);
+        box->add(xr>INT_MAX ? INT_MAX : (int)xr,
+                 yt>INT_MAX ? INT_MAX : (int)yt);
+    }
+
+    static bool isRectangle(const vector<point> &p)
+    {
+        return p.size()==4 &&
+               ((p[0].x==p[1].x && p[1].y==p[2].y && p[2].x==p[3].x &&
+                 p[3].y==p[0].y) ||
+                (p[0].y==p[1].y && p[1].x==p[2].x && p[2].y==p[3].y &&
+                 p[3].x==p[0].x));
+    }
+
+    gdsDensityMap::gdsDensityMap(const gdsLibrary &library,
+                                 unsigned int threads)
+        : library(library), threads(gdsThreadCount(threads)),
+          tileMicrons(50.0), filtering(false), window(gdsBox::empty()),
+          columnCount(0), rowCount(0), originX(0.0), originY(0.0), tile(0.0)
+    {
+    }
+
+    void gdsDensityMap::setTileSize(double microns)
+    {
+        tileMicrons = microns;
+    }
+
+    void gdsDensityMap::setLayerFilter(const gdsLayerFilter &filter)
+    {
+        this->filter = filter;
+        filtering = true;
+    }
+
+    void gdsDensityMap::setWindow(const gdsBox &window)
+    {
+        this->window = window;
+    }
+
+    bool gdsDensityMap::counts(const gdsLayer &layer,
+                               const gdsShape &shape) const
+    {
+        return (shape.type==BOUNDARY || shape.type==BOX ||
+                shape.type==PATH) &&
+               (!filtering || filter.accepts(layer.number, shape.dataType));
+    }
+
+    int gdsDensityMap::compute(const char *strName)
+    {
+        uint32_t structure = library.findStructure(strName);
+
+        if(structure==GDS_NONE) {
+            cerr << "Error: structure " << strName
+                 << " is not in the library." << endl;
+            return 1;
+        }
+
+        return compute(structure);
+    }
+
+    int gdsDensityMap::compute(uint32_t structure)
+    {
+        const vector<gdsLayer> &layers = library.layers();
+        uint32_t structureCount = library.structures().length();
+
+        if(structure>=structureCount) {
+            return 1;
+        }
+
+        // One grid for every layer with a shape that counts.
+        vector<pair<unsigned short, uint32_t> > used;
+
+        for(size_t l=0; l<layers.size(); ++l) {
+            for(uint32_t s=0; s<layers[l].shapes.length(); ++s) {
+                if(counts(layers[l], layers[l].shapes[s])) {
+                    used.push_back(make_pair(layers[l].number, (uint32_t)l));
+                    break;
+                }
+            }
+        }
+
+        sort(used.begin(), used.end());
+        slots.assign(layers.size(), GDS_NONE);
+        numbers.clear();
+
+        for(size_t i=0; i<used.size(); ++i) {
+            slots[used[i].second] = i;
+            numbers.push_back(used[i].first);
+        }
+
+        boxes.assign(structureCount, gdsBox::empty());
+        areas.assign((size_t)structureCount * numbers.size(), 0.0);
+        present.assign(areas.size(), false);
+        vector<unsigned char> state(structureCount, 0);
+        measure(structure, &state);
+
+        // Most structures have shapes on a few of the layers only, and
+        // stamping them skips the others.
+        firstSlots.assign(structureCount + 1, 0);
+        slotLists.clear();
+
+        for(uint32_t i=0; i<structureCount; ++i) {
+            firstSlots[i] = slotLists.size();
+
+            for(size_t s=0; s<numbers.size(); ++s) {
+                if(present[(size_t)i * numbers.size() + s]) {
+                    slotLists.push_back(s);
+                }
+            }
+        }
+
+        firstSlots[structureCount] = slotLists.size();
+        present.clear();
+
+        double meters = library.databaseUnits()>0.0 ? library.databaseUnits()
+                                                    : 1e-9;
+        tile = tileMicrons * 1e-6 / meters;
+        gdsBox cover = window.isEmpty() ? boxes[structure] : window;
+        columnCount = rowCount = 0;
+        grid.clear();
+
+        if(!(tile>0.0)) {
+            cerr << "Error: the tile size must be positive." << endl;
+            return 1;
+        }
+
+        if(cover.isEmpty() || numbers.empty()) {
+            return 0;
+        }
+
+        originX = floor(cover.left / tile) * tile;
+        originY = floor(cover.bottom / tile) * tile;
+        double columns = floor((cover.right - originX) / tile) + 1.0;
+        double rows = floor((cover.top - originY) / tile) + 1.0;
+
+        if(columns * rows * numbers.size()>(double)MAX_TILES) {
+            cerr << "Error: a grid of " << columns << " by " << rows
+                 << " tiles on " << numbers.size() << " layers is too large."
+                 << endl;
+            return 1;
+        }
+
+        columnCount = (unsigned int)columns;
+        rowCount = (unsigned int)rows;
+        grid.assign(numbers.size() * rowCount * columnCount, 0.0);
+
+        // Several bands per thread even out the work when the layout is
+        // denser in some rows than in others.
+        unsigned int bandCount = min(rowCount, threads * 4);
+        vector<band> bands(bandCount);
+
+        for(unsigned int b=0; b<bandCount; ++b) {
+            band &work = bands[b];
+            work.firstRow = (unsigned long long)rowCount * b / bandCount;
+            work.lastRow =
+                (unsigned long long)rowCount * (b + 1) / bandCount - 1;
+            work.grid.cells = grid.data();
+            work.grid.stride = (size_t)rowCount * columnCount;
+            work.grid.column0 = 0;
+            work.grid.row0 = 0;
+            work.grid.columns = columnCount;
+            work.grid.firstColumn = 0;
+            work.grid.lastColumn = (long long)columnCount - 1;
+            work.grid.firstRow = work.firstRow;
+            work.grid.lastRow = work.lastRow;
+            work.out = &work.grid;
+            work.footprintCells = 0;
+        }
+
+        atomic<unsigned int> next(0);
+        vector<thread> workers;
+        unsigned int workerCount = min(threads, bandCount);
+
+        for(unsigned int t=0; t<workerCount; ++t) {
+            workers.push_back(thread([&]() {
+                unsigned int b;
+
+                while((b = next++)<bandCount) {
+                    expand(&bands[b], structure, gdsTransform::identity(), 0);
+                    unordered_map<footprintKey, footprint, footprintHash>()
+                        .swap(bands[b].footprints);
+                }
+            }));
+        }
+
+        for(size_t t=0; t<workers.size(); ++t) {
+            workers[t].join();
+        }
+
+        return 0;
+    }
+
+    // Box and area per layer of a structure with everything below it,
+    // children first.  A reference that closes a cycle adds nothing.
+    void gdsDensityMap::measure(uint32_t structure,
+                                vector<unsigned char> *state)
+    {
+        if((*state)[structure]!=0) {
+            return;
+        }
+
+        (*state)[structure] = 1;
+        const gdsStructure &cell = library.structures()[structure];
+        size_t slotCount = numbers.size();
+        double *area = areas.data() + (size_t)structure * slotCount;
+        gdsBox box = gdsBox::empty();
+        vector<point> points;
+        vector<uint32_t> sizes;
+
+        for(uint32_t r=0; r<cell.rangeCount; ++r) {
+            const gdsLayerRange &range = library.ranges()[cell.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+            uint32_t slot = slots[range.layer];
+
+            if(slot==GDS_NONE) {
+                continue;
+            }
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                const gdsShape &shape = layer.shapes[range.firstShape + s];
+
+                if(!counts(layer, shape)) {
+                    continue;
+                }
+
+                outline(layer, shape, &points, &sizes);
+                present[(size_t)structure * slotCount + slot] = true;
+                size_t first = 0;
+
+                for(size_t i=0; i<sizes.size(); ++i) {
+                    area[slot] += polygonArea(points.data() + first, sizes[i]);
+                    first += sizes[i];
+                }
+
+                for(size_t i=0; i<points.size(); ++i) {
+                    addToBox(&box, points[i]);
+                }
+            }
+        }
+
+        for(uint32_t i=0; i<cell.referenceCount; ++i) {
+            const gdsReference &reference =
+                library.references()[cell.firstReference + i];
+            uint32_t child = reference.structure;
+
+            if(child==GDS_NONE) {
+                continue;
+            }
+
+            measure(child, state);
+
+            if((*state)[child]!=2 || boxes[child].isEmpty()) {
+                continue;
+            }
+
+            unsigned long long instances = 1;
+
+            if(reference.type==AREF) {
+                instances = (unsigned long long)reference.columns *
+                            reference.rows;
+            }
+
+            if(instances==0) {
+                continue;
+            }
+
+            // The lattice corners bound all instances.
+            const gdsBox &inner = boxes[child];
+            box.add(inner.transformed(gdsTransform::placement(reference)));
+
+            if(reference.type==AREF) {
+                unsigned int columns = reference.columns - 1;
+                unsigned int rows = reference.rows - 1;
+                box.add(inner.transformed(
+                    gdsTransform::placement(reference, columns, 0)));
+                box.add(inner.transformed(
+                    gdsTransform::placement(reference, 0, rows)));
+                box.add(inner.transformed(
+                    gdsTransform::placement(reference, columns, rows)));
+            }
+
+            double scale = reference.mag * reference.mag * instances;
+            const double *inside = areas.data() + (size_t)child * slotCount;
+
+            for(size_t s=0; s<slotCount; ++s) {
+                area[s] += inside[s] * scale;
+
+                if(present[(size_t)child * slotCount + s]) {
+                    present[(size_t)structure * slotCount + s] = true;
+                }
+            }
+        }
+
+        boxes[structure] = box;
+        (*state)[structure] = 2;
+    }
+
+    void gdsDensityMap::expand(band *work, uint32_t structure,
+                               const gdsTransform &transform,
+                               unsigned int depth)
+    {
+        const gdsStructure &cell = library.structures()[structure];
+
+        for(uint32_t r=0; r<cell.rangeCount; ++r) {
+            const gdsLayerRange &range = library.ranges()[cell.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+            uint32_t slot = slots[range.layer];
+
+            if(slot==GDS_NONE) {
+                continue;
+            }
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                const gdsShape &shape = layer.shapes[range.firstShape + s];
+
+                if(!counts(layer, shape)) {
+                    continue;
+                }
+
+                outline(layer, shape, &work->points, &work->sizes);
+                size_t first = 0;
+
+                for(size_t i=0; i<work->sizes.size(); ++i) {
+                    work->polygon.resize(work->sizes[i]);
+
+                    for(size_t p=0; p<work->sizes[i]; ++p) {
+                        const point &local = work->points[first + p];
+                        point &placed = work->polygon[p];
+                        placed.x = transform.a * local.x +
+                                   transform.b * local.y + transform.tx;
+                        placed.y = transform.c * local.x +
+                                   transform.d * local.y + transform.ty;
+                    }
+
+                    addPolygon(work, slot);
+                    first += work->sizes[i];
+                }
+            }
+        }
+
+        for(uint32_t i=0; i<cell.referenceCount; ++i) {
+            placeReference(work,
+                           library.references()[cell.firstReference + i],
+                           transform, depth);
+        }
+    }
+
+    // Adds the placed outline in work->polygon to the tiles of the target.
+    void gdsDensityMap::addPolygon(band *work, uint32_t slot)
+    {
+        const vector<point> &polygon = work->polygon;
+        const densityTarget &out = *work->out;
+        double minX = HUGE_VAL, minY = HUGE_VAL;
+        double maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+
+        for(size_t i=0; i<polygon.size(); ++i) {
+            minX = min(minX, polygon[i].x);
+            maxX = max(maxX, polygon[i].x);
+            minY = min(minY, polygon[i].y);
+            maxY = max(maxY, polygon[i].y);
+        }
+
+        long long c0 = (long long)floor((minX - originX) / tile);
+        long long c1 = (long long)floor((maxX - originX) / tile);
+        long long r0 = (long long)floor((minY - originY) / tile);
+        long long r1 = (long long)floor((maxY - originY) / tile);
+
+        if(c1<out.firstColumn || c0>out.lastColumn || r1<out.firstRow ||
+           r0>out.lastRow) {
+            return;
+        }
+
+        double *cells = out.cells + slot * out.stride - out.row0 * out.columns -
+                        out.column0;
+
+        if(c0==c1 && r0==r1) {
+            cells[r0 * out.columns + c0] +=
+                polygonArea(polygon.data(), polygon.size());
+            return;
+        }
+
+        c0 = max(c0, out.firstColumn);
+        c1 = min(c1, out.lastColumn);
+        r0 = max(r0, out.firstRow);
+        r1 = min(r1, out.lastRow);
+
+        // Most shapes are rectangles, whose overlap with a tile is again
+        // a rectangle.
+        if(isRectangle(polygon)) {
+            for(long long r=r0; r<=r1; ++r) {
+                double bottom = originY + r * tile;
+                double height = min(maxY, bottom + tile) - max(minY, bottom);
+
+                for(long long c=c0; c<=c1; ++c) {
+                    double left = originX + c * tile;
+                    double width = min(maxX, left + tile) - max(minX, left);
+
+                    if(width>0.0 && height>0.0) {
+                        cells[r * out.columns + c] += width * height;
+                    }
+                }
+            }
+
+            return;
+        }
+
+        for(long long r=r0; r<=r1; ++r) {
+            double bottom = originY + r * tile;
+            clip(polygon, &work->scratch, false, bottom, true);
+            clip(work->scratch, &work->strip, false, bottom + tile, false);
+
+            if(work->strip.size()<3) {
+                continue;
+            }
+
+            for(long long c=c0; c<=c1; ++c) {
+                double left = originX + c * tile;
+                clip(work->strip, &work->scratch, true, left, true);
+                clip(work->scratch, &work->piece, true, left + tile, false);
+                cells[r * out.columns + c] +=
+                    polygonArea(work->piece.data(), work->piece.size());
+            }
+        }
+    }
+
+    // Adds the whole area of scale instances of a structure to one tile.
+    void gdsDensityMap::stamp(band *work, uint32_t structure, double scale,
+                              long long column, long long row)
+    {
+        const densityTarget &out = *work->out;
+        const double *area = areas.data() +
+                             (size_t)structure * numbers.size();
+        double *cells = out.cells + (row - out.row0) * out.columns +
+                        (column - out.column0);
+
+        for(uint32_t i=firstSlots[structure]; i<firstSlots[structure + 1];
+            ++i) {
+            uint32_t slot = slotLists[i];
+            cells[slot * out.stride] += area[slot] * scale;
+        }
+    }
+
+    // Stamps the instance when it lies in one tile of the target, and
+    // otherwise stamps its footprint or expands it.
+    void gdsDensityMap::placeInstance(band *work, uint32_t structure,
+                                      const gdsTransform &placed,
+                                      unsigned int depth)
+    {
+        const gdsBox &inner = boxes[structure];
+
+        if(inner.isEmpty()) {
+            return;
+        }
+
+        const densityTarget &out = *work->out;
+        gdsBox box = inner.transformed(placed);
+        long long c0 = (long long)floor((box.left - originX) / tile);
+        long long c1 = (long long)floor((box.right - originX) / tile);
+        long long r0 = (long long)floor((box.bottom - originY) / tile);
+        long long r1 = (long long)floor((box.top - originY) / tile);
+
+        if(c1<out.firstColumn || c0>out.lastColumn || r1<out.firstRow ||
+           r0>out.lastRow) {
+            return;
+        }
+
+        if(c0==c1 && r0==r1) {
+            stamp(work, structure,
+                  fabs(placed.a * placed.d - placed.b * placed.c), c0, r0);
+        } else if(depth>=gdsFlattener::MAX_DEPTH) {
+            return;
+        } else if((c1 - c0 + 1) * (r1 - r0 + 1)<=FOOTPRINT_TILES) {
+            placeFootprint(work, structure, placed, depth);
+        } else {
+            expand(work, structure, placed, depth + 1);
+        }
+    }
+
+    void gdsDensityMap::placeFootprint(band *work, uint32_t structure,
+                                       const gdsTransform &placed,
+                                       unsigned int depth)
+    {
+        double x = (placed.tx - originX) / tile;
+        double y = (placed.ty - originY) / tile;
+        long long column = (long long)floor(x);
+        long long row = (long long)floor(y);
+        footprintKey key = { structure, placed.a, placed.b, placed.c,
+                             placed.d, llround((x - column) * PHASE_STEPS),
+                             llround((y - row) * PHASE_STEPS) };
+        unordered_map<footprintKey, footprint, footprintHash>::iterator it =
+            work->footprints.find(key);
+
+        if(it==work->footprints.end()) {
+            // Rasterized into its own small target, which may stamp the
+            // footprints of the structures below it.
+            gdsBox box = boxes[structure].transformed(placed);
+            long long c0 = (long long)floor((box.left - originX) / tile);
+            long long c1 = (long long)floor((box.right - originX) / tile);
+            long long r0 = (long long)floor((box.bottom - originY) / tile);
+            long long r1 = (long long)floor((box.top - originY) / tile);
+            footprint made;
+            made.column = c0 - column;
+            made.row = r0 - row;
+            made.columns = c1 - c0 + 1;
+            made.rows = r1 - r0 + 1;
+            size_t tiles = made.columns * made.rows;
+            vector<double> cells(numbers.size() * tiles, 0.0);
+
+            densityTarget local = { cells.data(), tiles, c0, r0,
+                                    made.columns, c0, c1, r0, r1 };
+            densityTarget *saved = work->out;
+            work->out = &local;
+            expand(work, structure, placed, depth + 1);
+            work->out = saved;
+
+            // Only the slots of the structure are kept.
+            for(uint32_t i=firstSlots[structure];
+                i<firstSlots[structure + 1]; ++i) {
+                const double *from = cells.data() + slotLists[i] * tiles;
+                made.cells.insert(made.cells.end(), from, from + tiles);
+            }
+
+            if(work->footprintCells + made.cells.size()>MAX_FOOTPRINT_CELLS) {
+                work->footprints.clear();
+                work->footprintCells = 0;
+            }
+
+            work->footprintCells += made.cells.size();
+            it = work->footprints.insert(make_pair(key, made)).first;
+        }
+
+        const footprint &print = it->second;
+        const densityTarget &out = *work->out;
+        size_t tiles = print.columns * print.rows;
+
+        for(long long r=0; r<print.rows; ++r) {
+            long long at = row + print.row + r;
+
+            if(at<out.firstRow || at>out.lastRow) {
+                continue;
+            }
+
+            for(long long c=0; c<print.columns; ++c) {
+                long long to = column + print.column + c;
+
+                if(to<out.firstColumn || to>out.lastColumn) {
+                    continue;
+                }
+
+                double *cells = out.cells + (at - out.row0) * out.columns +
+                                (to - out.column0);
+                const double *from = &print.cells[r * print.columns + c];
+
+                for(uint32_t i=firstSlots[structure];
+                    i<firstSlots[structure + 1]; ++i, from += tiles) {
+                    cells[slotLists[i] * out.stride] += *from;
+                }
+            }
+        }
+    }
+
+    // Sorts the instances along one axis of a lattice into tiles: the
+    // tile index of each one that lies in a single tile of [first, last],
+    // -1 for one that crosses a tile border there, and -2 for one that is
+    // outside.
+    static void sortLattice(double low, double high, double step,
+                            unsigned int count, double origin, double tile,
+                            long long first, long long last,
+                            vector<long long> *tiles)
+    {
+        tiles->resize(count);
+        double from = origin + first * tile;
+        double to = origin + (last + 1) * tile;
+
+        for(unsigned int i=0; i<count; ++i) {
+            double a = low + i * step, b = high + i * step;
+
+            if(b<=from || a>=to) {
+                (*tiles)[i] = -2;
+                continue;
+            }
+
+            long long t0 = (long long)floor((a - origin) / tile);
+            long long t1 = (long long)floor((b - origin) / tile);
+            (*tiles)[i] = t0==t1 ? t0 : -1;
+        }
+    }
+
+    void gdsDensityMap::placeReference(band *work,
+                                       const gdsReference &reference,
+                                       const gdsTransform &transform,
+                                       unsigned int depth)
+    {
+        uint32_t child = reference.structure;
+
+        if(child==GDS_NONE || boxes[child].isEmpty()) {
+            return;
+        }
+
+        unsigned int columns = 1, rows = 1;
+
+        if(reference.type==AREF) {
+            columns = reference.columns;
+            rows = reference.rows;
+        }
+
+        if(columns==0 || rows==0) {
+            return;
+        }
+
+        gdsTransform base = transform * gdsTransform::placement(reference);
+
+        if(columns * rows==1) {
+            placeInstance(work, child, base, depth);
+            return;
+        }
+
+        // The lattice steps in the coordinates of the grid.
+        double cx = (double)(reference.x[1] - reference.x[0]) / columns;
+        double cy = (double)(reference.y[1] - reference.y[0]) / columns;
+        double rx = (double)(reference.x[2] - reference.x[0]) / rows;
+        double ry = (double)(reference.y[2] - reference.y[0]) / rows;
+        double columnX = transform.a * cx + transform.b * cy;
+        double columnY = transform.c * cx + transform.d * cy;
+        double rowX = transform.a * rx + transform.b * ry;
+        double rowY = transform.c * rx + transform.d * ry;
+        bool orthogonal = (base.b==0.0 && base.c==0.0) ||
+                          (base.a==0.0 && base.d==0.0);
+        bool columnsAlongX = columnY==0.0 && rowX==0.0;
+        bool columnsAlongY = columnX==0.0 && rowY==0.0;
+
+        if(!orthogonal || (!columnsAlongX && !columnsAlongY)) {
+            for(unsigned int row=0; row<rows; ++row) {
+                for(unsigned int column=0; column<columns; ++column) {
+                    placeInstance(work, child, transform *
+                                  gdsTransform::placement(reference, column,
+                                                          row), depth);
+                }
+            }
+
+            return;
+        }
+
+        // An orthogonal placement maps the box onto a box, so an instance
+        // lies in one tile when both its column and its row do.
+        gdsBox box = boxes[child].transformed(base);
+        unsigned int countX = columnsAlongX ? columns : rows;
+        unsigned int countY = columnsAlongX ? rows : columns;
+        double stepX = columnsAlongX ? columnX : rowX;
+        double stepY = columnsAlongX ? rowY : columnY;
+        vector<long long> tilesX, tilesY;
+        sortLattice(box.left, box.right, stepX, countX, originX, tile,
+                    work->out->firstColumn, work->out->lastColumn, &tilesX);
+        sortLattice(box.bottom, box.top, stepY, countY, originY, tile,
+                    work->out->firstRow, work->out->lastRow, &tilesY);
+
+        // Instances per tile column and tile row, as runs of equal tiles.
+        vector<pair<long long, unsigned int> > runsX, runsY;
+
+        for(unsigned int i=0; i<countX; ++i) {
+            if(tilesX[i]<0) {
+                continue;
+            }
+
+            if(!runsX.empty() && runsX.back().first==tilesX[i]) {
+                ++runsX.back().second;
+            } else {
+                runsX.push_back(make_pair(tilesX[i], 1U));
+            }
+        }
+
+        for(unsigned int j=0; j<countY; ++j) {
+            if(tilesY[j]<0) {
+                continue;
+            }
+
+            if(!runsY.empty() && runsY.back().first==tilesY[j]) {
+                ++runsY.back().second;
+            } else {
+                runsY.push_back(make_pair(tilesY[j], 1U));
+            }
+        }
+
+        double scale = fabs(base.a * base.d - base.b * base.c);
+
+        for(size_t y=0; y<runsY.size(); ++y) {
+            for(size_t x=0; x<runsX.size(); ++x) {
+                stamp(work, child, scale * runsX[x].second * runsY[y].second,
+                      runsX[x].first, runsY[y].first);
+            }
+        }
+
+        // The instances on a tile border are placed one by one, moved
+        // along the lattice steps from the first one.
+        gdsTransform placed = base;
+
+        for(unsigned int j=0; j<countY; ++j) {
+            if(tilesY[j]==-2) {
+                continue;
+            }
+
+            placed.ty = base.ty + j * stepY;
+
+            for(unsigned int i=0; i<countX; ++i) {
+                if(tilesX[i]==-2 || (tilesX[i]>=0 && tilesY[j]>=0)) {
+                    continue;
+                }
+
+                placed.tx = base.tx + i * stepX;
+                placeInstance(work, child, placed, depth);
+            }
+        }
+    }
+
+    unsigned int gdsDensityMap::columns() const
+    {
+        return columnCount;
+    }
+
+    unsigned int gdsDensityMap::rows() const
+    {
+        return rowCount;
+    }
+
+    double gdsDensityMap::left() const
+    {
+        return originX;
+    }
+
+    double gdsDensityMap::bottom() const
+    {
+        return originY;
+    }
+
+    double gdsDensityMap::tileSize() const
+    {
+        return tile;
+    }
+
+    const vector<unsigned short> &gdsDensityMap::layers() const
+    {
+        return numbers;
+    }
+
+    const double *gdsDensityMap::area(size_t layer) const
+    {
+        return grid.data() + layer * rowCount * columnCount;
+    }
+
+    double gdsDensityMap::density(size_t layer, unsigned int column,
+                                  unsigned int row) const
+    {
+        return area(layer)[(size_t)row * columnCount + column] /
+               (tile * tile);
+    }
+
+    int gdsDensityMap::writeCsv(const char *filePath) const
+    {
+        FILE *file = fopen(filePath, "w");
+
+        if(file==NULL) {
+            return 1;
+        }
+
+        double microns = (library.databaseUnits()>0.0 ?
+                          library.databaseUnits() : 1e-9) * 1e6;
+        int status = fprintf(file, "layer,column,row,left,bottom,density\n")<0;
+
+        for(size_t l=0; l<numbers.size() && status==0; ++l) {
+            for(unsigned int r=0; r<rowCount; ++r) {
+                for(unsigned int c=0; c<columnCount; ++c) {
+                    status |= fprintf(file, "%u,%u,%u,%.6f,%.6f,%.9g\n",
+                                      numbers[l], c, r,
+                                      (originX + c * tile) * microns,
+                                      (originY + r * tile) * microns,
+                                      density(l, c, r))<0;
+                }
+            }
+        }
+
+        status |= fclose(file)!=0;
+        return status;
+    }
+
+    int gdsDensityMap::writeBinary(const char *filePath) const
+    {
+        densityHeader top;
+        memset(&top, 0, sizeof(top));
+        memcpy(top.magic, DENSITY_MAGIC, sizeof(top.magic));
+        top.version = DENSITY_VERSION;
+        top.byteOrder = DENSITY_BYTE_ORDER;
+        top.layerCount = numbers.size();
+        top.columns = columnCount;
+        top.rows = rowCount;
+        top.left = originX;
+        top.bottom = originY;
+        top.tileSize = tile;
+        top.databaseUnits = library.databaseUnits();
+
+        FILE *file = fopen(filePath, "wb");
+
+        if(file==NULL) {
+            return 1;
+        }
+
+        vector<unsigned short> padded(numbers);
+        padded.resize((numbers.size() + 3) & ~(size_t)3, 0);
+        int status = fwrite(&top, sizeof(top), 1, file)!=1;
+        status |= fwrite(padded.data(), sizeof(unsigned short),
+                         padded.size(), file)!=padded.size();
+
+        vector<double> row(columnCount);
+
+        for(size_t l=0; l<numbers.size() && status==0; ++l) {
+            for(unsigned int r=0; r<rowCount && status==0; ++r) {
+                for(unsigned int c=0; c<columnCount; ++c) {
+                    row[c] = density(l, c, r);
+                }
+
+                status |= fwrite(row.data(), sizeof(double), columnCount,
+                                 file)!=columnCount;
+            }
+        }
+
+        status |= fclose(file)!=0;
+        return status;
+    }
+
+    unsigned int gdsDensityMap::threadCount() const
+    {
+        return threads;
+    }
+
+} // End namespace gdsfp
@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSDENSITYMAP_H_
+#define GDSDENSITYMAP_H_
+
+#include "gdsLayerFilter.h"
+#include "gdsLibrary.h"
+#include "gdsSpatialIndex.h"
+#include <cstdint>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Per layer coverage of a structure on a grid of square tiles, for
+     *  density checks and fill planning.  The tile size is given in
+     *  micrometers and converted with the database unit of the library,
+     *  as read from UNITS.  The grid is aligned to multiples of the tile
+     *  size from the origin and covers the window.
+     *
+     *  Every BOUNDARY, BOX and PATH below the structure is clipped to the
+     *  tiles it overlaps and the exact area of each piece is added to its
+     *  tile.  A PATH counts as one rectangle per segment, without joins,
+     *  which for right angle bends adds up to the area of the path; round
+     *  ends count like square ones.  Shapes that overlap are counted twice.
+     *
+     *  The hierarchy is not flattened: the area of each structure per layer
+     *  is computed once, bottom-up, and an instance whose bounding box lies
+     *  in one tile is stamped into it as a whole.  For an AREF with an axis
+     *  aligned lattice the columns and the rows are sorted into tiles
+     *  separately, so only the instances on tile borders are expanded.
+     *  Those, and all other instances of a structure that spans a few
+     *  tiles, are rasterized once per offset from the tile grid into a
+     *  small footprint that is then stamped wherever the structure lands
+     *  at the same offset, as the instances of a regular array do.
+     *  The tile rows are split into bands that the threads take in turn,
+     *  each walking the hierarchy for its band only.
+     *
+     *      gdsDensityMap density(library, 8);
+     *      density.setTileSize(50.0);
+     *      density.compute("TOP");
+     *      density.writeCsv("density.csv");
+     */
+    class gdsDensityMap
+    {
+    public:
+        // The thread count goes through gdsThreadCount().
+        explicit gdsDensityMap(const gdsLibrary &library,
+                               unsigned int threads = 0);
+
+        // Edge of a tile in micrometers, 50 by default.
+        void setTileSize(double microns);
+        // Only shapes the filter accepts are counted, by default all.
+        void setLayerFilter(const gdsLayerFilter &filter);
+        // The area to cover, in the coordinates of the structure.  By
+        // default, or with an empty box, its bounding box.
+        void setWindow(const gdsBox &window);
+
+        // Fails for grids of more than 2^27 tiles over all layers.
+        int compute(const char *strName);
+        int compute(uint32_t structure);
+
+        unsigned int columns() const;
+        unsigned int rows() const;
+        double left() const;            // Of the grid, in database units.
+        double bottom() const;
+        double tileSize() const;        // In database units.
+
+        // Numbers of the layers with a grid, ascending.
+        const std::vector<unsigned short> &layers() const;
+        // Covered area per tile in database units squared, a row of
+        // columns() tiles at a time from the bottom.
+        const double *area(size_t layer) const;
+        // Covered fraction of a tile.
+        double density(size_t layer, unsigned int column,
+                       unsigned int row) const;
+
+        // One line per tile: layer, column, row, the lower left corner in
+        // micrometers and the density.
+        int writeCsv(const char *filePath) const;
+        // A header (magic "gdsfp-density", version, byte order mark, layer
+        // count, columns, rows, then left, bottom and tile size in
+        // database units and the database unit in meters), the layer
+        // numbers padded to 8 bytes, then the densities as doubles, layer
+        // by layer, in the order of area().
+        int writeBinary(const char *filePath) const;
+
+        unsigned int threadCount() const;
+
+    private:
+        struct band;
+
+        gdsDensityMap(const gdsDensityMap &);
+        gdsDensityMap &operator=(const gdsDensityMap &);
+
+        bool counts(const gdsLayer &layer, const gdsShape &shape) const;
+        void measure(uint32_t structure, std::vector<unsigned char> *state);
+        void expand(band *work, uint32_t structure,
+                    const gdsTransform &transform, unsigned int depth);
+        void placeReference(band *work, const gdsReference &reference,
+                            const gdsTransform &transform,
+                            unsigned int depth);
+        void placeInstance(band *work, uint32_t structure,
+                           const gdsTransform &placed, unsigned int depth);
+        void placeFootprint(band *work, uint32_t structure,
+                            const gdsTransform &placed, unsigned int depth);
+        void stamp(band *work, uint32_t structure, double scale,
+                   long long column, long long row);
+        void addPolygon(band *work, uint32_t slot);
+
+        const gdsLibrary &library;
+        unsigned int threads;
+        double tileMicrons;
+        gdsLayerFilter filter;
+        bool filtering;
+        gdsBox window;
+
+        std::vector<uint32_t> slots;            // By layer, or GDS_NONE.
+        std::vector<unsigned short> numbers;    // By slot.
+        std::vector<gdsBox> boxes;              // By structure.
+        std::vector<double> areas;              // By structure and slot.
+        std::vector<bool> present;              // Same, while measuring.
+        std::vector<uint32_t> firstSlots;       // By structure, in slotLists.
+        std::vector<uint32_t> slotLists;        // Slots with shapes below.
+
+        unsigned int columnCount;
+        unsigned int rowCount;
+        double originX;
+        double originY;
+        double tile;
+        std::vector<double> grid;               // By slot, row and column.
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSDENSITYMAP_H_
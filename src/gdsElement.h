@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSELEMENT_H_
+#define GDSELEMENT_H_
+
+namespace gdsfp
+{
+    struct gdsElementProperty {
+        unsigned short attribute;
+        const char *value;              // NUL terminated.
+        unsigned int length;
+    };
+
+    /*
+     *  One complete element, as delivered by onParsedElement().  Records the
+     *  element does not have keep their defaults: 0, except mag 1 and one
+     *  column and row.  The pointers stay valid until the callback returns.
+     */
+    struct gdsElement {
+        unsigned char type;             // BOUNDARY, PATH, SREF, AREF, TEXT,
+                                        // NODE or BOX.
+        unsigned short layer;
+        unsigned short dataType;        // Or texttype, nodetype, boxtype.
+        unsigned short pathType;
+        int width;
+        int beginExtension;
+        int endExtension;
+        short strans;
+        short presentation;             // The PRESENTATION bits.
+        unsigned short elementFlags;
+        int plex;
+        double mag;
+        double angle;
+        unsigned short columns;
+        unsigned short rows;
+        const char *name;               // SNAME or STRING, NUL terminated.
+        unsigned int nameLength;
+        const int *x;
+        const int *y;
+        unsigned int count;
+        const gdsElementProperty *properties;
+        unsigned int propertyCount;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSELEMENT_H_
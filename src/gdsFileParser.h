@@ -32,18 +32,24 @@
 #ifndef GDSFILEPARSER_H_
 #define GDSFILEPARSER_H_
 
-#include <fstream>
-#include <sstream>
+#include "gdsBasicFileParser.h"
 
 namespace gdsfp
 {
-    class ifstream;
-    class gdsFileParser
+    /*
+     *  The parser with virtual callbacks: derive from it and implement every
+     *  onParsed* callback.  The decoding itself is basic_gdsFileParser.
+     */
+    class gdsFileParser : public basic_gdsFileParser<gdsFileParser>
     {
     public:
-        int parse(const char *filePath);
+        virtual ~gdsFileParser() {};
 
     protected:
+        friend class basic_gdsFileParser<gdsFileParser>;
+        friend class gdsParallelParser;
+        friend class gdsSnapshot;
+
         virtual void onParsedGDSVersion(unsigned short version) = 0;
         virtual void onParsedModTime(short year, short month, short day,
                                      short hour, short minute, short sec) = 0;
@@ -84,53 +90,74 @@ namespace gdsfp
         virtual void onParsedNodeType(unsigned short nodeType) = 0;
         virtual void onParsedBoxType(unsigned short boxType) = 0;
 
+        // Only called after enableElements().
+        virtual void onParsedElement(const gdsElement &element) {};
+        virtual void onParsedElements(const gdsElement elements[],
+                                      unsigned int count)
+        {
+            for(unsigned int i=0; i<count; ++i) {
+                onParsedElement(elements[i]);
+            }
+        };
+
+        // The whole signed values of BGNEXTN and ENDEXTN.  By default they
+        // pass them on to the callbacks above, truncated to 16 bits.
+        virtual void onParsedBeginExtension32(int bext)
+        {
+            onParsedBeginExtension((unsigned short)bext);
+        };
+        virtual void onParsedEndExtension32(int eext)
+        {
+            onParsedEndExtension((unsigned short)eext);
+        };
+
+        // The strings as views into the record, valid during the call.  By
+        // default they pass a NUL terminated copy on to the callbacks
+        // above; handlers that override them save that copy.  The replays
+        // of gdsParallelParser and gdsSnapshot come through them too.
+        virtual void onParsedLibNameView(std::string_view libName)
+        {
+            viewText.assign(libName);
+            onParsedLibName(viewText.c_str());
+        };
+        virtual void onParsedStrNameView(std::string_view strName)
+        {
+            viewText.assign(strName);
+            onParsedStrName(viewText.c_str());
+        };
+        virtual void onParsedSnameView(std::string_view sname)
+        {
+            viewText.assign(sname);
+            onParsedSname(viewText.c_str());
+        };
+        virtual void onParsedStringView(std::string_view str)
+        {
+            viewText.assign(str);
+            onParsedString(viewText.c_str());
+        };
+        virtual void onParsedPropValueView(std::string_view propValue)
+        {
+            viewText.assign(propValue);
+            onParsedPropValue(viewText.c_str());
+        };
+
+        // Only called after enableNameIds(), in place of onParsedStrName and
+        // onParsedSname.  By default they pass the name on to the views.
+        virtual void onParsedStrNameId(unsigned int id, std::string_view name)
+        {
+            onParsedStrNameView(name);
+        };
+        virtual void onParsedSnameId(unsigned int id, std::string_view name)
+        {
+            onParsedSnameView(name);
+        };
+
     private:
-        void readString(std::stringstream *input, std::string *str);
-        void readTimeStamp(std::stringstream *input, short *year, short *month,
-                           short *day, short *hour, short *minute, short *sec);
-        short readShort(std::ifstream *input);
-        short readShort(std::stringstream *input);
-        unsigned int readUInt(std::stringstream *input);
-        int readInt(std::stringstream *input);
-        double readDouble(std::stringstream *input);
-        void readHeader(std::stringstream *input);
-        void readModTimeStamp(std::stringstream *input);
-        void readAccessTimeStamp(std::stringstream *input);
-        void parseBuffer(std::stringstream *input);
-        void readLibName(std::stringstream *input);
-        void readUnits(std::stringstream *input);
-        void readStrName(std::stringstream *input);
-        void readBoundary(std::stringstream *input);
-        void readPath(std::stringstream *input);
-        void readNode(std::stringstream *input);
-        void readBox(std::stringstream *input);
-        void readEndElement(std::stringstream *input);
-        void readEndStructure(std::stringstream *input);
-        void readEndLib(std::stringstream *input);
-        void readColumnRow(std::stringstream *input);
-        void readPathType(std::stringstream *input);
-        void readStrans(std::stringstream *input);
-        void readPresentation(std::stringstream *input);
-        void readText(std::stringstream *input);
-        void readSref(std::stringstream *input);
-        void readAref(std::stringstream *input);
-        void readSname(std::stringstream *input);
-        void readString(std::stringstream *input);
-        void readPropValue(std::stringstream *input);
-        void readXY(std::stringstream *input);
-        void readLayer(std::stringstream *input);
-        void readWidth(std::stringstream *input);
-        void readDataType(std::stringstream *input);
-        void readTextType(std::stringstream *input);
-        void readAngle(std::stringstream *input);
-        void readMag(std::stringstream *input);
-        void readBeginExtension(std::stringstream *input);
-        void readEndExtension(std::stringstream *input);
-        void readPropertyNumber(std::stringstream *input);
-        void readNodeType(std::stringstream *input);
-        void readBoxType(std::stringstream *input);
+        std::string viewText;           // The copies of the views above.
     };
 
+    extern template class basic_gdsFileParser<gdsFileParser>;
+
 } // End namespace gdsfp
 
 #endif //GDSFILEPARSER_H_
@@ -0,0 +1,902 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsFileWriter.h"
+#include "gdsReal8.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace gdsfp
+{
+    static const size_t BLOCK_SIZE = 4<<20;
+    static const size_t ALIGNMENT = 4096;
+    static const unsigned int MAX_PAYLOAD = 65530;    // Even, below 65535.
+    static const int MAX_POINTS = MAX_PAYLOAD / 8;      // 8191 pairs.
+
+    static unsigned char *allocateBlock(size_t size)
+    {
+        void *block = NULL;
+
+        if(posix_memalign(&block, ALIGNMENT, size)!=0) {
+            throw std::bad_alloc();
+        }
+
+        return (unsigned char *)block;
+    }
+
+    static void putShort(unsigned char *p, unsigned short value)
+    {
+        p[0] = value>>8;
+        p[1] = value;
+    }
+
+    static void putInt(unsigned char *p, unsigned int value)
+    {
+        value = __builtin_bswap32(value);
+        memcpy(p, &value, sizeof(value));
+    }
+
+    gdsFileWriter::gdsFileWriter()
+        : fd(-1), buffer(allocateBlock(BLOCK_SIZE)), fill(0), flushed(0),
+          capacity(BLOCK_SIZE), failed(false)
+    {
+    }
+
+    gdsFileWriter::~gdsFileWriter()
+    {
+        close();
+        free(buffer);
+    }
+
+    int gdsFileWriter::open(const char *filePath)
+    {
+        close();
+        fill = 0;
+        flushed = 0;
+        failed = false;
+        fd = ::open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        return fd<0 ? 1 : 0;
+    }
+
+    int gdsFileWriter::close()
+    {
+        if(fd>=0) {
+            flush();
+
+            if(::close(fd)!=0) {
+                failed = true;
+            }
+
+            fd = -1;
+        }
+
+        return failed ? 1 : 0;
+    }
+
+    const unsigned char *gdsFileWriter::data() const
+    {
+        return buffer;
+    }
+
+    size_t gdsFileWriter::size() const
+    {
+        return fill;
+    }
+
+    unsigned long long gdsFileWriter::offset() const
+    {
+        return flushed + fill;
+    }
+
+    // Writes the buffer out, or in memory mode doubles it.
+    void gdsFileWriter::flush()
+    {
+        if(fd<0) {
+            unsigned char *larger = allocateBlock(capacity * 2);
+            memcpy(larger, buffer, fill);
+            free(buffer);
+            buffer = larger;
+            capacity *= 2;
+            return;
+        }
+
+        size_t done = 0;
+
+        while(done<fill && !failed) {
+            ssize_t written = write(fd, buffer + done, fill - done);
+
+            if(written<0 && errno==EINTR) {
+                continue;
+            }
+
+            if(written<=0) {
+                failed = true;
+            } else {
+                done += written;
+            }
+        }
+
+        flushed += fill;
+        fill = 0;
+    }
+
+    unsigned char *gdsFileWriter::reserve(size_t length)
+    {
+        while(fill + length>capacity) {
+            flush();
+        }
+
+        unsigned char *p = buffer + fill;
+        fill += length;
+        return p;
+    }
+
+    unsigned char *gdsFileWriter::beginRecord(RecordType type,
+                                              RecordDataType dataType,
+                                              unsigned int length)
+    {
+        unsigned char *p = reserve(4 + length);
+        putShort(p, 4 + length);
+        p[2] = type;
+        p[3] = dataType;
+        return p + 4;
+    }
+
+    void gdsFileWriter::writeRaw(const void *bytes, size_t length)
+    {
+        if(fd>=0 && length>=capacity) {
+            flush();
+
+            while(length>0 && !failed) {
+                size_t piece = length<BLOCK_SIZE ? length : BLOCK_SIZE;
+                memcpy(buffer, bytes, piece);
+                fill = piece;
+                flush();
+                bytes = (const unsigned char *)bytes + piece;
+                length -= piece;
+            }
+
+            return;
+        }
+
+        memcpy(reserve(length), bytes, length);
+    }
+
+    void gdsFileWriter::writeRecord(RecordType type)
+    {
+        beginRecord(type, NO_DATA, 0);
+    }
+
+    void gdsFileWriter::writeShorts(RecordType type, const short values[],
+                                    unsigned int count)
+    {
+        unsigned char *p = beginRecord(type, INTEGER_2, 2 * count);
+
+        for(unsigned int i=0; i<count; ++i) {
+            putShort(p + 2 * i, values[i]);
+        }
+    }
+
+    void gdsFileWriter::writeInts(RecordType type, const int values[],
+                                  unsigned int count)
+    {
+        unsigned char *p = beginRecord(type, INTEGER_4, 4 * count);
+
+        for(unsigned int i=0; i<count; ++i) {
+            putInt(p + 4 * i, values[i]);
+        }
+    }
+
+    void gdsFileWriter::writeReals(RecordType type, const double values[],
+                                   unsigned int count)
+    {
+        unsigned char *p = beginRecord(type, REAL_8, 8 * count);
+
+        for(unsigned int i=0; i<count; ++i) {
+            encodeReal8(values[i], p + 8 * i);
+        }
+    }
+
+    void gdsFileWriter::writeAscii(RecordType type, const char *str)
+    {
+        size_t length = strlen(str);
+
+        if(length>MAX_PAYLOAD) {
+            length = MAX_PAYLOAD;
+        }
+
+        unsigned int padded = (length + 1) & ~(size_t)1;
+        unsigned char *p = beginRecord(type, ASCII_STRING, padded);
+        memcpy(p, str, length);
+
+        if(padded>length) {
+            p[length] = '\0';
+        }
+    }
+
+    void gdsFileWriter::writeBits(RecordType type, unsigned short bits)
+    {
+        putShort(beginRecord(type, BIT_ARRAY, 2), bits);
+    }
+
+    void gdsFileWriter::writeHeader(unsigned short version)
+    {
+        short value = version;
+        writeShorts(HEADER, &value, 1);
+    }
+
+    void gdsFileWriter::writeBeginLib(const short modTime[6],
+                                      const short accessTime[6])
+    {
+        short stamps[12];
+        memcpy(stamps, modTime, 6 * sizeof(short));
+        memcpy(stamps + 6, accessTime, 6 * sizeof(short));
+        writeShorts(BGNLIB, stamps, 12);
+    }
+
+    void gdsFileWriter::writeLibName(const char *libName)
+    {
+        writeAscii(LIBNAME, libName);
+    }
+
+    void gdsFileWriter::writeUnits(double userUnits, double databaseUnits)
+    {
+        double units[2] = { userUnits, databaseUnits };
+        writeReals(UNITS, units, 2);
+    }
+
+    void gdsFileWriter::writeEndLib()
+    {
+        writeRecord(ENDLIB);
+    }
+
+    void gdsFileWriter::writeBeginStructure(const short modTime[6],
+                                            const short accessTime[6])
+    {
+        short stamps[12];
+        memcpy(stamps, modTime, 6 * sizeof(short));
+        memcpy(stamps + 6, accessTime, 6 * sizeof(short));
+        writeShorts(BGNSTR, stamps, 12);
+    }
+
+    void gdsFileWriter::writeStrName(const char *strName)
+    {
+        writeAscii(STRNAME, strName);
+    }
+
+    void gdsFileWriter::writeEndStructure()
+    {
+        writeRecord(ENDSTR);
+    }
+
+    void gdsFileWriter::writeBoundary()
+    {
+        writeRecord(BOUNDARY);
+    }
+
+    void gdsFileWriter::writePath()
+    {
+        writeRecord(PATH);
+    }
+
+    void gdsFileWriter::writeSref()
+    {
+        writeRecord(SREF);
+    }
+
+    void gdsFileWriter::writeAref()
+    {
+        writeRecord(AREF);
+    }
+
+    void gdsFileWriter::writeText()
+    {
+        writeRecord(TEXT);
+    }
+
+    void gdsFileWriter::writeLayer(unsigned short layer)
+    {
+        short value = layer;
+        writeShorts(LAYER, &value, 1);
+    }
+
+    void gdsFileWriter::writeDataType(unsigned short dataType)
+    {
+        short value = dataType;
+        writeShorts(DATATYPE, &value, 1);
+    }
+
+    void gdsFileWriter::writeWidth(int width)
+    {
+        writeInts(WIDTH, &width, 1);
+    }
+
+    void gdsFileWriter::writeXY(int count, const int x[], const int y[])
+    {
+        do {
+            int points = count<MAX_POINTS ? count : MAX_POINTS;
+            unsigned char *p = beginRecord(XY, INTEGER_4, 8 * points);
+
+            for(int i=0; i<points; ++i) {
+                putInt(p + 8 * i, x[i]);
+                putInt(p + 8 * i + 4, y[i]);
+            }
+
+            x += points;
+            y += points;
+            count -= points;
+        } while(count>0);
+    }
+
+    void gdsFileWriter::writeEndElement()
+    {
+        writeRecord(ENDEL);
+    }
+
+    void gdsFileWriter::writeSname(const char *sname)
+    {
+        writeAscii(SNAME, sname);
+    }
+
+    void gdsFileWriter::writeColumnsRows(unsigned short columns,
+                                         unsigned short rows)
+    {
+        short values[2] = { (short)columns, (short)rows };
+        writeShorts(COLROW, values, 2);
+    }
+
+    void gdsFileWriter::writeNode()
+    {
+        writeRecord(NODE);
+    }
+
+    void gdsFileWriter::writeTextType(unsigned short textType)
+    {
+        short value = textType;
+        writeShorts(TEXTTYPE, &value, 1);
+    }
+
+    void gdsFileWriter::writePresentation(short font, short valign,
+                                          short halign)
+    {
+        writeBits(PRESENTATION,
+                  (font & 0x30) | (valign & 0x0c) | (halign & 0x03));
+    }
+
+    void gdsFileWriter::writeString(const char *str)
+    {
+        writeAscii(STRING, str);
+    }
+
+    void gdsFileWriter::writeStrans(short strans)
+    {
+        writeBits(STRANS, strans);
+    }
+
+    void gdsFileWriter::writeMag(double mag)
+    {
+        writeReals(MAG, &mag, 1);
+    }
+
+    void gdsFileWriter::writeAngle(double angle)
+    {
+        writeReals(ANGLE, &angle, 1);
+    }
+
+    void gdsFileWriter::writePathType(unsigned short pathType)
+    {
+        short value = pathType;
+        writeShorts(PATHTYPE, &value, 1);
+    }
+
+    void gdsFileWriter::writeBeginExtension(int bext)
+    {
+        writeInts(BGNEXTN, &bext, 1);
+    }
+
+    void gdsFileWriter::writeEndExtension(int eext)
+    {
+        writeInts(ENDEXTN, &eext, 1);
+    }
+
+    void gdsFileWriter::writePropertyNumber(unsigned short propNum)
+    {
+        short value = propNum;
+        writeShorts(PROPATTR, &value, 1);
+    }
+
+    void gdsFileWriter::writePropValue(const char *propValue)
+    {
+        writeAscii(PROPVALUE, propValue);
+    }
+
+    void gdsFileWriter::writeBox()
+    {
+        writeRecord(BOX);
+    }
+
+    void gdsFileWriter::writeBoxType(unsigned short boxType)
+    {
+        short value = boxType;
+        writeShorts(BOXTYPE, &value, 1);
+    }
+
+    void gdsFileWriter::writeNodeType(unsigned short nodeType)
+    {
+        short value = nodeType;
+        writeShorts(NODETYPE, &value, 1);
+    }
+
+    void gdsFileWriter::writeElFlags(unsigned short flags)
+    {
+        writeBits(ELFLAGS, flags);
+    }
+
+    void gdsFileWriter::writePlex(int plex)
+    {
+        writeInts(PLEX, &plex, 1);
+    }
+
+    static void writeProperties(gdsFileWriter *writer,
+                                const gdsLibrary &library, uint32_t first,
+                                uint32_t count)
+    {
+        for(uint32_t i=0; i<count; ++i) {
+            const gdsProperty &property = library.properties()[first + i];
+            writer->writePropertyNumber(property.attribute);
+            writer->writePropValue(library.string(property.value));
+        }
+    }
+
+    static void writeTransform(gdsFileWriter *writer, short strans,
+                               double mag, double angle)
+    {
+        if(strans!=0 || mag!=1.0 || angle!=0.0) {
+            writer->writeStrans(strans);
+
+            if(mag!=1.0) {
+                writer->writeMag(mag);
+            }
+
+            if(angle!=0.0) {
+                writer->writeAngle(angle);
+            }
+        }
+    }
+
+    // Shapes layer by layer, then texts, then references.
+    static void writeStructure(gdsFileWriter *writer,
+                               const gdsLibrary &library, uint32_t index,
+                               const short stamp[6])
+    {
+        const gdsStructure &structure = library.structures()[index];
+        writer->writeBeginStructure(stamp, stamp);
+        writer->writeStrName(library.string(structure.name));
+
+        for(uint32_t r=0; r<structure.rangeCount; ++r) {
+            const gdsLayerRange &range =
+                library.ranges()[structure.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                const gdsShape &shape = layer.shapes[range.firstShape + s];
+                writer->writeRecord((RecordType)shape.type);
+                writer->writeLayer(layer.number);
+
+                switch(shape.type) {
+                    case BOX:
+                        writer->writeBoxType(shape.dataType);
+                        break;
+
+                    case NODE:
+                        writer->writeNodeType(shape.dataType);
+                        break;
+
+                    default:
+                        writer->writeDataType(shape.dataType);
+                        break;
+                }
+
+                if(shape.type==PATH) {
+                    if(shape.pathType!=0) {
+                        writer->writePathType(shape.pathType);
+                    }
+
+                    if(shape.width!=0) {
+                        writer->writeWidth(shape.width);
+                    }
+
+                    if(shape.beginExtension!=0) {
+                        writer->writeBeginExtension(shape.beginExtension);
+                    }
+
+                    if(shape.endExtension!=0) {
+                        writer->writeEndExtension(shape.endExtension);
+                    }
+                }
+
+                writer->writeXY(shape.pointCount,
+                                layer.x.data() + shape.firstPoint,
+                                layer.y.data() + shape.firstPoint);
+                writeProperties(writer, library, shape.firstProperty,
+                                shape.propertyCount);
+                writer->writeEndElement();
+            }
+        }
+
+        for(uint32_t i=0; i<structure.textCount; ++i) {
+            const gdsText &text = library.texts()[structure.firstText + i];
+            writer->writeText();
+            writer->writeLayer(text.layer);
+            writer->writeTextType(text.textType);
+
+            if(text.presentation!=0) {
+                writer->writePresentation(text.presentation,
+                                          text.presentation,
+                                          text.presentation);
+            }
+
+            if(text.pathType!=0) {
+                writer->writePathType(text.pathType);
+            }
+
+            if(text.width!=0) {
+                writer->writeWidth(text.width);
+            }
+
+            writeTransform(writer, text.strans, text.mag, text.angle);
+            writer->writeXY(1, &text.x, &text.y);
+            writer->writeString(library.string(text.string));
+            writeProperties(writer, library, text.firstProperty,
+                            text.propertyCount);
+            writer->writeEndElement();
+        }
+
+        for(uint32_t i=0; i<structure.referenceCount; ++i) {
+            const gdsReference &reference =
+                library.references()[structure.firstReference + i];
+            bool array = reference.type==AREF;
+            writer->writeRecord(array ? AREF : SREF);
+            writer->writeSname(library.string(reference.name));
+            writeTransform(writer, reference.strans, reference.mag,
+                           reference.angle);
+
+            if(array) {
+                writer->writeColumnsRows(reference.columns, reference.rows);
+            }
+
+            writer->writeXY(array ? 3 : 1, reference.x, reference.y);
+            writeProperties(writer, library, reference.firstProperty,
+                            reference.propertyCount);
+            writer->writeEndElement();
+        }
+
+        writer->writeEndStructure();
+    }
+
+    // Rough output size of a structure, to balance the threads.
+    static uint64_t structureWeight(const gdsLibrary &library, uint32_t index)
+    {
+        const gdsStructure &structure = library.structures()[index];
+        uint64_t weight = 64 + 64 * structure.textCount +
+                          64 * structure.referenceCount;
+
+        for(uint32_t r=0; r<structure.rangeCount; ++r) {
+            const gdsLayerRange &range =
+                library.ranges()[structure.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                weight += 48 + 8 * layer.shapes[range.firstShape + s].pointCount;
+            }
+        }
+
+        return weight;
+    }
+
+    int gdsFileWriter::writeLibrary(const gdsLibrary &library,
+                                    unsigned int threads)
+    {
+        time_t now = time(NULL);
+        struct tm local;
+        localtime_r(&now, &local);
+        short stamp[6] = { (short)(local.tm_year + 1900),
+                           (short)(local.tm_mon + 1), (short)local.tm_mday,
+                           (short)local.tm_hour, (short)local.tm_min,
+                           (short)local.tm_sec };
+
+        writeHeader(library.version()!=0 ? library.version() : 600);
+        writeBeginLib(stamp, stamp);
+        writeLibName(library.name());
+        writeUnits(library.userUnits(), library.databaseUnits());
+
+        uint32_t count = library.structures().length();
+
+        if(threads<=1 || count<2) {
+            for(uint32_t i=0; i<count; ++i) {
+                writeStructure(this, library, i, stamp);
+            }
+        } else {
+            if(threads>count) {
+                threads = count;
+            }
+
+            // Contiguous runs of structures of about the same size.
+            std::vector<uint64_t> weights(count);
+            uint64_t total = 0;
+
+            for(uint32_t i=0; i<count; ++i) {
+                weights[i] = structureWeight(library, i);
+                total += weights[i];
+            }
+
+            std::vector<uint32_t> bounds(1, 0);
+            uint64_t sum = 0;
+
+            for(uint32_t i=0; i<count && bounds.size()<threads; ++i) {
+                sum += weights[i];
+
+                if(sum * threads>=total * bounds.size()) {
+                    bounds.push_back(i + 1);
+                }
+            }
+
+            bounds.push_back(count);
+            std::vector<gdsFileWriter> parts(bounds.size() - 1);
+            std::vector<std::thread> workers;
+
+            for(size_t t=0; t<parts.size(); ++t) {
+                workers.emplace_back([&, t]() {
+                    for(uint32_t i=bounds[t]; i<bounds[t + 1]; ++i) {
+                        writeStructure(&parts[t], library, i, stamp);
+                    }
+                });
+            }
+
+            for(size_t t=0; t<workers.size(); ++t) {
+                workers[t].join();
+                writeRaw(parts[t].data(), parts[t].size());
+            }
+        }
+
+        writeEndLib();
+        return failed ? 1 : 0;
+    }
+
+    // The parser adds 1900 to years below 1000, so a year that is still
+    // below 1000 was read from a value below -900.
+    static void rawTimeStamp(short stamp[6], short year, short month,
+                             short day, short hour, short minute, short sec)
+    {
+        stamp[0] = year<1000 ? year - 1900 : year;
+        stamp[1] = month;
+        stamp[2] = day;
+        stamp[3] = hour;
+        stamp[4] = minute;
+        stamp[5] = sec;
+    }
+
+    gdsFileRewriter::gdsFileRewriter(gdsFileWriter *writer)
+        : writer(writer), inLibrary(false)
+    {
+        memset(modTime, 0, sizeof(modTime));
+    }
+
+    void gdsFileRewriter::onParsedGDSVersion(unsigned short version)
+    {
+        inLibrary = false;
+        writer->writeHeader(version);
+    }
+
+    void gdsFileRewriter::onParsedModTime(short year, short month, short day,
+                                          short hour, short minute, short sec)
+    {
+        rawTimeStamp(modTime, year, month, day, hour, minute, sec);
+    }
+
+    void gdsFileRewriter::onParsedAccessTime(short year, short month,
+                                             short day, short hour,
+                                             short minute, short sec)
+    {
+        short stamp[6];
+        rawTimeStamp(stamp, year, month, day, hour, minute, sec);
+
+        if(inLibrary) {
+            writer->writeBeginStructure(modTime, stamp);
+        } else {
+            writer->writeBeginLib(modTime, stamp);
+        }
+    }
+
+    void gdsFileRewriter::onParsedLibName(const char *libName)
+    {
+        inLibrary = true;
+        writer->writeLibName(libName);
+    }
+
+    void gdsFileRewriter::onParsedUnits(double userUnits,
+                                        double databaseUnits)
+    {
+        writer->writeUnits(userUnits, databaseUnits);
+    }
+
+    void gdsFileRewriter::onParsedStrName(const char *strName)
+    {
+        writer->writeStrName(strName);
+    }
+
+    void gdsFileRewriter::onParsedBoundaryStart()
+    {
+        writer->writeBoundary();
+    }
+
+    void gdsFileRewriter::onParsedPathStart()
+    {
+        writer->writePath();
+    }
+
+    void gdsFileRewriter::onParsedBoxStart()
+    {
+        writer->writeBox();
+    }
+
+    void gdsFileRewriter::onParsedEndElement()
+    {
+        writer->writeEndElement();
+    }
+
+    void gdsFileRewriter::onParsedEndStructure()
+    {
+        writer->writeEndStructure();
+    }
+
+    void gdsFileRewriter::onParsedEndLib()
+    {
+        writer->writeEndLib();
+    }
+
+    void gdsFileRewriter::onParsedColumnsRows(unsigned short columns,
+                                              unsigned short rows)
+    {
+        writer->writeColumnsRows(columns, rows);
+    }
+
+    void gdsFileRewriter::onParsedPathType(unsigned short pathType)
+    {
+        writer->writePathType(pathType);
+    }
+
+    void gdsFileRewriter::onParsedStrans(short strans)
+    {
+        writer->writeStrans(strans);
+    }
+
+    void gdsFileRewriter::onParsedPresentation(short font, short valign,
+                                               short halign)
+    {
+        writer->writePresentation(font, valign, halign);
+    }
+
+    void gdsFileRewriter::onParsedNodeStart()
+    {
+        writer->writeNode();
+    }
+
+    void gdsFileRewriter::onParsedTextStart()
+    {
+        writer->writeText();
+    }
+
+    void gdsFileRewriter::onParsedSrefStart()
+    {
+        writer->writeSref();
+    }
+
+    void gdsFileRewriter::onParsedArefStart()
+    {
+        writer->writeAref();
+    }
+
+    void gdsFileRewriter::onParsedSname(const char *sname)
+    {
+        writer->writeSname(sname);
+    }
+
+    void gdsFileRewriter::onParsedString(const char *str)
+    {
+        writer->writeString(str);
+    }
+
+    void gdsFileRewriter::onParsedPropValue(const char *propValue)
+    {
+        writer->writePropValue(propValue);
+    }
+
+    void gdsFileRewriter::onParsedXY(int count, int x[], int y[])
+    {
+        writer->writeXY(count, x, y);
+    }
+
+    void gdsFileRewriter::onParsedLayer(unsigned short layer)
+    {
+        writer->writeLayer(layer);
+    }
+
+    void gdsFileRewriter::onParsedWidth(int width)
+    {
+        writer->writeWidth(width);
+    }
+
+    void gdsFileRewriter::onParsedDataType(unsigned short dataType)
+    {
+        writer->writeDataType(dataType);
+    }
+
+    void gdsFileRewriter::onParsedTextType(unsigned short textType)
+    {
+        writer->writeTextType(textType);
+    }
+
+    void gdsFileRewriter::onParsedAngle(double angle)
+    {
+        writer->writeAngle(angle);
+    }
+
+    void gdsFileRewriter::onParsedMag(double mag)
+    {
+        writer->writeMag(mag);
+    }
+
+    void gdsFileRewriter::onParsedBeginExtension32(int bext)
+    {
+        writer->writeBeginExtension(bext);
+    }
+
+    void gdsFileRewriter::onParsedEndExtension32(int eext)
+    {
+        writer->writeEndExtension(eext);
+    }
+
+    void gdsFileRewriter::onParsedPropertyNumber(unsigned short propNum)
+    {
+        writer->writePropertyNumber(propNum);
+    }
+
+    void gdsFileRewriter::onParsedNodeType(unsigned short nodeType)
+    {
+        writer->writeNodeType(nodeType);
+    }
+
+    void gdsFileRewriter::onParsedBoxType(unsigned short boxType)
+    {
+        writer->writeBoxType(boxType);
+    }
+} // End namespace gdsfp
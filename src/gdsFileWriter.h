@@ -0,0 +1,215 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSFILEWRITER_H_
+#define GDSFILEWRITER_H_
+
+#include "gdsCalmaRecords.h"
+#include "gdsFileParser.h"
+#include "gdsLibrary.h"
+#include <cstddef>
+
+namespace gdsfp
+{
+    /*
+     *  GDSII stream writer with one method per record type.  Records are
+     *  assembled in a 4 MB page aligned buffer that is written out with
+     *  plain write() calls whenever it fills up.  Without open() the
+     *  writer collects the stream in memory instead, see data() and
+     *  size().
+     *
+     *  Strings are padded to an even length with a NUL.  XY lists longer
+     *  than the 8191 points that fit in one record are split over
+     *  consecutive XY records of the same element.  The write methods
+     *  don't report errors themselves; the first failure is kept and
+     *  returned by close().
+     *
+     *      gdsFileWriter writer;
+     *      writer.open("out.gds");
+     *      writer.writeHeader(600);
+     *      ...
+     *      writer.writeEndLib();
+     *      return writer.close();
+     */
+    class gdsFileWriter
+    {
+    public:
+        gdsFileWriter();
+        ~gdsFileWriter();
+
+        int open(const char *filePath);
+        int close();
+
+        const unsigned char *data() const;
+        size_t size() const;
+
+        // Bytes written since open(), including those still buffered.
+        unsigned long long offset() const;
+
+        // Writes a whole library from memory.  With more than one thread
+        // the structures are serialized in parallel into one buffer per
+        // thread, which are then written in order.
+        int writeLibrary(const gdsLibrary &library, unsigned int threads = 1);
+
+        void writeHeader(unsigned short version);
+        void writeBeginLib(const short modTime[6], const short accessTime[6]);
+        void writeLibName(const char *libName);
+        void writeUnits(double userUnits, double databaseUnits);
+        void writeEndLib();
+        void writeBeginStructure(const short modTime[6],
+                                 const short accessTime[6]);
+        void writeStrName(const char *strName);
+        void writeEndStructure();
+        void writeBoundary();
+        void writePath();
+        void writeSref();
+        void writeAref();
+        void writeText();
+        void writeLayer(unsigned short layer);
+        void writeDataType(unsigned short dataType);
+        void writeWidth(int width);
+        void writeXY(int count, const int x[], const int y[]);
+        void writeEndElement();
+        void writeSname(const char *sname);
+        void writeColumnsRows(unsigned short columns, unsigned short rows);
+        void writeNode();
+        void writeTextType(unsigned short textType);
+        // The fields are masked in place, as onParsedPresentation gets them.
+        void writePresentation(short font, short valign, short halign);
+        void writeString(const char *str);
+        void writeStrans(short strans);
+        void writeMag(double mag);
+        void writeAngle(double angle);
+        void writePathType(unsigned short pathType);
+        void writeBeginExtension(int bext);
+        void writeEndExtension(int eext);
+        void writePropertyNumber(unsigned short propNum);
+        void writePropValue(const char *propValue);
+        void writeBox();
+        void writeBoxType(unsigned short boxType);
+        void writeNodeType(unsigned short nodeType);
+        void writeElFlags(unsigned short flags);
+        void writePlex(int plex);
+
+        // Generic forms for the other record types.
+        void writeRecord(RecordType type);
+        void writeShorts(RecordType type, const short values[],
+                         unsigned int count);
+        void writeInts(RecordType type, const int values[],
+                       unsigned int count);
+        void writeReals(RecordType type, const double values[],
+                        unsigned int count);
+        void writeAscii(RecordType type, const char *str);
+        void writeBits(RecordType type, unsigned short bits);
+
+        // Appends bytes that already are GDSII records.
+        void writeRaw(const void *bytes, size_t length);
+
+    private:
+        gdsFileWriter(const gdsFileWriter &);
+        gdsFileWriter &operator=(const gdsFileWriter &);
+
+        unsigned char *reserve(size_t length);
+        unsigned char *beginRecord(RecordType type, RecordDataType dataType,
+                                   unsigned int length);
+        void flush();
+
+        int fd;
+        unsigned char *buffer;
+        size_t fill;
+        unsigned long long flushed;
+        size_t capacity;
+        bool failed;
+    };
+
+    /*
+     *  Writes everything the parser reports back out as GDSII, e.g. to
+     *  save a layer filtered or subscription filtered copy of a file:
+     *
+     *      gdsFileWriter writer;
+     *      writer.open("metal.gds");
+     *      gdsFileRewriter copy(&writer);
+     *      copy.setLayerFilter(metalLayers);
+     *      copy.parse("chip.gds");
+     *      writer.close();
+     *
+     *  Records the parser has no callback for are not copied.
+     */
+    class gdsFileRewriter : public gdsFileParser
+    {
+    public:
+        explicit gdsFileRewriter(gdsFileWriter *writer);
+
+    protected:
+        void onParsedGDSVersion(unsigned short version);
+        void onParsedModTime(short year, short month, short day,
+                             short hour, short minute, short sec);
+        void onParsedAccessTime(short year, short month, short day,
+                                short hour, short minute, short sec);
+        void onParsedLibName(const char *libName);
+        void onParsedUnits(double userUnits, double databaseUnits);
+        void onParsedStrName(const char *strName);
+        void onParsedBoundaryStart();
+        void onParsedPathStart();
+        void onParsedBoxStart();
+        void onParsedEndElement();
+        void onParsedEndStructure();
+        void onParsedEndLib();
+        void onParsedColumnsRows(unsigned short columns,
+                                 unsigned short rows);
+        void onParsedPathType(unsigned short pathType);
+        void onParsedStrans(short strans);
+        void onParsedPresentation(short font, short valign, short halign);
+        void onParsedNodeStart();
+        void onParsedTextStart();
+        void onParsedSrefStart();
+        void onParsedArefStart();
+        void onParsedSname(const char *sname);
+        void onParsedString(const char *str);
+        void onParsedPropValue(const char *propValue);
+        void onParsedXY(int count, int x[], int y[]);
+        void onParsedLayer(unsigned short layer);
+        void onParsedWidth(int width);
+        void onParsedDataType(unsigned short dataType);
+        void onParsedTextType(unsigned short textType);
+        void onParsedAngle(double angle);
+        void onParsedMag(double mag);
+        // BGNEXTN and ENDEXTN come whole through the 32-bit callbacks.
+        void onParsedBeginExtension(unsigned short bext) {};
+        void onParsedEndExtension(unsigned short eext) {};
+        void onParsedBeginExtension32(int bext);
+        void onParsedEndExtension32(int eext);
+        void onParsedPropertyNumber(unsigned short propNum);
+        void onParsedNodeType(unsigned short nodeType);
+        void onParsedBoxType(unsigned short boxType);
+
+    private:
+        gdsFileWriter *writer;
+        short modTime[6];
+        bool inLibrary;                 // BGNSTR rather than BGNLIB times.
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSFILEWRITER_H_
@@ -0,0 +1,494 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsFlattener.h"
+#include "gdsThreadCount.h"
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace gdsfp
+{
+    gdsTransform gdsTransform::identity()
+    {
+        gdsTransform t = { 1.0, 0.0, 0.0, 1.0, 0.0, 0.0 };
+        return t;
+    }
+
+    gdsTransform gdsTransform::placement(const gdsReference &reference,
+                                         unsigned int column, unsigned int row)
+    {
+        double cosine, sine;
+        double angle = fmod(reference.angle, 360.0);
+
+        // Keep the usual orthogonal rotations exact.
+        if(angle<0.0) {
+            angle += 360.0;
+        }
+
+        if(angle==0.0) {
+            cosine = 1.0, sine = 0.0;
+        } else if(angle==90.0) {
+            cosine = 0.0, sine = 1.0;
+        } else if(angle==180.0) {
+            cosine = -1.0, sine = 0.0;
+        } else if(angle==270.0) {
+            cosine = 0.0, sine = -1.0;
+        } else {
+            cosine = cos(angle * M_PI / 180.0);
+            sine = sin(angle * M_PI / 180.0);
+        }
+
+        double mag = reference.mag;
+        double flip = ((unsigned short)reference.strans & 0x8000) ? -1.0 : 1.0;
+        gdsTransform t;
+        t.a = mag * cosine;
+        t.b = -mag * sine * flip;
+        t.c = mag * sine;
+        t.d = mag * cosine * flip;
+        t.tx = reference.x[0];
+        t.ty = reference.y[0];
+
+        // The second point is displaced from the origin by all the columns,
+        // the third one by all the rows.
+        if(reference.type==AREF && reference.columns>0 && reference.rows>0) {
+            double cx = (double)(reference.x[1] - reference.x[0]);
+            double cy = (double)(reference.y[1] - reference.y[0]);
+            double rx = (double)(reference.x[2] - reference.x[0]);
+            double ry = (double)(reference.y[2] - reference.y[0]);
+            t.tx += cx * column / reference.columns +
+                    rx * row / reference.rows;
+            t.ty += cy * column / reference.columns +
+                    ry * row / reference.rows;
+        }
+
+        return t;
+    }
+
+    gdsTransform gdsTransform::operator*(const gdsTransform &other) const
+    {
+        gdsTransform t;
+        t.a = a * other.a + b * other.c;
+        t.b = a * other.b + b * other.d;
+        t.c = c * other.a + d * other.c;
+        t.d = c * other.b + d * other.d;
+        t.tx = a * other.tx + b * other.ty + tx;
+        t.ty = c * other.tx + d * other.ty + ty;
+        return t;
+    }
+
+    gdsTransform gdsTransform::inverse() const
+    {
+        double determinant = a * d - b * c;
+        gdsTransform t;
+        t.a = d / determinant;
+        t.b = -b / determinant;
+        t.c = -c / determinant;
+        t.d = a / determinant;
+        t.tx = -(t.a * tx + t.b * ty);
+        t.ty = -(t.c * tx + t.d * ty);
+        return t;
+    }
+
+    bool gdsTransform::isSingular() const
+    {
+        return !std::isfinite(1.0 / (a * d - b * c));
+    }
+
+    struct gdsFlattener::run {
+        struct task {
+            uint32_t structure;
+            unsigned int depth;
+            gdsTransform transform;
+        };
+
+        struct worker {
+            std::mutex mutex;
+            std::deque<task> tasks;
+            gdsCoordinateBuffer coordinates;
+        };
+
+        const gdsLibrary *library;
+        gdsFlatSink *sink;
+        std::vector<std::unique_ptr<worker> > workers;
+        std::atomic<long> pending;      // Tasks queued or running.
+        std::atomic<int> idle;          // Workers looking for a task.
+        std::atomic<bool> tooDeep;
+
+        // Idle workers sleep on wake until signals changes, which it does
+        // for every pushed task and when pending drops to 0.
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::atomic<unsigned long> signals;
+
+        void push(unsigned int thread, const task &item)
+        {
+            worker &owner = *workers[thread];
+            pending.fetch_add(1);
+
+            {
+                std::lock_guard<std::mutex> lock(owner.mutex);
+                owner.tasks.push_back(item);
+            }
+
+            signal(false);
+        };
+
+        void finish()
+        {
+            if(pending.fetch_sub(1)==1) {
+                signal(true);
+            }
+        };
+
+        void signal(bool everyone)
+        {
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                signals.fetch_add(1);
+            }
+
+            if(everyone) {
+                wake.notify_all();
+            } else {
+                wake.notify_one();
+            }
+        };
+
+        // Sleeps until a task may have been pushed since seen was read, or
+        // until all work is done.
+        void sleep(unsigned long seen)
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+
+            while(signals.load()==seen && pending.load()!=0) {
+                wake.wait(lock);
+            }
+        };
+
+        // Newest own task first, otherwise the oldest task of another
+        // worker.
+        bool take(unsigned int thread, task *item)
+        {
+            {
+                worker &owner = *workers[thread];
+                std::lock_guard<std::mutex> lock(owner.mutex);
+
+                if(!owner.tasks.empty()) {
+                    (*item) = owner.tasks.back();
+                    owner.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            for(size_t i=1; i<workers.size(); ++i) {
+                worker &victim = *workers[(thread + i) % workers.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+
+                if(!victim.tasks.empty()) {
+                    (*item) = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        };
+    };
+
+    gdsFlattener::gdsFlattener(const gdsLibrary &library, unsigned int threads)
+        : library(library), threads(gdsThreadCount(threads))
+    {
+    }
+
+    unsigned int gdsFlattener::threadCount() const
+    {
+        return threads;
+    }
+
+    void gdsFlattener::topStructures(std::vector<uint32_t> *tops) const
+    {
+        const gdsArray<gdsStructure> &structures = library.structures();
+        const gdsArray<gdsReference> &references = library.references();
+        std::vector<bool> referenced(structures.length(), false);
+
+        for(uint32_t i=0; i<references.length(); ++i) {
+            if(references[i].structure!=GDS_NONE) {
+                referenced[references[i].structure] = true;
+            }
+        }
+
+        tops->clear();
+
+        for(uint32_t i=0; i<structures.length(); ++i) {
+            if(!referenced[i]) {
+                tops->push_back(i);
+            }
+        }
+    }
+
+    int gdsFlattener::flatten(const char *strName, gdsFlatSink *sink)
+    {
+        uint32_t structure = library.findStructure(strName);
+
+        if(structure==GDS_NONE) {
+            std::cerr << "Error: structure " << strName
+                      << " is not in the library." << std::endl;
+            return 1;
+        }
+
+        return flatten(structure, sink);
+    }
+
+    int gdsFlattener::flatten(uint32_t structure, gdsFlatSink *sink,
+                              const gdsTransform &transform)
+    {
+        if(structure>=library.structures().length()) {
+            std::cerr << "Error: structure " << structure
+                      << " is not in the library." << std::endl;
+            return 1;
+        }
+
+        // A cycle would only be caught at MAX_DEPTH, after fanout^MAX_DEPTH
+        // instances.
+        uint32_t cycle = findCycle(structure);
+
+        if(cycle!=GDS_NONE) {
+            std::cerr << "Error: the hierarchy below "
+                      << library.string(
+                             library.structures()[structure].name)
+                      << " is recursive through "
+                      << library.string(library.structures()[cycle].name)
+                      << "." << std::endl;
+            return 1;
+        }
+
+        run state;
+        state.library = &library;
+        state.sink = sink;
+        state.pending = 0;
+        state.idle = 0;
+        state.tooDeep = false;
+        state.signals = 0;
+
+        for(unsigned int i=0; i<threads; ++i) {
+            state.workers.emplace_back(new run::worker);
+        }
+
+        run::task top = { structure, 0, transform };
+        state.push(0, top);
+
+        std::vector<std::thread> helpers;
+
+        for(unsigned int i=1; i<threads; ++i) {
+            helpers.emplace_back(work, &state, i);
+        }
+
+        work(&state, 0);
+
+        for(size_t i=0; i<helpers.size(); ++i) {
+            helpers[i].join();
+        }
+
+        if(state.tooDeep) {
+            std::cerr << "Error: the hierarchy below "
+                      << library.string(
+                             library.structures()[structure].name)
+                      << " is deeper than " << MAX_DEPTH << " levels."
+                      << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // Depth first search of the references below a structure, marking the
+    // structures on the current path grey and the finished ones black.
+    // Returns a structure that refers back to the path, or GDS_NONE.
+    uint32_t gdsFlattener::findCycle(uint32_t structure) const
+    {
+        enum { WHITE, GREY, BLACK };
+        const gdsArray<gdsStructure> &structures = library.structures();
+        const gdsArray<gdsReference> &references = library.references();
+        std::vector<unsigned char> color(structures.length(), WHITE);
+        std::vector<std::pair<uint32_t, uint32_t> > path;
+        path.push_back(std::make_pair(structure, 0U));
+        color[structure] = GREY;
+
+        while(!path.empty()) {
+            uint32_t current = path.back().first;
+            uint32_t next = path.back().second++;
+            const gdsStructure &cell = structures[current];
+
+            if(next==cell.referenceCount) {
+                color[current] = BLACK;
+                path.pop_back();
+                continue;
+            }
+
+            uint32_t child = references[cell.firstReference + next].structure;
+
+            if(child==GDS_NONE || color[child]==BLACK) {
+                continue;
+            }
+
+            if(color[child]==GREY) {
+                return current;
+            }
+
+            color[child] = GREY;
+            path.push_back(std::make_pair(child, 0U));
+        }
+
+        return GDS_NONE;
+    }
+
+    void gdsFlattener::work(run *state, unsigned int thread)
+    {
+        bool waiting = false;
+        run::task item;
+
+        for(;;) {
+            // Read before looking for a task, so that a task pushed after
+            // the search has missed it changes the count and ends the sleep.
+            unsigned long seen = state->signals.load();
+
+            if(state->take(thread, &item)) {
+                if(waiting) {
+                    state->idle.fetch_sub(1);
+                    waiting = false;
+                }
+
+                expand(state, thread, item.structure, item.transform,
+                       item.depth);
+                state->finish();
+            } else if(state->pending.load()==0) {
+                break;
+            } else {
+                if(!waiting) {
+                    state->idle.fetch_add(1);
+                    waiting = true;
+                }
+
+                state->sleep(seen);
+            }
+        }
+
+        if(waiting) {
+            state->idle.fetch_sub(1);
+        }
+    }
+
+    void gdsFlattener::expand(run *state, unsigned int thread,
+                              uint32_t structure, const gdsTransform &transform,
+                              unsigned int depth)
+    {
+        if(depth>MAX_DEPTH) {
+            state->tooDeep = true;
+        }
+
+        if(state->tooDeep) {
+            return;
+        }
+
+        const gdsLibrary &library = *state->library;
+        const gdsStructure &cell = library.structures()[structure];
+        gdsCoordinateBuffer &coordinates = state->workers[thread]->coordinates;
+        double scale = sqrt(fabs(transform.a * transform.d -
+                                 transform.b * transform.c));
+        gdsFlatShape flat;
+        flat.structure = structure;
+
+        for(uint32_t r=0; r<cell.rangeCount; ++r) {
+            const gdsLayerRange &range = library.ranges()[cell.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+            flat.layer = layer.number;
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                const gdsShape &shape = layer.shapes[range.firstShape + s];
+                const int *x = layer.x.data() + shape.firstPoint;
+                const int *y = layer.y.data() + shape.firstPoint;
+                coordinates.reserve(shape.pointCount);
+                int *outX = coordinates.x();
+                int *outY = coordinates.y();
+
+                for(uint32_t i=0; i<shape.pointCount; ++i) {
+                    outX[i] = (int)lrint(transform.a * x[i] +
+                                         transform.b * y[i] + transform.tx);
+                    outY[i] = (int)lrint(transform.c * x[i] +
+                                         transform.d * y[i] + transform.ty);
+                }
+
+                flat.x = outX;
+                flat.y = outY;
+                flat.count = shape.pointCount;
+                flat.width = (int)lrint(shape.width * scale);
+                flat.dataType = shape.dataType;
+                flat.type = shape.type;
+                flat.pathType = shape.pathType;
+                state->sink->onFlatShape(thread, flat);
+            }
+        }
+
+        for(uint32_t i=0; i<cell.referenceCount; ++i) {
+            const gdsReference &reference =
+                library.references()[cell.firstReference + i];
+
+            if(reference.structure==GDS_NONE) {
+                continue;
+            }
+
+            unsigned int columns = reference.type==AREF ? reference.columns : 1;
+            unsigned int rows = reference.type==AREF ? reference.rows : 1;
+
+            for(unsigned int row=0; row<rows; ++row) {
+                for(unsigned int column=0; column<columns; ++column) {
+                    run::task child;
+                    child.structure = reference.structure;
+                    child.depth = depth + 1;
+                    child.transform = transform * gdsTransform::placement(
+                        reference, column, row);
+
+                    // Only make the instance stealable when someone waits
+                    // for work, otherwise expand it right here.
+                    if(state->idle.load(std::memory_order_relaxed)>0) {
+                        state->push(thread, child);
+                    } else {
+                        expand(state, thread, child.structure,
+                               child.transform, child.depth);
+                    }
+
+                    if(state->tooDeep) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+} // End namespace gdsfp
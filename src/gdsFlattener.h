@@ -0,0 +1,132 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSFLATTENER_H_
+#define GDSFLATTENER_H_
+
+#include "gdsLibrary.h"
+#include <cstdint>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Affine transform x' = a * x + b * y + tx, y' = c * x + d * y + ty.
+     */
+    struct gdsTransform {
+        double a, b, c, d;
+        double tx, ty;
+
+        static gdsTransform identity();
+
+        // Placement of instance (column, row) of a reference: reflection
+        // about the x axis when STRANS bit 15 is set, then MAG, then ANGLE
+        // counterclockwise in degrees, then the translation to the origin
+        // (or to its lattice point for an AREF).  The absolute MAG and
+        // ANGLE bits are treated like relative ones.
+        static gdsTransform placement(const gdsReference &reference,
+                                      unsigned int column = 0,
+                                      unsigned int row = 0);
+
+        // The transform that applies other first and then this one.
+        gdsTransform operator*(const gdsTransform &other) const;
+        gdsTransform inverse() const;
+        // True when there is no usable inverse, as for a MAG of 0 that
+        // collapses an instance to a point.
+        bool isSingular() const;
+    };
+
+    // A shape placed in the coordinates of the top structure.  PATHs keep
+    // their center line, with the width scaled by the magnification.
+    struct gdsFlatShape {
+        const int *x;
+        const int *y;
+        uint32_t count;
+        uint32_t structure;             // Where the shape is defined.
+        int width;
+        unsigned short layer;
+        unsigned short dataType;
+        unsigned char type;             // BOUNDARY, PATH, BOX or NODE.
+        unsigned char pathType;
+    };
+
+    /*
+     *  Receives the flattened shapes.  onFlatShape() is called from all the
+     *  worker threads at once, thread is the index of the caller, from 0 to
+     *  gdsFlattener::threadCount() - 1, so a sink can keep one accumulator
+     *  per thread instead of locking.  The coordinates are only valid
+     *  during the call.
+     */
+    class gdsFlatSink
+    {
+    public:
+        virtual ~gdsFlatSink() {};
+        virtual void onFlatShape(unsigned int thread,
+                                 const gdsFlatShape &shape) = 0;
+    };
+
+    /*
+     *  Expands the SREF and AREF hierarchy below a structure and streams
+     *  every shape of every instance to a sink, so the flat layout is
+     *  never held in memory.  Instances are expanded depth first on the
+     *  calling worker; while other workers are idle new instances are put
+     *  on the worker's deque instead, where idle workers steal the oldest,
+     *  and therefore largest, subtrees from.  References to structures that
+     *  are not in the library are skipped.  A recursive hierarchy is
+     *  rejected before anything is expanded.
+     */
+    class gdsFlattener
+    {
+    public:
+        // The thread count goes through gdsThreadCount().
+        explicit gdsFlattener(const gdsLibrary &library,
+                              unsigned int threads = 0);
+
+        int flatten(const char *strName, gdsFlatSink *sink);
+        int flatten(uint32_t structure, gdsFlatSink *sink,
+                    const gdsTransform &transform = gdsTransform::identity());
+
+        // Structures that no other structure refers to.
+        void topStructures(std::vector<uint32_t> *tops) const;
+
+        unsigned int threadCount() const;
+
+        static const unsigned int MAX_DEPTH = 64;
+
+    private:
+        struct run;
+
+        uint32_t findCycle(uint32_t structure) const;
+        static void work(run *state, unsigned int thread);
+        static void expand(run *state, unsigned int thread,
+                           uint32_t structure, const gdsTransform &transform,
+                           unsigned int depth);
+
+        const gdsLibrary &library;
+        unsigned int threads;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSFLATTENER_H_
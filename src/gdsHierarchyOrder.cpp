@@ -0,0 +1,119 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include "gdsHierarchyOrder.h"
+#include <cstdint>
+#include <utility>
+
+namespace gdsfp
+{
+    // Tarjan's strongly connected components, with an explicit stack since
+    // hierarchies can be deep.  A structure is finished once all of its
+    // children are, which gives the order; the structures of a component
+    // with more than one structure, or with a reference to itself, are on
+    // a cycle.
+    void orderHierarchy(const std::vector<size_t> &childStarts,
+                        const std::vector<int64_t> &children,
+                        std::vector<size_t> *order,
+                        std::vector<size_t> *rank,
+                        std::vector<bool> *cyclic)
+    {
+        const size_t UNVISITED = SIZE_MAX;
+        size_t count = childStarts.empty() ? 0 : childStarts.size() - 1;
+        std::vector<size_t> visit(count, UNVISITED);   // Discovery order.
+        std::vector<size_t> low(count);
+        std::vector<bool> open(count, false);   // On the component stack.
+        std::vector<size_t> component;
+        std::vector<std::pair<size_t, size_t> > stack;  // Structure, child.
+        size_t visited = 0;
+        order->clear();
+        order->reserve(count);
+        rank->assign(count, 0);
+        cyclic->assign(count, false);
+
+        for(size_t root=0; root<count; ++root) {
+            if(visit[root]!=UNVISITED) {
+                continue;
+            }
+
+            visit[root] = low[root] = visited++;
+            open[root] = true;
+            component.push_back(root);
+            stack.push_back(std::make_pair(root, childStarts[root]));
+
+            while(!stack.empty()) {
+                size_t s = stack.back().first;
+                size_t c = stack.back().second;
+
+                if(c<childStarts[s + 1]) {
+                    int64_t child = children[c];
+                    ++stack.back().second;
+
+                    if(child<0) {
+                        continue;
+                    }
+
+                    if((size_t)child==s) {
+                        (*cyclic)[s] = true;
+                    } else if(visit[child]==UNVISITED) {
+                        visit[child] = low[child] = visited++;
+                        open[child] = true;
+                        component.push_back(child);
+                        stack.push_back(std::make_pair((size_t)child,
+                                                       childStarts[child]));
+                    } else if(open[child] && visit[child]<low[s]) {
+                        low[s] = visit[child];
+                    }
+
+                    continue;
+                }
+
+                (*rank)[s] = order->size();
+                order->push_back(s);
+                stack.pop_back();
+
+                if(!stack.empty() && low[s]<low[stack.back().first]) {
+                    low[stack.back().first] = low[s];
+                }
+
+                if(low[s]==visit[s]) {
+                    bool loop = component.back()!=s;
+
+                    for(size_t member=SIZE_MAX; member!=s;) {
+                        member = component.back();
+                        component.pop_back();
+                        open[member] = false;
+
+                        if(loop) {
+                            (*cyclic)[member] = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+} // End namespace gdsfp
@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSHIERARCHYORDER_H_
+#define GDSHIERARCHYORDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Orders the structures of a hierarchy children first, so that every
+     *  structure can be resolved from the structures it references.  The
+     *  references of structure s are children[childStarts[s]] up to
+     *  children[childStarts[s + 1]], each the structure it names or -1
+     *  when the name isn't defined.  The walk is depth first from the
+     *  structures in their own order.
+     *
+     *  order lists the structures children first and rank[s] is the
+     *  position of s in it.  A child with a lower rank than its parent is
+     *  resolved before it; one with the same or a higher rank closes a
+     *  cycle.  Every structure that lies on a cycle, through whichever of
+     *  its references, is set in cyclic.
+     */
+    void orderHierarchy(const std::vector<size_t> &childStarts,
+                        const std::vector<int64_t> &children,
+                        std::vector<size_t> *order,
+                        std::vector<size_t> *rank,
+                        std::vector<bool> *cyclic);
+
+} // End namespace gdsfp
+
+#endif //GDSHIERARCHYORDER_H_
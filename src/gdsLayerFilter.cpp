@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsLayerFilter.h"
+#include <cctype>
+#include <cstdlib>
+
+namespace gdsfp
+{
+    // Reads "*", "N" or "N-M" and moves the cursor past it.
+    static int parseRange(const char **cursor, unsigned short *first,
+                          unsigned short *last)
+    {
+        const char *p = *cursor;
+
+        if(*p=='*') {
+            (*first) = 0;
+            (*last) = 65535;
+            *cursor = p + 1;
+            return 0;
+        }
+
+        char *end;
+        unsigned long value = strtoul(p, &end, 10);
+
+        if(end==p || value>65535 || *p=='-' || *p=='+') {
+            return 1;
+        }
+
+        (*first) = (*last) = value;
+        p = end;
+
+        if(*p=='-') {
+            ++p;
+            value = strtoul(p, &end, 10);
+
+            if(end==p || value>65535 || value<(*first) || !isdigit(*p)) {
+                return 1;
+            }
+
+            (*last) = value;
+            p = end;
+        }
+
+        *cursor = p;
+        return 0;
+    }
+
+    int gdsLayerFilter::parse(const char *spec)
+    {
+        clear();
+        const char *p = spec;
+
+        while(*p!='\0') {
+            if(*p==',' || *p==';' || isspace((unsigned char)*p)) {
+                ++p;
+                continue;
+            }
+
+            range entry;
+
+            if(parseRange(&p, &entry.firstLayer, &entry.lastLayer)!=0) {
+                clear();
+                return 1;
+            }
+
+            entry.firstType = 0;
+            entry.lastType = 65535;
+
+            if(*p=='/') {
+                ++p;
+
+                if(parseRange(&p, &entry.firstType, &entry.lastType)!=0) {
+                    clear();
+                    return 1;
+                }
+            }
+
+            if(*p!='\0' && *p!=',' && *p!=';' && !isspace((unsigned char)*p)) {
+                clear();
+                return 1;
+            }
+
+            ranges.push_back(entry);
+        }
+
+        return 0;
+    }
+
+    void gdsLayerFilter::add(unsigned short firstLayer, unsigned short lastLayer,
+                             unsigned short firstType, unsigned short lastType)
+    {
+        range entry = { firstLayer, lastLayer, firstType, lastType };
+        ranges.push_back(entry);
+    }
+
+    void gdsLayerFilter::clear()
+    {
+        ranges.clear();
+    }
+
+    bool gdsLayerFilter::accepts(unsigned short layer,
+                                 unsigned short dataType) const
+    {
+        for(size_t i=0; i<ranges.size(); ++i) {
+            const range &entry = ranges[i];
+
+            if(layer>=entry.firstLayer && layer<=entry.lastLayer &&
+               dataType>=entry.firstType && dataType<=entry.lastType) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool gdsLayerFilter::empty() const
+    {
+        return ranges.empty();
+    }
+} // End namespace gdsfp
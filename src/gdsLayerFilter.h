@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSLAYERFILTER_H_
+#define GDSLAYERFILTER_H_
+
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  A set of layer/datatype pairs.  The datatype also stands for the
+     *  texttype of TEXT, the boxtype of BOX and the nodetype of NODE
+     *  elements.  Specifications are written as a list of layer[/datatype]
+     *  entries separated by commas, where each side is a number, a range or
+     *  "*", e.g. "1-10/0, 63, 100/1-4".  A missing datatype means any, the
+     *  same as a "*" one.
+     */
+    class gdsLayerFilter
+    {
+    public:
+        int parse(const char *spec);
+        void add(unsigned short firstLayer, unsigned short lastLayer,
+                 unsigned short firstType, unsigned short lastType);
+        void clear();
+
+        bool accepts(unsigned short layer, unsigned short dataType) const;
+        bool empty() const;
+
+    private:
+        struct range {
+            unsigned short firstLayer, lastLayer;
+            unsigned short firstType, lastType;
+        };
+
+        std::vector<range> ranges;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSLAYERFILTER_H_
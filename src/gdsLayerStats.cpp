@@ -0,0 +1,668 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsLayerStats.h"
+#include "gdsFlattener.h"
+#include "gdsHierarchyOrder.h"
+#include "gdsParallelParser.h"
+#include "gdsStructureIndex.h"
+#include "gdsThreadCount.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GDSFP_X86 1
+#endif
+
+using namespace std;
+
+namespace gdsfp
+{
+    static gdsLayerTotals emptyTotals(unsigned short layer,
+                                      unsigned short dataType)
+    {
+        gdsLayerTotals totals;
+        memset(&totals, 0, sizeof(totals));
+        totals.layer = layer;
+        totals.dataType = dataType;
+        totals.left = totals.bottom = LLONG_MAX;
+        totals.right = totals.top = LLONG_MIN;
+        return totals;
+    }
+
+    static bool before(const gdsLayerTotals &a, const gdsLayerTotals &b)
+    {
+        return a.layer<b.layer || (a.layer==b.layer && a.dataType<b.dataType);
+    }
+
+    // The slot of the layer and data type in a sorted list, added if needed.
+    static gdsLayerTotals &sortedSlot(vector<gdsLayerTotals> *list,
+                                      unsigned short layer,
+                                      unsigned short dataType)
+    {
+        gdsLayerTotals key = emptyTotals(layer, dataType);
+        vector<gdsLayerTotals>::iterator it =
+            lower_bound(list->begin(), list->end(), key, before);
+
+        if(it==list->end() || it->layer!=layer || it->dataType!=dataType) {
+            it = list->insert(it, key);
+        }
+
+        return *it;
+    }
+
+    // Sum of x[i] * y[i + 1] - x[i + 1] * y[i] for i from first on.  Every
+    // product fits in 64 bits and the sum wraps around in unsigned
+    // arithmetic, which is exact as long as the final area fits.
+    static unsigned long long shoelaceScalar(const int *x, const int *y,
+                                             size_t first, size_t count)
+    {
+        unsigned long long sum = 0;
+
+        for(size_t i=first; i + 1<count; ++i) {
+            sum += (unsigned long long)((long long)x[i] * y[i + 1]) -
+                   (unsigned long long)((long long)x[i + 1] * y[i]);
+        }
+
+        return sum;
+    }
+
+#ifdef GDSFP_X86
+    __attribute__((target("avx2")))
+    static unsigned long long shoelaceAvx2(const int *x, const int *y,
+                                           size_t first, size_t count)
+    {
+        // Four terms per step, each 32 bit coordinate sign extended to a
+        // 64 bit lane for the signed 32 x 32 bit multiply.
+        __m256i sum = _mm256_setzero_si256();
+        size_t i = first;
+
+        for(; i + 5<=count; i+=4) {
+            __m256i x0 = _mm256_cvtepi32_epi64(
+                _mm_loadu_si128((const __m128i *)(x + i)));
+            __m256i x1 = _mm256_cvtepi32_epi64(
+                _mm_loadu_si128((const __m128i *)(x + i + 1)));
+            __m256i y0 = _mm256_cvtepi32_epi64(
+                _mm_loadu_si128((const __m128i *)(y + i)));
+            __m256i y1 = _mm256_cvtepi32_epi64(
+                _mm_loadu_si128((const __m128i *)(y + i + 1)));
+            sum = _mm256_add_epi64(sum, _mm256_sub_epi64(
+                _mm256_mul_epi32(x0, y1), _mm256_mul_epi32(x1, y0)));
+        }
+
+        unsigned long long lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, sum);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+               shoelaceScalar(x, y, i, count);
+    }
+#endif
+
+    typedef unsigned long long (*shoelaceFunction)(const int *, const int *,
+                                                   size_t, size_t);
+
+    static shoelaceFunction selectShoelace()
+    {
+#ifdef GDSFP_X86
+        __builtin_cpu_init();
+
+        if(__builtin_cpu_supports("avx2")) {
+            return shoelaceAvx2;
+        }
+#endif
+        return shoelaceScalar;
+    }
+
+    // Twice the signed area by the shoelace formula, closed or not.
+    static long long twiceArea(const int *x, const int *y, size_t count)
+    {
+        static const shoelaceFunction best = selectShoelace();
+        unsigned long long sum = best(x, y, 0, count);
+        sum += (unsigned long long)((long long)x[count - 1] * y[0]) -
+               (unsigned long long)((long long)x[0] * y[count - 1]);
+        return (long long)sum;
+    }
+
+    static double centerLength(const int *x, const int *y, size_t count)
+    {
+        double length = 0.0;
+
+        for(size_t i=0; i + 1<count; ++i) {
+            double dx = (double)x[i + 1] - x[i];
+            double dy = (double)y[i + 1] - y[i];
+            length += sqrt(dx * dx + dy * dy);
+        }
+
+        return length;
+    }
+
+    static void extend(gdsLayerTotals *totals, const int *x, const int *y,
+                       size_t count)
+    {
+        int left = INT_MAX, bottom = INT_MAX, right = INT_MIN, top = INT_MIN;
+
+        for(size_t i=0; i<count; ++i) {
+            left = min(left, x[i]);
+            right = max(right, x[i]);
+            bottom = min(bottom, y[i]);
+            top = max(top, y[i]);
+        }
+
+        if(count>0) {
+            totals->left = min(totals->left, (long long)left);
+            totals->right = max(totals->right, (long long)right);
+            totals->bottom = min(totals->bottom, (long long)bottom);
+            totals->top = max(totals->top, (long long)top);
+        }
+    }
+
+    // Adds the totals of a placed structure.  Counts are multiplied by the
+    // instances, the area by the square of the magnification, lengths by
+    // the magnification, and the bounding box is the union of the boxes of
+    // the given placements.
+    static void addPlaced(gdsLayerTotals *to, const gdsLayerTotals &from,
+                          unsigned long long instances, double mag,
+                          const gdsTransform placements[],
+                          unsigned int placementCount)
+    {
+        to->boundaries += from.boundaries * instances;
+        to->paths += from.paths * instances;
+        to->boxes += from.boxes * instances;
+        to->nodes += from.nodes * instances;
+        to->texts += from.texts * instances;
+        to->vertices += from.vertices * instances;
+        to->area += from.area * mag * mag * instances;
+        to->pathLength += from.pathLength * mag * instances;
+
+        if(from.left>from.right) {
+            return;
+        }
+
+        const double cx[4] = { (double)from.left, (double)from.right,
+                               (double)from.right, (double)from.left };
+        const double cy[4] = { (double)from.bottom, (double)from.bottom,
+                               (double)from.top, (double)from.top };
+
+        for(unsigned int p=0; p<placementCount; ++p) {
+            const gdsTransform &t = placements[p];
+
+            for(int i=0; i<4; ++i) {
+                double x = t.a * cx[i] + t.b * cy[i] + t.tx;
+                double y = t.c * cx[i] + t.d * cy[i] + t.ty;
+                to->left = min(to->left, (long long)floor(x));
+                to->right = max(to->right, (long long)ceil(x));
+                to->bottom = min(to->bottom, (long long)floor(y));
+                to->top = max(to->top, (long long)ceil(y));
+            }
+        }
+    }
+
+    static void addTotals(vector<gdsLayerTotals> *list,
+                          const vector<gdsLayerTotals> &from)
+    {
+        const gdsTransform identity = gdsTransform::identity();
+
+        for(size_t i=0; i<from.size(); ++i) {
+            addPlaced(&sortedSlot(list, from[i].layer, from[i].dataType),
+                      from[i], 1, 1.0, &identity, 1);
+        }
+    }
+
+    gdsLayerStats::gdsLayerStats()
+    {
+        clear();
+    }
+
+    void gdsLayerStats::clear()
+    {
+        cells.clear();
+        element = 0;
+        layer = 0;
+        dataType = 0;
+        last = 0;
+    }
+
+    void gdsLayerStats::startElement(unsigned char type)
+    {
+        element = type;
+        layer = 0;
+        dataType = 0;
+        x.clear();
+        y.clear();
+        sname.clear();
+
+        memset(&reference, 0, sizeof(reference));
+        reference.structure = GDS_NONE;
+        reference.mag = 1.0;
+        reference.columns = reference.rows = 1;
+        reference.type = type;
+    }
+
+    // Structures have few layers, and elements of one layer mostly come in
+    // runs, so the last slot is tried first and a linear search does.
+    gdsLayerTotals &gdsLayerStats::slot()
+    {
+        vector<gdsLayerTotals> &layers = cells.back().layers;
+
+        if(last<layers.size() && layers[last].layer==layer &&
+           layers[last].dataType==dataType) {
+            return layers[last];
+        }
+
+        for(last=0; last<layers.size(); ++last) {
+            if(layers[last].layer==layer && layers[last].dataType==dataType) {
+                return layers[last];
+            }
+        }
+
+        layers.push_back(emptyTotals(layer, dataType));
+        return layers.back();
+    }
+
+    void gdsLayerStats::onParsedStrName(const char *strName)
+    {
+        onParsedStrNameView(strName);
+    }
+
+    void gdsLayerStats::onParsedStrNameView(std::string_view strName)
+    {
+        cells.push_back(cell());
+        cells.back().name.assign(strName.data(), strName.size());
+        last = 0;
+    }
+
+    void gdsLayerStats::onParsedBoundaryStart()
+    {
+        startElement(BOUNDARY);
+    }
+
+    void gdsLayerStats::onParsedPathStart()
+    {
+        startElement(PATH);
+    }
+
+    void gdsLayerStats::onParsedBoxStart()
+    {
+        startElement(BOX);
+    }
+
+    void gdsLayerStats::onParsedNodeStart()
+    {
+        startElement(NODE);
+    }
+
+    void gdsLayerStats::onParsedTextStart()
+    {
+        startElement(TEXT);
+    }
+
+    void gdsLayerStats::onParsedSrefStart()
+    {
+        startElement(SREF);
+    }
+
+    void gdsLayerStats::onParsedArefStart()
+    {
+        startElement(AREF);
+    }
+
+    void gdsLayerStats::onParsedEndElement()
+    {
+        if(cells.empty() || element==0) {
+            element = 0;
+            return;
+        }
+
+        size_t count = x.size();
+
+        if(element==SREF || element==AREF) {
+            for(size_t i=0; i<count && i<3; ++i) {
+                reference.x[i] = x[i];
+                reference.y[i] = y[i];
+            }
+
+            cells.back().references.push_back(reference);
+            cells.back().snames.push_back(sname);
+            element = 0;
+            return;
+        }
+
+        gdsLayerTotals &totals = slot();
+
+        switch(element) {
+            case BOUNDARY:
+            case BOX: {
+                if(element==BOUNDARY) {
+                    ++totals.boundaries;
+                } else {
+                    ++totals.boxes;
+                }
+
+                bool closed = count>1 && x[0]==x[count - 1] &&
+                              y[0]==y[count - 1];
+                totals.vertices += closed ? count - 1 : count;
+
+                if(count>2) {
+                    totals.area += fabs((double)twiceArea(&x[0], &y[0],
+                                                          count)) / 2.0;
+                }
+
+                break;
+            }
+
+            case PATH:
+                ++totals.paths;
+                totals.vertices += count;
+                totals.pathLength += centerLength(x.data(), y.data(), count);
+                break;
+
+            case NODE:
+                ++totals.nodes;
+                totals.vertices += count;
+                break;
+
+            case TEXT:
+                ++totals.texts;
+                break;
+        }
+
+        extend(&totals, x.data(), y.data(), count);
+        element = 0;
+    }
+
+    void gdsLayerStats::onParsedColumnsRows(unsigned short columns,
+                                            unsigned short rows)
+    {
+        reference.columns = columns;
+        reference.rows = rows;
+    }
+
+    void gdsLayerStats::onParsedStrans(short strans)
+    {
+        reference.strans = strans;
+    }
+
+    void gdsLayerStats::onParsedSname(const char *sname)
+    {
+        onParsedSnameView(sname);
+    }
+
+    void gdsLayerStats::onParsedSnameView(std::string_view sname)
+    {
+        this->sname.assign(sname.data(), sname.size());
+    }
+
+    // Long elements are split over several XY records.
+    void gdsLayerStats::onParsedXY(int count, int x[], int y[])
+    {
+        this->x.insert(this->x.end(), x, x + count);
+        this->y.insert(this->y.end(), y, y + count);
+    }
+
+    void gdsLayerStats::onParsedLayer(unsigned short layer)
+    {
+        this->layer = layer;
+    }
+
+    void gdsLayerStats::onParsedDataType(unsigned short dataType)
+    {
+        this->dataType = dataType;
+    }
+
+    void gdsLayerStats::onParsedTextType(unsigned short textType)
+    {
+        dataType = textType;
+    }
+
+    void gdsLayerStats::onParsedAngle(double angle)
+    {
+        reference.angle = angle;
+    }
+
+    void gdsLayerStats::onParsedMag(double mag)
+    {
+        reference.mag = mag;
+    }
+
+    void gdsLayerStats::onParsedNodeType(unsigned short nodeType)
+    {
+        dataType = nodeType;
+    }
+
+    void gdsLayerStats::onParsedBoxType(unsigned short boxType)
+    {
+        dataType = boxType;
+    }
+
+    gdsLayerReport::gdsLayerReport(unsigned int threads)
+        : threads(gdsThreadCount(threads))
+    {
+    }
+
+    int gdsLayerReport::collect(const char *filePath)
+    {
+        gdsStructureIndex index;
+
+        if(index.open(filePath)!=0) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        vector<gdsLayerStats> stats(threads);
+        vector<gdsLayerStats *> accumulators(threads);
+        vector<gdsFileParser *> handlers(threads);
+
+        for(unsigned int i=0; i<threads; ++i) {
+            accumulators[i] = &stats[i];
+            handlers[i] = &stats[i];
+        }
+
+        gdsParallelParser parser(threads);
+
+        if(parser.parse(filePath, index, handlers.data(), threads)!=0) {
+            return 1;
+        }
+
+        merge(accumulators.data(), threads, &index);
+        return 0;
+    }
+
+    void gdsLayerReport::merge(gdsLayerStats *const stats[],
+                               unsigned int count,
+                               const gdsStructureIndex *index)
+    {
+        found.clear();
+        lookup.clear();
+        flatSum.clear();
+        hierarchySum.clear();
+
+        // The index gives the file order; structures it doesn't know of
+        // follow in the order the accumulators have them.
+        if(index!=NULL) {
+            const vector<gdsStructureEntry> &entries = index->structures();
+
+            for(size_t i=0; i<entries.size(); ++i) {
+                if(lookup.find(entries[i].name)==lookup.end()) {
+                    lookup[entries[i].name] = found.size();
+                    found.push_back(gdsStructureLayers());
+                    found.back().name = entries[i].name;
+                    found.back().cyclic = false;
+                }
+            }
+        }
+
+        for(unsigned int s=0; s<count; ++s) {
+            const vector<gdsLayerStats::cell> &cells = stats[s]->cells;
+
+            for(size_t c=0; c<cells.size(); ++c) {
+                if(lookup.find(cells[c].name)==lookup.end()) {
+                    lookup[cells[c].name] = found.size();
+                    found.push_back(gdsStructureLayers());
+                    found.back().name = cells[c].name;
+                    found.back().cyclic = false;
+                }
+            }
+        }
+
+        resolve(stats, count);
+    }
+
+    // A name defined more than once counts all its definitions.
+    void gdsLayerReport::resolve(gdsLayerStats *const stats[],
+                                 unsigned int count)
+    {
+        struct placement {
+            size_t child;
+            const gdsReference *reference;
+        };
+
+        vector<vector<placement> > placements(found.size());
+        vector<bool> referenced(found.size(), false);
+
+        for(unsigned int s=0; s<count; ++s) {
+            const vector<gdsLayerStats::cell> &cells = stats[s]->cells;
+
+            for(size_t c=0; c<cells.size(); ++c) {
+                size_t parent = lookup[cells[c].name];
+                addTotals(&found[parent].flat, cells[c].layers);
+
+                for(size_t r=0; r<cells[c].references.size(); ++r) {
+                    unordered_map<string, size_t>::const_iterator it =
+                        lookup.find(cells[c].snames[r]);
+
+                    if(it!=lookup.end()) {
+                        placement entry = { it->second,
+                                            &cells[c].references[r] };
+                        placements[parent].push_back(entry);
+                        referenced[it->second] = true;
+                    }
+                }
+            }
+        }
+
+        // Children before their parents.
+        vector<size_t> childStarts(1, 0), order, rank;
+        vector<int64_t> children;
+        vector<bool> cycles;
+
+        for(size_t s=0; s<found.size(); ++s) {
+            for(size_t p=0; p<placements[s].size(); ++p) {
+                children.push_back(placements[s][p].child);
+            }
+
+            childStarts.push_back(children.size());
+        }
+
+        orderHierarchy(childStarts, children, &order, &rank, &cycles);
+
+        for(size_t o=0; o<order.size(); ++o) {
+            size_t s = order[o];
+            gdsStructureLayers &target = found[s];
+            target.hierarchy = target.flat;
+
+            for(size_t i=0; i<placements[s].size(); ++i) {
+                const gdsStructureLayers &child =
+                    found[placements[s][i].child];
+                const gdsReference &reference = *placements[s][i].reference;
+
+                // A reference back up the hierarchy is left out.
+                if(rank[placements[s][i].child]>=o) {
+                    target.cyclic = true;
+                    continue;
+                }
+
+                // The lattice corners bound the boxes of all instances.
+                unsigned int columns = reference.type==AREF ?
+                                       reference.columns : 1;
+                unsigned int rows = reference.type==AREF ?
+                                    reference.rows : 1;
+                gdsTransform corners[4];
+                unsigned int cornerCount = 0;
+
+                for(unsigned int row=0; row<2; ++row) {
+                    for(unsigned int column=0; column<2; ++column) {
+                        if((column==1 && columns<2) ||
+                           (row==1 && rows<2)) {
+                            continue;
+                        }
+
+                        corners[cornerCount++] = gdsTransform::placement(
+                            reference, column * (columns - 1),
+                            row * (rows - 1));
+                    }
+                }
+
+                unsigned long long instances =
+                    (unsigned long long)columns * rows;
+                double mag = fabs(reference.mag);
+
+                for(size_t l=0; l<child.hierarchy.size(); ++l) {
+                    const gdsLayerTotals &from = child.hierarchy[l];
+                    addPlaced(&sortedSlot(&target.hierarchy, from.layer,
+                                          from.dataType),
+                              from, instances, mag, corners, cornerCount);
+                }
+            }
+        }
+
+        for(size_t i=0; i<found.size(); ++i) {
+            addTotals(&flatSum, found[i].flat);
+
+            if(!referenced[i]) {
+                addTotals(&hierarchySum, found[i].hierarchy);
+            }
+        }
+    }
+
+    const vector<gdsStructureLayers> &gdsLayerReport::structures() const
+    {
+        return found;
+    }
+
+    const gdsStructureLayers *gdsLayerReport::find(const string &name) const
+    {
+        unordered_map<string, size_t>::const_iterator it = lookup.find(name);
+        return it==lookup.end() ? NULL : &found[it->second];
+    }
+
+    const vector<gdsLayerTotals> &gdsLayerReport::flatTotals() const
+    {
+        return flatSum;
+    }
+
+    const vector<gdsLayerTotals> &gdsLayerReport::hierarchyTotals() const
+    {
+        return hierarchySum;
+    }
+
+    unsigned int gdsLayerReport::threadCount() const
+    {
+        return threads;
+    }
+
+} // End namespace gdsfp
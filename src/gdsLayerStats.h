@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSLAYERSTATS_H_
+#define GDSLAYERSTATS_H_
+
+#include "gdsFileParser.h"
+#include "gdsLibrary.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gdsfp
+{
+    class gdsStructureIndex;
+
+    /*
+     *  What one layer and data type holds.  Areas are in database units
+     *  squared, lengths in database units.  The bounding box is that of the
+     *  points, without PATH widths, and is empty while left>right.
+     */
+    struct gdsLayerTotals {
+        unsigned short layer;
+        unsigned short dataType;        // Or texttype, nodetype, boxtype.
+        unsigned long long boundaries;
+        unsigned long long paths;
+        unsigned long long boxes;
+        unsigned long long nodes;
+        unsigned long long texts;
+        unsigned long long vertices;    // Without the closing points.
+        double area;                    // Of the BOUNDARYs and BOXes.
+        double pathLength;              // Of the PATH center lines.
+        long long left;
+        long long bottom;
+        long long right;
+        long long top;
+    };
+
+    struct gdsStructureLayers {
+        std::string name;
+        std::vector<gdsLayerTotals> flat;       // Its own elements.
+        std::vector<gdsLayerTotals> hierarchy;  // With every instance below.
+        bool cyclic;                    // A reference back up was left out.
+    };
+
+    /*
+     *  Collects per layer statistics from the parser callbacks, for every
+     *  structure on its own.  Each thread of a parse needs its own
+     *  gdsLayerStats; gdsLayerReport merges them.  Filters set on the
+     *  parser apply.
+     */
+    class gdsLayerStats : public gdsFileParser
+    {
+    public:
+        gdsLayerStats();
+
+        void clear();
+
+    protected:
+        void onParsedGDSVersion(unsigned short version) {};
+        void onParsedModTime(short year, short month, short day,
+                             short hour, short minute, short sec) {};
+        void onParsedAccessTime(short year, short month, short day,
+                                short hour, short minute, short sec) {};
+        void onParsedLibName(const char *libName) {};
+        void onParsedLibNameView(std::string_view libName) {};
+        void onParsedUnits(double userUnits, double databaseUnits) {};
+        void onParsedStrName(const char *strName);
+        void onParsedStrNameView(std::string_view strName);
+        void onParsedBoundaryStart();
+        void onParsedPathStart();
+        void onParsedBoxStart();
+        void onParsedEndElement();
+        void onParsedEndStructure() {};
+        void onParsedEndLib() {};
+        void onParsedColumnsRows(unsigned short columns,
+                                 unsigned short rows);
+        void onParsedPathType(unsigned short pathType) {};
+        void onParsedStrans(short strans);
+        void onParsedPresentation(short font, short valign, short halign) {};
+        void onParsedNodeStart();
+        void onParsedTextStart();
+        void onParsedSrefStart();
+        void onParsedArefStart();
+        void onParsedSname(const char *sname);
+        void onParsedSnameView(std::string_view sname);
+        void onParsedString(const char *str) {};
+        void onParsedStringView(std::string_view str) {};
+        void onParsedPropValue(const char *propValue) {};
+        void onParsedPropValueView(std::string_view propValue) {};
+        void onParsedXY(int count, int x[], int y[]);
+        void onParsedLayer(unsigned short layer);
+        void onParsedWidth(int width) {};
+        void onParsedDataType(unsigned short dataType);
+        void onParsedTextType(unsigned short textType);
+        void onParsedAngle(double angle);
+        void onParsedMag(double mag);
+        void onParsedBeginExtension(unsigned short bext) {};
+        void onParsedEndExtension(unsigned short eext) {};
+        void onParsedPropertyNumber(unsigned short propNum) {};
+        void onParsedNodeType(unsigned short nodeType);
+        void onParsedBoxType(unsigned short boxType);
+
+    private:
+        friend class gdsLayerReport;
+
+        struct cell {
+            std::string name;
+            std::vector<gdsLayerTotals> layers;
+            std::vector<gdsReference> references;
+            std::vector<std::string> snames;    // By reference.
+        };
+
+        void startElement(unsigned char type);
+        gdsLayerTotals &slot();
+
+        std::vector<cell> cells;
+        unsigned char element;                  // 0 outside of elements.
+        unsigned short layer;
+        unsigned short dataType;
+        std::vector<int> x;
+        std::vector<int> y;
+        gdsReference reference;
+        std::string sname;
+        size_t last;                            // Slot of the last element.
+    };
+
+    /*
+     *  Per layer statistics of a whole library: element counts, vertices,
+     *  polygon area, path length and bounding box, for each structure by
+     *  itself and with everything it places.
+     *
+     *  collect() parses the structures on several threads, one gdsLayerStats
+     *  per thread, and merges them afterwards.  The hierarchy totals of a
+     *  structure add those of every structure it references once per
+     *  instance, an AREF counting columns times rows, with areas scaled by
+     *  MAG squared, lengths by MAG and the bounding boxes transformed; below
+     *  a rotation that isn't a multiple of 90 degrees a box is the one
+     *  around the rotated box, so it can be larger than the shapes.
+     *  References to structures the library doesn't have are left out, and
+     *  so are references that close a cycle.
+     *
+     *      gdsLayerReport report(8);
+     *      report.collect("chip.gds");
+     *      const std::vector<gdsLayerTotals> &chip = report.hierarchyTotals();
+     */
+    class gdsLayerReport
+    {
+    public:
+        // The thread count goes through gdsThreadCount().
+        explicit gdsLayerReport(unsigned int threads = 0);
+
+        int collect(const char *filePath);
+
+        // Merges accumulators the caller has run itself.  The structures
+        // are kept in the order of the index, when there is one.
+        void merge(gdsLayerStats *const stats[], unsigned int count,
+                   const gdsStructureIndex *index = NULL);
+
+        const std::vector<gdsStructureLayers> &structures() const;
+        const gdsStructureLayers *find(const std::string &name) const;
+
+        // The flat totals of all structures added up, and the hierarchy
+        // totals of the structures no other structure references.
+        const std::vector<gdsLayerTotals> &flatTotals() const;
+        const std::vector<gdsLayerTotals> &hierarchyTotals() const;
+
+        unsigned int threadCount() const;
+
+    private:
+        gdsLayerReport(const gdsLayerReport &);
+        gdsLayerReport &operator=(const gdsLayerReport &);
+
+        void resolve(gdsLayerStats *const stats[], unsigned int count);
+
+        unsigned int threads;
+        std::vector<gdsStructureLayers> found;
+        std::unordered_map<std::string, size_t> lookup;
+        std::vector<gdsLayerTotals> flatSum;
+        std::vector<gdsLayerTotals> hierarchySum;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSLAYERSTATS_H_
@@ -0,0 +1,584 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsLibrary.h"
+#include "gdsParallelParser.h"
+
+namespace gdsfp
+{
+    gdsLibrary::gdsLibrary()
+    {
+        clear();
+    }
+
+    int gdsLibrary::load(const char *filePath, unsigned int threads)
+    {
+        gdsLibraryBuilder builder(this);
+
+        if(threads>1) {
+            gdsParallelParser parallel(threads);
+            return parallel.parseOrdered(filePath, &builder);
+        }
+
+        return builder.parse(filePath);
+    }
+
+    void gdsLibrary::clear()
+    {
+        strings.clear();
+        strings.push_back('\0');        // Offset 0 is the empty string.
+        structureList.clear();
+        layerList.clear();
+        rangeList.clear();
+        textList.clear();
+        referenceList.clear();
+        propertyList.clear();
+        orderList.clear();
+        structureLookup.clear();
+        libName = 0;
+        gdsVersion = 0;
+        user = database = 0.0;
+        memset(libModified, 0, sizeof(libModified));
+        memset(libAccessed, 0, sizeof(libAccessed));
+    }
+
+    const char *gdsLibrary::name() const
+    {
+        return string(libName);
+    }
+
+    unsigned short gdsLibrary::version() const
+    {
+        return gdsVersion;
+    }
+
+    double gdsLibrary::userUnits() const
+    {
+        return user;
+    }
+
+    double gdsLibrary::databaseUnits() const
+    {
+        return database;
+    }
+
+    const short *gdsLibrary::modified() const
+    {
+        return libModified;
+    }
+
+    const short *gdsLibrary::accessed() const
+    {
+        return libAccessed;
+    }
+
+    const char *gdsLibrary::string(uint32_t offset) const
+    {
+        return strings.data() + offset;
+    }
+
+    uint32_t gdsLibrary::findStructure(const char *name) const
+    {
+        std::unordered_map<std::string, uint32_t>::const_iterator it =
+            structureLookup.find(name);
+        return it==structureLookup.end() ? GDS_NONE : it->second;
+    }
+
+    uint32_t gdsLibrary::findLayer(unsigned short number) const
+    {
+        for(size_t i=0; i<layerList.size(); ++i) {
+            if(layerList[i].number==number) {
+                return i;
+            }
+        }
+
+        return GDS_NONE;
+    }
+
+    const gdsArray<gdsStructure> &gdsLibrary::structures() const
+    {
+        return structureList;
+    }
+
+    const std::vector<gdsLayer> &gdsLibrary::layers() const
+    {
+        return layerList;
+    }
+
+    const gdsArray<gdsLayerRange> &gdsLibrary::ranges() const
+    {
+        return rangeList;
+    }
+
+    const gdsArray<gdsText> &gdsLibrary::texts() const
+    {
+        return textList;
+    }
+
+    const gdsArray<gdsReference> &gdsLibrary::references() const
+    {
+        return referenceList;
+    }
+
+    const gdsArray<gdsProperty> &gdsLibrary::properties() const
+    {
+        return propertyList;
+    }
+
+    const gdsArray<gdsElementOrder> &gdsLibrary::order() const
+    {
+        return orderList;
+    }
+
+    size_t gdsLibrary::memoryUsage() const
+    {
+        size_t total = strings.memory() + structureList.memory() +
+                       rangeList.memory() + textList.memory() +
+                       referenceList.memory() + propertyList.memory() +
+                       orderList.memory();
+
+        for(size_t i=0; i<layerList.size(); ++i) {
+            const gdsLayer &layer = layerList[i];
+            total += layer.shapes.memory() + layer.x.memory() +
+                     layer.y.memory();
+        }
+
+        return total;
+    }
+
+    gdsLibraryBuilder::gdsLibraryBuilder(gdsLibrary *library)
+        : library(library), slots(65536, GDS_NONE), element(0), records(0),
+          layer(0), attribute(0)
+    {
+        library->clear();
+        memset(modified, 0, sizeof(modified));
+        memset(accessed, 0, sizeof(accessed));
+    }
+
+    uint32_t gdsLibraryBuilder::addString(const char *str)
+    {
+        return library->strings.append(str, strlen(str) + 1);
+    }
+
+    // Structure names come back with every reference, keep one copy.
+    uint32_t gdsLibraryBuilder::addName(const char *name)
+    {
+        std::unordered_map<std::string, uint32_t>::iterator it =
+            names.find(name);
+
+        if(it!=names.end()) {
+            return it->second;
+        }
+
+        uint32_t offset = addString(name);
+        names.emplace(name, offset);
+        return offset;
+    }
+
+    uint32_t gdsLibraryBuilder::layerSlot(unsigned short number)
+    {
+        uint32_t slot = slots[number];
+
+        if(slot==GDS_NONE) {
+            slot = slots[number] = library->layerList.size();
+            library->layerList.emplace_back();
+            library->layerList.back().number = number;
+            firstShapes.push_back(GDS_NONE);
+            rangeIndex.push_back(GDS_NONE);
+        }
+
+        if(firstShapes[slot]==GDS_NONE) {
+            firstShapes[slot] = library->layerList[slot].shapes.length();
+            rangeIndex[slot] = touched.size();
+            touched.push_back(slot);
+        }
+
+        return slot;
+    }
+
+    void gdsLibraryBuilder::startElement(unsigned char type)
+    {
+        uint32_t properties = library->propertyList.length();
+        element = type;
+        records = 0;
+        layer = 0;
+
+        memset(&shape, 0, sizeof(shape));
+        shape.type = type;
+        shape.firstProperty = properties;
+
+        memset(&text, 0, sizeof(text));
+        text.mag = 1.0;
+        text.firstProperty = properties;
+
+        memset(&reference, 0, sizeof(reference));
+        reference.structure = GDS_NONE;
+        reference.mag = 1.0;
+        reference.columns = reference.rows = 1;
+        reference.type = type;
+        reference.firstProperty = properties;
+    }
+
+    void gdsLibraryBuilder::onParsedGDSVersion(unsigned short version)
+    {
+        library->gdsVersion = version;
+    }
+
+    void gdsLibraryBuilder::onParsedModTime(short year, short month,
+                                            short day, short hour,
+                                            short minute, short sec)
+    {
+        short stamp[6] = { year, month, day, hour, minute, sec };
+        memcpy(modified, stamp, sizeof(modified));
+    }
+
+    void gdsLibraryBuilder::onParsedAccessTime(short year, short month,
+                                               short day, short hour,
+                                               short minute, short sec)
+    {
+        short stamp[6] = { year, month, day, hour, minute, sec };
+        memcpy(accessed, stamp, sizeof(accessed));
+    }
+
+    void gdsLibraryBuilder::onParsedLibName(const char *libName)
+    {
+        library->libName = addString(libName);
+        memcpy(library->libModified, modified, sizeof(modified));
+        memcpy(library->libAccessed, accessed, sizeof(accessed));
+    }
+
+    void gdsLibraryBuilder::onParsedUnits(double userUnits,
+                                          double databaseUnits)
+    {
+        library->user = userUnits;
+        library->database = databaseUnits;
+    }
+
+    void gdsLibraryBuilder::onParsedStrName(const char *strName)
+    {
+        gdsStructure structure;
+        structure.name = addName(strName);
+        structure.firstRange = library->rangeList.length();
+        structure.rangeCount = 0;
+        structure.firstText = library->textList.length();
+        structure.textCount = 0;
+        structure.firstReference = library->referenceList.length();
+        structure.referenceCount = 0;
+        structure.firstElement = library->orderList.length();
+        structure.elementCount = 0;
+        memcpy(structure.modified, modified, sizeof(modified));
+        memcpy(structure.accessed, accessed, sizeof(accessed));
+
+        library->structureLookup.emplace(strName,
+                                         library->structureList.length());
+        library->structureList.push_back(structure);
+    }
+
+    void gdsLibraryBuilder::onParsedBoundaryStart()
+    {
+        startElement(BOUNDARY);
+    }
+
+    void gdsLibraryBuilder::onParsedPathStart()
+    {
+        startElement(PATH);
+    }
+
+    void gdsLibraryBuilder::onParsedBoxStart()
+    {
+        startElement(BOX);
+    }
+
+    void gdsLibraryBuilder::onParsedNodeStart()
+    {
+        startElement(NODE);
+    }
+
+    void gdsLibraryBuilder::onParsedTextStart()
+    {
+        startElement(TEXT);
+    }
+
+    void gdsLibraryBuilder::onParsedSrefStart()
+    {
+        startElement(SREF);
+    }
+
+    void gdsLibraryBuilder::onParsedArefStart()
+    {
+        startElement(AREF);
+    }
+
+    void gdsLibraryBuilder::onParsedEndElement()
+    {
+        if(library->structureList.empty()) {
+            element = 0;
+            return;
+        }
+
+        gdsStructure &structure = library->structureList.back();
+        uint32_t properties = library->propertyList.length();
+        gdsElementOrder order = { 0, element, records };
+
+        switch(element) {
+            case BOUNDARY:
+            case PATH:
+            case BOX:
+            case NODE:
+                if(shape.pointCount>0) {
+                    uint32_t slot = layerSlot(layer);
+                    shape.propertyCount = properties - shape.firstProperty;
+                    library->layerList[slot].shapes.push_back(shape);
+                    order.range = rangeIndex[slot];
+                    library->orderList.push_back(order);
+                }
+
+                break;
+
+            case TEXT:
+                text.layer = layer;
+                text.propertyCount = properties - text.firstProperty;
+                library->textList.push_back(text);
+                library->orderList.push_back(order);
+                ++structure.textCount;
+                break;
+
+            case SREF:
+            case AREF:
+                reference.propertyCount = properties -
+                                          reference.firstProperty;
+                library->referenceList.push_back(reference);
+                library->orderList.push_back(order);
+                ++structure.referenceCount;
+                break;
+
+            default:
+                break;
+        }
+
+        element = 0;
+    }
+
+    void gdsLibraryBuilder::onParsedEndStructure()
+    {
+        if(library->structureList.empty()) {
+            return;
+        }
+
+        gdsStructure &structure = library->structureList.back();
+
+        for(size_t i=0; i<touched.size(); ++i) {
+            uint32_t slot = touched[i];
+            gdsLayerRange range;
+            range.layer = slot;
+            range.firstShape = firstShapes[slot];
+            range.shapeCount = library->layerList[slot].shapes.length() -
+                               range.firstShape;
+            library->rangeList.push_back(range);
+            firstShapes[slot] = GDS_NONE;
+        }
+
+        structure.rangeCount = touched.size();
+        structure.elementCount = library->orderList.length() -
+                                 structure.firstElement;
+        touched.clear();
+    }
+
+    void gdsLibraryBuilder::onParsedEndLib()
+    {
+        gdsArray<gdsReference> &references = library->referenceList;
+
+        for(uint32_t i=0; i<references.length(); ++i) {
+            references[i].structure = library->findStructure(
+                library->string(references[i].name));
+        }
+
+        library->strings.shrink();
+        library->structureList.shrink();
+        library->rangeList.shrink();
+        library->textList.shrink();
+        library->referenceList.shrink();
+        library->propertyList.shrink();
+        library->orderList.shrink();
+
+        for(size_t i=0; i<library->layerList.size(); ++i) {
+            gdsLayer &layer = library->layerList[i];
+            layer.shapes.shrink();
+            layer.x.shrink();
+            layer.y.shrink();
+        }
+    }
+
+    void gdsLibraryBuilder::onParsedColumnsRows(unsigned short columns,
+                                                unsigned short rows)
+    {
+        reference.columns = columns;
+        reference.rows = rows;
+    }
+
+    void gdsLibraryBuilder::onParsedPathType(unsigned short pathType)
+    {
+        records |= GDS_HAS_PATHTYPE;
+        shape.pathType = pathType;
+        text.pathType = pathType;
+    }
+
+    void gdsLibraryBuilder::onParsedStrans(short strans)
+    {
+        records |= GDS_HAS_STRANS;
+        text.strans = strans;
+        reference.strans = strans;
+    }
+
+    void gdsLibraryBuilder::onParsedPresentation(short font, short valign,
+                                                 short halign)
+    {
+        records |= GDS_HAS_PRESENTATION;
+        text.presentation = font | valign | halign;
+    }
+
+    void gdsLibraryBuilder::onParsedSname(const char *sname)
+    {
+        reference.name = addName(sname);
+    }
+
+    void gdsLibraryBuilder::onParsedString(const char *str)
+    {
+        text.string = addString(str);
+    }
+
+    void gdsLibraryBuilder::onParsedPropValue(const char *propValue)
+    {
+        gdsProperty property;
+        property.value = addString(propValue);
+        property.attribute = attribute;
+        library->propertyList.push_back(property);
+    }
+
+    void gdsLibraryBuilder::onParsedXY(int count, int x[], int y[])
+    {
+        switch(element) {
+            case BOUNDARY:
+            case PATH:
+            case BOX:
+            case NODE: {
+                // Long elements are split over several XY records, which
+                // land next to each other in the layer's arrays.
+                gdsLayer &target = library->layerList[layerSlot(layer)];
+                uint32_t first = target.x.append(x, count);
+                target.y.append(y, count);
+
+                if(shape.pointCount==0) {
+                    shape.firstPoint = first;
+                }
+
+                shape.pointCount += count;
+                break;
+            }
+
+            case TEXT:
+                if(count>0) {
+                    text.x = x[0];
+                    text.y = y[0];
+                }
+
+                break;
+
+            case SREF:
+            case AREF:
+                for(int i=0; i<count && i<3; ++i) {
+                    reference.x[i] = x[i];
+                    reference.y[i] = y[i];
+                }
+
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void gdsLibraryBuilder::onParsedLayer(unsigned short layer)
+    {
+        this->layer = layer;
+    }
+
+    void gdsLibraryBuilder::onParsedWidth(int width)
+    {
+        records |= GDS_HAS_WIDTH;
+        shape.width = width;
+        text.width = width;
+    }
+
+    void gdsLibraryBuilder::onParsedDataType(unsigned short dataType)
+    {
+        shape.dataType = dataType;
+    }
+
+    void gdsLibraryBuilder::onParsedTextType(unsigned short textType)
+    {
+        text.textType = textType;
+    }
+
+    void gdsLibraryBuilder::onParsedAngle(double angle)
+    {
+        records |= GDS_HAS_ANGLE;
+        text.angle = angle;
+        reference.angle = angle;
+    }
+
+    void gdsLibraryBuilder::onParsedMag(double mag)
+    {
+        records |= GDS_HAS_MAG;
+        text.mag = mag;
+        reference.mag = mag;
+    }
+
+    void gdsLibraryBuilder::onParsedBeginExtension32(int bext)
+    {
+        records |= GDS_HAS_BGNEXTN;
+        shape.beginExtension = bext;
+    }
+
+    void gdsLibraryBuilder::onParsedEndExtension32(int eext)
+    {
+        records |= GDS_HAS_ENDEXTN;
+        shape.endExtension = eext;
+    }
+
+    void gdsLibraryBuilder::onParsedPropertyNumber(unsigned short propNum)
+    {
+        attribute = propNum;
+    }
+
+    void gdsLibraryBuilder::onParsedNodeType(unsigned short nodeType)
+    {
+        shape.dataType = nodeType;
+    }
+
+    void gdsLibraryBuilder::onParsedBoxType(unsigned short boxType)
+    {
+        shape.dataType = boxType;
+    }
+} // End namespace gdsfp
@@ -0,0 +1,421 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSLIBRARY_H_
+#define GDSLIBRARY_H_
+
+#include "gdsFileParser.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gdsfp
+{
+    static const uint32_t GDS_NONE = 0xffffffff;
+
+    /*
+     *  Bump allocated array of plain data.  Objects are only ever appended
+     *  at the end and are addressed by their 32-bit index, nothing is freed
+     *  on its own, and all of it goes away at once.  One such array holds
+     *  every object of a kind, so a library is a handful of large blocks
+     *  instead of one allocation per polygon.
+     */
+    template<class T>
+    class gdsArray
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "gdsArray only holds plain data");
+
+    public:
+        gdsArray() : items(NULL), count(0), size(0) {};
+        ~gdsArray() { free(items); };
+
+        gdsArray(gdsArray &&other)
+            : items(other.items), count(other.count), size(other.size)
+        {
+            other.items = NULL;
+            other.count = other.size = 0;
+        };
+
+        gdsArray &operator=(gdsArray &&other)
+        {
+            std::swap(items, other.items);
+            std::swap(count, other.count);
+            std::swap(size, other.size);
+            return *this;
+        };
+
+        uint32_t push_back(const T &item)
+        {
+            if(count==size) {
+                grow(count + 1);
+            }
+
+            items[count] = item;
+            return count++;
+        };
+
+        uint32_t append(const T *first, uint32_t length)
+        {
+            if(count + length>size) {
+                grow(count + length);
+            }
+
+            memcpy(items + count, first, length * sizeof(T));
+            count += length;
+            return count - length;
+        };
+
+        T &operator[](uint32_t i) { return items[i]; };
+        const T &operator[](uint32_t i) const { return items[i]; };
+        T &back() { return items[count - 1]; };
+        const T *data() const { return items; };
+        uint32_t length() const { return count; };
+        bool empty() const { return count==0; };
+        size_t memory() const { return size * sizeof(T); };
+
+        void clear()
+        {
+            free(items);
+            items = NULL;
+            count = size = 0;
+        };
+
+        // Gives back the room reserved for growth.
+        void shrink()
+        {
+            if(count<size && count>0) {
+                T *fitted = (T *)realloc(items, count * sizeof(T));
+
+                if(fitted!=NULL) {
+                    items = fitted;
+                    size = count;
+                }
+            }
+        };
+
+    private:
+        gdsArray(const gdsArray &);
+        gdsArray &operator=(const gdsArray &);
+
+        void grow(uint64_t needed)
+        {
+            uint64_t grown = (uint64_t)size * 2;
+
+            if(grown<needed) {
+                grown = needed;
+            }
+
+            if(grown<64) {
+                grown = 64;
+            }
+
+            if(grown>GDS_NONE) {
+                grown = GDS_NONE;
+            }
+
+            if(needed>grown) {
+                throw std::bad_alloc();     // More than 32-bit indices.
+            }
+
+            T *larger = (T *)realloc(items, grown * sizeof(T));
+
+            if(larger==NULL) {
+                throw std::bad_alloc();
+            }
+
+            items = larger;
+            size = grown;
+        };
+
+        T *items;
+        uint32_t count;
+        uint32_t size;
+    };
+
+    // BOUNDARY, PATH, BOX or NODE.  Its points are in the arrays of its
+    // layer.
+    struct gdsShape {
+        uint32_t firstPoint;
+        uint32_t pointCount;
+        uint32_t firstProperty;
+        uint32_t propertyCount;
+        int width;
+        int beginExtension;
+        int endExtension;
+        unsigned short dataType;        // Or the boxtype or nodetype.
+        unsigned char type;             // The record type that started it.
+        unsigned char pathType;
+    };
+
+    struct gdsText {
+        int x;
+        int y;
+        uint32_t string;                // Offset in the string pool.
+        uint32_t firstProperty;
+        uint32_t propertyCount;
+        int width;
+        double mag;
+        double angle;
+        unsigned short layer;
+        unsigned short textType;
+        short presentation;
+        short strans;
+        unsigned char pathType;
+    };
+
+    // SREF or AREF.  An AREF has the origin, the column corner and the row
+    // corner in x and y, an SREF only the origin.
+    struct gdsReference {
+        uint32_t name;                  // Offset in the string pool.
+        uint32_t structure;             // Index of the target or GDS_NONE.
+        int x[3];
+        int y[3];
+        uint32_t firstProperty;
+        uint32_t propertyCount;
+        double mag;
+        double angle;
+        unsigned short columns;
+        unsigned short rows;
+        short strans;
+        unsigned char type;
+    };
+
+    struct gdsProperty {
+        uint32_t value;                 // Offset in the string pool.
+        unsigned short attribute;
+    };
+
+    // Optional records of an element that were in the file, also when they
+    // held the default value.
+    enum gdsElementRecord {
+        GDS_HAS_PATHTYPE = 0x01,
+        GDS_HAS_WIDTH = 0x02,
+        GDS_HAS_BGNEXTN = 0x04,
+        GDS_HAS_ENDEXTN = 0x08,
+        GDS_HAS_PRESENTATION = 0x10,
+        GDS_HAS_STRANS = 0x20,
+        GDS_HAS_MAG = 0x40,
+        GDS_HAS_ANGLE = 0x80
+    };
+
+    // One element of a structure in file order.  The element is the next
+    // shape of the given range of the structure, or the next text or
+    // reference of the structure, depending on its type.
+    struct gdsElementOrder {
+        uint32_t range;                 // Of the structure, for shapes.
+        unsigned char type;             // The record type that started it.
+        unsigned char records;          // GDS_HAS_* bits.
+    };
+
+    // The shapes of one structure on one layer, which are contiguous
+    // because structures are read one after the other.
+    struct gdsLayerRange {
+        uint32_t layer;                 // Index in gdsLibrary::layers().
+        uint32_t firstShape;
+        uint32_t shapeCount;
+    };
+
+    struct gdsStructure {
+        uint32_t name;                  // Offset in the string pool.
+        uint32_t firstRange;
+        uint32_t rangeCount;
+        uint32_t firstText;
+        uint32_t textCount;
+        uint32_t firstReference;
+        uint32_t referenceCount;
+        uint32_t firstElement;          // In gdsLibrary::order().
+        uint32_t elementCount;
+        short modified[6];              // Of BGNSTR, year first.
+        short accessed[6];
+    };
+
+    // Every shape of a layer, with the points of all of them in one pair of
+    // coordinate arrays.
+    struct gdsLayer {
+        unsigned short number;
+        gdsArray<gdsShape> shapes;
+        gdsArray<int> x;
+        gdsArray<int> y;
+    };
+
+    /*
+     *  In-memory GDSII library.  Objects refer to each other by 32-bit
+     *  indices into the arrays of the library, and strings by their offset
+     *  in a single pool of NUL terminated strings.
+     *
+     *      gdsLibrary library;
+     *      library.load("chip.gds");
+     *      const gdsStructure &top = library.structures()[
+     *          library.findStructure("TOP")];
+     */
+    class gdsLibrary
+    {
+    public:
+        gdsLibrary();
+
+        // A thread count above 1 decodes with gdsParallelParser.
+        int load(const char *filePath, unsigned int threads = 1);
+        void clear();
+
+        const char *name() const;
+        unsigned short version() const;
+        double userUnits() const;
+        double databaseUnits() const;
+        const short *modified() const;  // Of BGNLIB, year first.
+        const short *accessed() const;
+
+        const char *string(uint32_t offset) const;
+        uint32_t findStructure(const char *name) const;
+        uint32_t findLayer(unsigned short number) const;
+
+        const gdsArray<gdsStructure> &structures() const;
+        const std::vector<gdsLayer> &layers() const;
+        const gdsArray<gdsLayerRange> &ranges() const;
+        const gdsArray<gdsText> &texts() const;
+        const gdsArray<gdsReference> &references() const;
+        const gdsArray<gdsProperty> &properties() const;
+        // Every element of every structure in file order, for callers that
+        // need to give them back the way they were read.
+        const gdsArray<gdsElementOrder> &order() const;
+
+        // Bytes held by the arrays of the library.
+        size_t memoryUsage() const;
+
+    private:
+        friend class gdsLibraryBuilder;
+        friend class gdsSnapshot;
+
+        gdsLibrary(const gdsLibrary &);
+        gdsLibrary &operator=(const gdsLibrary &);
+
+        uint32_t libName;
+        unsigned short gdsVersion;
+        double user;
+        double database;
+        short libModified[6];
+        short libAccessed[6];
+
+        gdsArray<char> strings;
+        gdsArray<gdsStructure> structureList;
+        std::vector<gdsLayer> layerList;
+        gdsArray<gdsLayerRange> rangeList;
+        gdsArray<gdsText> textList;
+        gdsArray<gdsReference> referenceList;
+        gdsArray<gdsProperty> propertyList;
+        gdsArray<gdsElementOrder> orderList;
+        std::unordered_map<std::string, uint32_t> structureLookup;
+    };
+
+    typedef gdsLibrary Library;
+
+    /*
+     *  Fills a gdsLibrary from the parser callbacks.  The library is
+     *  cleared first and references are resolved to structure indices once
+     *  ENDLIB has been read.  Filters and subscriptions set on the builder
+     *  apply, e.g. a layer filter loads only some layers.
+     */
+    class gdsLibraryBuilder : public gdsFileParser
+    {
+    public:
+        explicit gdsLibraryBuilder(gdsLibrary *library);
+
+    protected:
+        void onParsedGDSVersion(unsigned short version);
+        void onParsedModTime(short year, short month, short day,
+                             short hour, short minute, short sec);
+        void onParsedAccessTime(short year, short month, short day,
+                                short hour, short minute, short sec);
+        void onParsedLibName(const char *libName);
+        void onParsedUnits(double userUnits, double databaseUnits);
+        void onParsedStrName(const char *strName);
+        void onParsedBoundaryStart();
+        void onParsedPathStart();
+        void onParsedBoxStart();
+        void onParsedEndElement();
+        void onParsedEndStructure();
+        void onParsedEndLib();
+        void onParsedColumnsRows(unsigned short columns,
+                                 unsigned short rows);
+        void onParsedPathType(unsigned short pathType);
+        void onParsedStrans(short strans);
+        void onParsedPresentation(short font, short valign, short halign);
+        void onParsedNodeStart();
+        void onParsedTextStart();
+        void onParsedSrefStart();
+        void onParsedArefStart();
+        void onParsedSname(const char *sname);
+        void onParsedString(const char *str);
+        void onParsedPropValue(const char *propValue);
+        void onParsedXY(int count, int x[], int y[]);
+        void onParsedLayer(unsigned short layer);
+        void onParsedWidth(int width);
+        void onParsedDataType(unsigned short dataType);
+        void onParsedTextType(unsigned short textType);
+        void onParsedAngle(double angle);
+        void onParsedMag(double mag);
+        // BGNEXTN and ENDEXTN come whole through the 32-bit callbacks.
+        void onParsedBeginExtension(unsigned short bext) {};
+        void onParsedEndExtension(unsigned short eext) {};
+        void onParsedBeginExtension32(int bext);
+        void onParsedEndExtension32(int eext);
+        void onParsedPropertyNumber(unsigned short propNum);
+        void onParsedNodeType(unsigned short nodeType);
+        void onParsedBoxType(unsigned short boxType);
+
+    private:
+        void startElement(unsigned char type);
+        uint32_t addString(const char *str);
+        uint32_t addName(const char *name);
+        uint32_t layerSlot(unsigned short number);
+
+        gdsLibrary *library;
+        std::unordered_map<std::string, uint32_t> names;
+        std::vector<uint32_t> slots;            // Layer number to index.
+        std::vector<uint32_t> firstShapes;      // Per layer, this structure.
+        std::vector<uint32_t> rangeIndex;       // Per layer, this structure.
+        std::vector<uint32_t> touched;          // Layers of this structure.
+
+        // Of the last BGNLIB or BGNSTR, until LIBNAME or STRNAME.
+        short modified[6];
+        short accessed[6];
+
+        unsigned char element;                  // 0 outside of elements.
+        unsigned char records;                  // GDS_HAS_* of the element.
+        unsigned short layer;
+        unsigned short attribute;
+        gdsShape shape;
+        gdsText text;
+        gdsReference reference;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSLIBRARY_H_
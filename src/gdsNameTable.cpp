@@ -0,0 +1,140 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsNameTable.h"
+#include <cstring>
+
+namespace gdsfp
+{
+    gdsNameTable::gdsNameTable()
+    {
+        starts.push_back(0);
+    }
+
+    // FNV-1a over the bytes of the name.
+    uint64_t gdsNameTable::hash(std::string_view name)
+    {
+        uint64_t value = 0xcbf29ce484222325ULL;
+
+        for(size_t i=0; i<name.size(); ++i) {
+            value = (value ^ (unsigned char)name[i]) * 0x100000001b3ULL;
+        }
+
+        return value;
+    }
+
+    // Returns the slot of the name, or the free slot where it belongs.
+    size_t gdsNameTable::lookup(std::string_view name, uint64_t hash) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+
+        while(slots[slot]!=0) {
+            unsigned int id = slots[slot] - 1;
+
+            if(hashes[id]==hash && name==this->name(id)) {
+                break;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+
+        return slot;
+    }
+
+    void gdsNameTable::grow()
+    {
+        slots.assign(slots.empty() ? 1024 : 2 * slots.size(), 0);
+        size_t mask = slots.size() - 1;
+
+        for(size_t id=0; id<hashes.size(); ++id) {
+            size_t slot = hashes[id] & mask;
+
+            while(slots[slot]!=0) {
+                slot = (slot + 1) & mask;
+            }
+
+            slots[slot] = id + 1;
+        }
+    }
+
+    unsigned int gdsNameTable::intern(std::string_view name)
+    {
+        if(2 * (hashes.size() + 1)>slots.size()) {
+            grow();
+        }
+
+        uint64_t value = hash(name);
+        size_t slot = lookup(name, value);
+
+        if(slots[slot]==0) {
+            pool.insert(pool.end(), name.begin(), name.end());
+            hashes.push_back(value);
+            starts.push_back(pool.size());
+            slots[slot] = hashes.size();
+        }
+
+        return slots[slot] - 1;
+    }
+
+    int gdsNameTable::find(std::string_view name, unsigned int *id) const
+    {
+        if(slots.empty()) {
+            return 1;
+        }
+
+        size_t slot = lookup(name, hash(name));
+
+        if(slots[slot]==0) {
+            return 1;
+        }
+
+        (*id) = slots[slot] - 1;
+        return 0;
+    }
+
+    std::string_view gdsNameTable::name(unsigned int id) const
+    {
+        if(id>=hashes.size()) {
+            return std::string_view();
+        }
+
+        return std::string_view(pool.data() + starts[id],
+                                starts[id + 1] - starts[id]);
+    }
+
+    unsigned int gdsNameTable::size() const
+    {
+        return hashes.size();
+    }
+
+    void gdsNameTable::clear()
+    {
+        slots.clear();
+        hashes.clear();
+        starts.assign(1, 0);
+        pool.clear();
+    }
+} // End namespace gdsfp
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSNAMETABLE_H_
+#define GDSNAMETABLE_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Interns structure names.  Every distinct name gets the next dense id,
+     *  starting at 0, so handlers can index plain arrays by structure
+     *  instead of hashing the same few hundred names for millions of SREFs.
+     *  The names are kept in one string pool behind an open addressing
+     *  table.  Views returned by name() stay valid until the next intern()
+     *  or clear().
+     */
+    class gdsNameTable
+    {
+    public:
+        gdsNameTable();
+
+        unsigned int intern(std::string_view name);
+        // Returns 0 and sets id when the name is in the table, 1 otherwise.
+        int find(std::string_view name, unsigned int *id) const;
+        std::string_view name(unsigned int id) const;
+        unsigned int size() const;
+        void clear();
+
+    private:
+        static uint64_t hash(std::string_view name);
+        size_t lookup(std::string_view name, uint64_t hash) const;
+        void grow();
+
+        std::vector<uint32_t> slots;    // Id plus one, 0 for a free slot.
+        std::vector<uint64_t> hashes;   // By id.
+        std::vector<uint32_t> starts;   // By id, one past the end at the end.
+        std::vector<char> pool;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSNAMETABLE_H_
@@ -0,0 +1,692 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsParallelParser.h"
+#include "gdsFileParser.h"
+#include "gdsRecordReader.h"
+#include "gdsStructureIndex.h"
+#include "gdsThreadCount.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace gdsfp
+{
+    /*
+     *  Event tags of the recorded callbacks, one per gdsFileParser callback.
+     */
+    enum EventType {
+        EV_GDS_VERSION, EV_MOD_TIME, EV_ACCESS_TIME, EV_LIB_NAME, EV_UNITS,
+        EV_STR_NAME, EV_BOUNDARY_START, EV_PATH_START, EV_BOX_START,
+        EV_END_ELEMENT, EV_END_STRUCTURE, EV_END_LIB, EV_COLUMNS_ROWS,
+        EV_PATH_TYPE, EV_STRANS, EV_PRESENTATION, EV_NODE_START,
+        EV_TEXT_START, EV_SREF_START, EV_AREF_START, EV_SNAME, EV_STRING,
+        EV_PROP_VALUE, EV_XY, EV_LAYER, EV_WIDTH, EV_DATA_TYPE, EV_TEXT_TYPE,
+        EV_ANGLE, EV_MAG, EV_BEGIN_EXTENSION, EV_END_EXTENSION,
+        EV_PROPERTY_NUMBER, EV_NODE_TYPE, EV_BOX_TYPE
+    };
+
+    // How far the recording of a structure got.
+    enum StructureState {
+        STRUCTURE_PENDING, STRUCTURE_RECORDED, STRUCTURE_FAILED
+    };
+
+    /*
+     *  Stores the decoded callbacks of a structure in a flat byte buffer so
+     *  that they can be replayed later on another thread.
+     */
+    class gdsEventRecorder : public gdsFileParser
+    {
+    public:
+        vector<unsigned char> events;
+
+    protected:
+        virtual void onParsedGDSVersion(unsigned short version) {
+            put(EV_GDS_VERSION);
+            put(version);
+        };
+        virtual void onParsedModTime(short year, short month, short day,
+                                     short hour, short minute, short sec) {
+            put(EV_MOD_TIME);
+            putTime(year, month, day, hour, minute, sec);
+        };
+        virtual void onParsedAccessTime(short year, short month, short day,
+                                        short hour, short minute, short sec) {
+            put(EV_ACCESS_TIME);
+            putTime(year, month, day, hour, minute, sec);
+        };
+        virtual void onParsedLibName(const char *libName) {
+            put(EV_LIB_NAME);
+            putString(libName);
+        };
+        virtual void onParsedUnits(double userUnits, double databaseUnits) {
+            put(EV_UNITS);
+            put(userUnits);
+            put(databaseUnits);
+        };
+        virtual void onParsedStrName(const char *strName) {
+            put(EV_STR_NAME);
+            putString(strName);
+        };
+        virtual void onParsedBoundaryStart() {
+            put(EV_BOUNDARY_START);
+        };
+        virtual void onParsedPathStart() {
+            put(EV_PATH_START);
+        };
+        virtual void onParsedBoxStart() {
+            put(EV_BOX_START);
+        };
+        virtual void onParsedEndElement() {
+            put(EV_END_ELEMENT);
+        };
+        virtual void onParsedEndStructure() {
+            put(EV_END_STRUCTURE);
+        };
+        virtual void onParsedEndLib() {
+            put(EV_END_LIB);
+        };
+        virtual void onParsedColumnsRows(unsigned short columns,
+                                         unsigned short rows) {
+            put(EV_COLUMNS_ROWS);
+            put(columns);
+            put(rows);
+        };
+        virtual void onParsedPathType(unsigned short pathType) {
+            put(EV_PATH_TYPE);
+            put(pathType);
+        };
+        virtual void onParsedStrans(short strans) {
+            put(EV_STRANS);
+            put(strans);
+        };
+        virtual void onParsedPresentation(short font, short valign,
+                                          short halign) {
+            put(EV_PRESENTATION);
+            put(font);
+            put(valign);
+            put(halign);
+        };
+        virtual void onParsedNodeStart() {
+            put(EV_NODE_START);
+        };
+        virtual void onParsedTextStart() {
+            put(EV_TEXT_START);
+        };
+        virtual void onParsedSrefStart() {
+            put(EV_SREF_START);
+        };
+        virtual void onParsedArefStart() {
+            put(EV_AREF_START);
+        };
+        virtual void onParsedSname(const char *sname) {
+            put(EV_SNAME);
+            putString(sname);
+        };
+        virtual void onParsedString(const char *str) {
+            put(EV_STRING);
+            putString(str);
+        };
+        virtual void onParsedPropValue(const char *propValue) {
+            put(EV_PROP_VALUE);
+            putString(propValue);
+        };
+        virtual void onParsedXY(int count, int x[], int y[]) {
+            put(EV_XY);
+            put(count);
+            putBytes(x, count * sizeof(int));
+            putBytes(y, count * sizeof(int));
+        };
+        virtual void onParsedLayer(unsigned short layer) {
+            put(EV_LAYER);
+            put(layer);
+        };
+        virtual void onParsedWidth(int width) {
+            put(EV_WIDTH);
+            put(width);
+        };
+        virtual void onParsedDataType(unsigned short dataType) {
+            put(EV_DATA_TYPE);
+            put(dataType);
+        };
+        virtual void onParsedTextType(unsigned short textType) {
+            put(EV_TEXT_TYPE);
+            put(textType);
+        };
+        virtual void onParsedAngle(double angle) {
+            put(EV_ANGLE);
+            put(angle);
+        };
+        virtual void onParsedMag(double mag) {
+            put(EV_MAG);
+            put(mag);
+        };
+        virtual void onParsedBeginExtension(unsigned short bext) {};
+        virtual void onParsedEndExtension(unsigned short eext) {};
+        virtual void onParsedBeginExtension32(int bext) {
+            put(EV_BEGIN_EXTENSION);
+            put(bext);
+        };
+        virtual void onParsedEndExtension32(int eext) {
+            put(EV_END_EXTENSION);
+            put(eext);
+        };
+        virtual void onParsedPropertyNumber(unsigned short propNum) {
+            put(EV_PROPERTY_NUMBER);
+            put(propNum);
+        };
+        virtual void onParsedNodeType(unsigned short nodeType) {
+            put(EV_NODE_TYPE);
+            put(nodeType);
+        };
+        virtual void onParsedBoxType(unsigned short boxType) {
+            put(EV_BOX_TYPE);
+            put(boxType);
+        };
+
+    private:
+        void put(EventType type) {
+            events.push_back((unsigned char)type);
+        };
+        template<class T> void put(T value) {
+            putBytes(&value, sizeof(value));
+        };
+        void putBytes(const void *data, size_t length) {
+            const unsigned char *p = (const unsigned char *)data;
+            events.insert(events.end(), p, p + length);
+        };
+        void putString(const char *str) {
+            putBytes(str, strlen(str) + 1);
+        };
+        void putTime(short year, short month, short day, short hour,
+                     short minute, short sec) {
+            short time[6] = { year, month, day, hour, minute, sec };
+            putBytes(time, sizeof(time));
+        };
+    };
+
+    /*
+     *  Reads back what gdsEventRecorder stored.
+     */
+    class gdsEventCursor
+    {
+    public:
+        gdsEventCursor(const vector<unsigned char> &events)
+            : p(events.data()), end(events.data() + events.size()) {};
+
+        bool atEnd() const {
+            return p>=end;
+        };
+        template<class T> T get() {
+            T value;
+            memcpy(&value, p, sizeof(value));
+            p += sizeof(value);
+            return value;
+        };
+        const char *getString() {
+            const char *str = (const char *)p;
+            p += strlen(str) + 1;
+            return str;
+        };
+        void getInts(int *values, int count) {
+            memcpy(values, p, count * sizeof(int));
+            p += count * sizeof(int);
+        };
+
+    private:
+        const unsigned char *p;
+        const unsigned char *end;
+    };
+
+    gdsParallelParser::gdsParallelParser(unsigned int threads)
+        : threads(gdsThreadCount(threads))
+    {
+    }
+
+    unsigned int gdsParallelParser::threadCount() const
+    {
+        return threads;
+    }
+
+    int gdsParallelParser::parseRange(gdsFileParser *handler,
+                                      const char *filePath,
+                                      unsigned long long offset,
+                                      unsigned long long end)
+    {
+        if(offset>=end) {
+            return 0;
+        }
+
+        gdsRecordReader reader;
+
+        if(reader.open(filePath)!=0 || reader.seek(offset)!=0) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        return handler->parseRecords(&reader, end);
+    }
+
+    void gdsParallelParser::replay(const vector<unsigned char> &events,
+                                   gdsFileParser *handler)
+    {
+        gdsEventCursor cursor(events);
+        vector<int> x, y;
+        short t[6];
+
+        while(!cursor.atEnd()) {
+            unsigned char type = cursor.get<unsigned char>();
+
+            switch(type) {
+                case EV_GDS_VERSION:
+                    handler->onParsedGDSVersion(cursor.get<unsigned short>());
+                    break;
+
+                case EV_MOD_TIME:
+                case EV_ACCESS_TIME:
+                    for(int i=0; i<6; ++i) {
+                        t[i] = cursor.get<short>();
+                    }
+
+                    if(type==EV_MOD_TIME) {
+                        handler->onParsedModTime(t[0], t[1], t[2], t[3], t[4],
+                                                 t[5]);
+                    } else {
+                        handler->onParsedAccessTime(t[0], t[1], t[2], t[3],
+                                                    t[4], t[5]);
+                    }
+
+                    break;
+
+                case EV_LIB_NAME:
+                    handler->onParsedLibNameView(cursor.getString());
+                    break;
+
+                case EV_UNITS: {
+                    double uu = cursor.get<double>();
+                    double db = cursor.get<double>();
+                    handler->onParsedUnits(uu, db);
+                    break;
+                }
+
+                case EV_STR_NAME: {
+                    const char *name = cursor.getString();
+
+                    if(handler->nameIdsEnabled()) {
+                        handler->onParsedStrNameId(
+                            handler->nameTable().intern(name), name);
+                    } else {
+                        handler->onParsedStrNameView(name);
+                    }
+
+                    break;
+                }
+
+                case EV_BOUNDARY_START:
+                    handler->onParsedBoundaryStart();
+                    break;
+
+                case EV_PATH_START:
+                    handler->onParsedPathStart();
+                    break;
+
+                case EV_BOX_START:
+                    handler->onParsedBoxStart();
+                    break;
+
+                case EV_END_ELEMENT:
+                    handler->onParsedEndElement();
+                    break;
+
+                case EV_END_STRUCTURE:
+                    handler->onParsedEndStructure();
+                    break;
+
+                case EV_END_LIB:
+                    handler->onParsedEndLib();
+                    break;
+
+                case EV_COLUMNS_ROWS: {
+                    unsigned short columns = cursor.get<unsigned short>();
+                    unsigned short rows = cursor.get<unsigned short>();
+                    handler->onParsedColumnsRows(columns, rows);
+                    break;
+                }
+
+                case EV_PATH_TYPE:
+                    handler->onParsedPathType(cursor.get<unsigned short>());
+                    break;
+
+                case EV_STRANS:
+                    handler->onParsedStrans(cursor.get<short>());
+                    break;
+
+                case EV_PRESENTATION: {
+                    short font = cursor.get<short>();
+                    short valign = cursor.get<short>();
+                    short halign = cursor.get<short>();
+                    handler->onParsedPresentation(font, valign, halign);
+                    break;
+                }
+
+                case EV_NODE_START:
+                    handler->onParsedNodeStart();
+                    break;
+
+                case EV_TEXT_START:
+                    handler->onParsedTextStart();
+                    break;
+
+                case EV_SREF_START:
+                    handler->onParsedSrefStart();
+                    break;
+
+                case EV_AREF_START:
+                    handler->onParsedArefStart();
+                    break;
+
+                case EV_SNAME: {
+                    const char *name = cursor.getString();
+
+                    if(handler->nameIdsEnabled()) {
+                        handler->onParsedSnameId(
+                            handler->nameTable().intern(name), name);
+                    } else {
+                        handler->onParsedSnameView(name);
+                    }
+
+                    break;
+                }
+
+                case EV_STRING:
+                    handler->onParsedStringView(cursor.getString());
+                    break;
+
+                case EV_PROP_VALUE:
+                    handler->onParsedPropValueView(cursor.getString());
+                    break;
+
+                case EV_XY: {
+                    int count = cursor.get<int>();
+
+                    if(x.size()<(size_t)count) {
+                        x.resize(count);
+                        y.resize(count);
+                    }
+
+                    cursor.getInts(x.data(), count);
+                    cursor.getInts(y.data(), count);
+                    handler->onParsedXY(count, x.data(), y.data());
+                    break;
+                }
+
+                case EV_LAYER:
+                    handler->onParsedLayer(cursor.get<unsigned short>());
+                    break;
+
+                case EV_WIDTH:
+                    handler->onParsedWidth(cursor.get<int>());
+                    break;
+
+                case EV_DATA_TYPE:
+                    handler->onParsedDataType(cursor.get<unsigned short>());
+                    break;
+
+                case EV_TEXT_TYPE:
+                    handler->onParsedTextType(cursor.get<unsigned short>());
+                    break;
+
+                case EV_ANGLE:
+                    handler->onParsedAngle(cursor.get<double>());
+                    break;
+
+                case EV_MAG:
+                    handler->onParsedMag(cursor.get<double>());
+                    break;
+
+                case EV_BEGIN_EXTENSION:
+                    handler->onParsedBeginExtension32(cursor.get<int>());
+                    break;
+
+                case EV_END_EXTENSION:
+                    handler->onParsedEndExtension32(cursor.get<int>());
+                    break;
+
+                case EV_PROPERTY_NUMBER:
+                    handler->onParsedPropertyNumber(cursor.get<unsigned short>());
+                    break;
+
+                case EV_NODE_TYPE:
+                    handler->onParsedNodeType(cursor.get<unsigned short>());
+                    break;
+
+                case EV_BOX_TYPE:
+                    handler->onParsedBoxType(cursor.get<unsigned short>());
+                    break;
+
+                default:
+                    return;
+            }
+        }
+    }
+
+    static unsigned long long structuresEnd(const gdsStructureIndex &index)
+    {
+        const vector<gdsStructureEntry> &entries = index.structures();
+
+        if(entries.empty()) {
+            return index.headerLength();
+        }
+
+        return entries.back().offset + entries.back().length;
+    }
+
+    int gdsParallelParser::parse(const char *filePath,
+                                 gdsFileParser *const handlers[],
+                                 unsigned int count)
+    {
+        gdsStructureIndex index;
+
+        if(index.open(filePath)!=0) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        return parse(filePath, index, handlers, count);
+    }
+
+    int gdsParallelParser::parse(const char *filePath,
+                                 const gdsStructureIndex &index,
+                                 gdsFileParser *const handlers[],
+                                 unsigned int count)
+    {
+        if(count==0) {
+            return 1;
+        }
+
+        if(parseRange(handlers[0], filePath, 0, index.headerLength())!=0) {
+            return 1;
+        }
+
+        const vector<gdsStructureEntry> &entries = index.structures();
+        atomic<size_t> next(0);
+        atomic<bool> failed(false);
+        vector<thread> workers;
+
+        for(unsigned int i=0; i<count; ++i) {
+            workers.push_back(thread([&, i]() {
+                gdsRecordReader reader;
+
+                if(reader.open(filePath)!=0) {
+                    failed = true;
+                    return;
+                }
+
+                size_t s;
+
+                while(!failed && (s = next++)<entries.size()) {
+                    const gdsStructureEntry &entry = entries[s];
+
+                    if(reader.seek(entry.offset)!=0 ||
+                       handlers[i]->parseRecords(&reader,
+                                                 entry.offset + entry.length)!=0) {
+                        failed = true;
+                    }
+                }
+            }));
+        }
+
+        for(size_t i=0; i<workers.size(); ++i) {
+            workers[i].join();
+        }
+
+        if(failed) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        return parseRange(handlers[0], filePath, structuresEnd(index), ~0ULL);
+    }
+
+    int gdsParallelParser::parseOrdered(const char *filePath,
+                                        gdsFileParser *handler)
+    {
+        gdsStructureIndex index;
+
+        if(index.open(filePath)!=0) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        return parseOrdered(filePath, index, handler);
+    }
+
+    int gdsParallelParser::parseOrdered(const char *filePath,
+                                        const gdsStructureIndex &index,
+                                        gdsFileParser *handler)
+    {
+        // The replay fires the record callbacks directly, so it would never
+        // reach onParsedElement.
+        if(handler->elementsEnabled()) {
+            cerr << "Error: parseOrdered() can not assemble elements."
+                 << endl;
+            return 1;
+        }
+
+        if(parseRange(handler, filePath, 0, index.headerLength())!=0) {
+            return 1;
+        }
+
+        const vector<gdsStructureEntry> &entries = index.structures();
+        vector<vector<unsigned char> > events(entries.size());
+        vector<StructureState> done(entries.size(), STRUCTURE_PENDING);
+        // Workers may only run this many structures ahead of the replay, so
+        // memory stays bounded however large the library is.
+        const size_t window = 4 * threads;
+        size_t replayed = 0;
+        bool failed = false;
+        atomic<size_t> next(0);
+        mutex lock;
+        condition_variable produced, consumed;
+        vector<thread> workers;
+
+        for(unsigned int i=0; i<threads; ++i) {
+            workers.push_back(thread([&]() {
+                gdsEventRecorder recorder;
+                recorder.setSubscription(handler->subscription());
+
+                if(handler->hasLayerFilter()) {
+                    recorder.setLayerFilter(handler->layerFilter());
+                }
+
+                gdsRecordReader reader;
+                bool ok = reader.open(filePath)==0;
+                size_t s;
+
+                while((s = next++)<entries.size()) {
+                    {
+                        unique_lock<mutex> guard(lock);
+                        consumed.wait(guard, [&]() {
+                            return failed || s<replayed + window;
+                        });
+
+                        if(failed) {
+                            return;
+                        }
+                    }
+
+                    const gdsStructureEntry &entry = entries[s];
+                    recorder.events.clear();
+                    gdsFileParser *parser = &recorder;
+                    ok = ok && reader.seek(entry.offset)==0 &&
+                         parser->parseRecords(&reader,
+                                              entry.offset + entry.length)==0;
+
+                    unique_lock<mutex> guard(lock);
+                    events[s].swap(recorder.events);
+                    done[s] = ok ? STRUCTURE_RECORDED : STRUCTURE_FAILED;
+                    produced.notify_all();
+                }
+            }));
+        }
+
+        for(size_t s=0; s<entries.size(); ++s) {
+            {
+                unique_lock<mutex> guard(lock);
+                produced.wait(guard, [&]() {
+                    return done[s]!=STRUCTURE_PENDING;
+                });
+
+                if(done[s]==STRUCTURE_FAILED) {
+                    failed = true;
+                    consumed.notify_all();
+                    break;
+                }
+            }
+
+            replay(events[s], handler);
+            vector<unsigned char>().swap(events[s]);
+
+            unique_lock<mutex> guard(lock);
+            replayed = s + 1;
+            consumed.notify_all();
+        }
+
+        for(size_t i=0; i<workers.size(); ++i) {
+            workers[i].join();
+        }
+
+        if(failed) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        return parseRange(handler, filePath, structuresEnd(index), ~0ULL);
+    }
+} // End namespace gdsfp
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSPARALLELPARSER_H_
+#define GDSPARALLELPARSER_H_
+
+#include <vector>
+
+namespace gdsfp
+{
+    class gdsFileParser;
+    class gdsStructureIndex;
+
+    /*
+     *  Parses the structures of a GDSII file on several threads.  The file is
+     *  split at structure boundaries with a gdsStructureIndex (the sidecar
+     *  index is used when it is up to date).
+     *
+     *  parse() gives every worker thread its own handler.  The library
+     *  records before the first structure and after the last one go to
+     *  handlers[0] on the calling thread, the structures are handed out to
+     *  the workers as they become free, so a handler always sees complete
+     *  structures but not in file order.
+     *
+     *  parseOrdered() decodes the structures on the workers and replays their
+     *  callbacks into a single handler on the calling thread, in file order,
+     *  so existing gdsFileParser subclasses work unchanged.  It fails for a
+     *  handler that assembles elements (see enableElements()), which
+     *  parse() supports.
+     */
+    class gdsParallelParser
+    {
+    public:
+        // The thread count goes through gdsThreadCount().
+        explicit gdsParallelParser(unsigned int threads = 0);
+
+        int parse(const char *filePath, gdsFileParser *const handlers[],
+                  unsigned int count);
+        int parse(const char *filePath, const gdsStructureIndex &index,
+                  gdsFileParser *const handlers[], unsigned int count);
+
+        int parseOrdered(const char *filePath, gdsFileParser *handler);
+        int parseOrdered(const char *filePath, const gdsStructureIndex &index,
+                         gdsFileParser *handler);
+
+        unsigned int threadCount() const;
+
+    private:
+        static int parseRange(gdsFileParser *handler, const char *filePath,
+                              unsigned long long offset,
+                              unsigned long long end);
+        static void replay(const std::vector<unsigned char> &events,
+                           gdsFileParser *handler);
+
+        unsigned int threads;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSPARALLELPARSER_H_
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSPARSESTATS_H_
+#define GDSPARSESTATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+namespace gdsfp
+{
+    /*
+     *  What a parser has seen since its statistics were switched on or
+     *  cleared.  Every record counts, also those that were skipped by the
+     *  subscription or the layer filter.
+     */
+    struct gdsParseStats {
+        unsigned long long records[256];    // Per record type.
+        unsigned long long bytes[256];      // Including the record headers.
+        unsigned long long points[64];      // XY points per element type.
+        unsigned long long structures;
+        unsigned int maxRecordLength;       // Including the header.
+        double decodeSeconds;               // In the parser, less callbacks.
+        double callbackSeconds;             // In the handler's callbacks.
+
+        gdsParseStats() { clear(); };
+        void clear() { memset(this, 0, sizeof(*this)); };
+
+        unsigned long long totalRecords() const
+        {
+            unsigned long long total = 0;
+
+            for(int i=0; i<256; ++i) {
+                total += records[i];
+            }
+
+            return total;
+        };
+
+        unsigned long long totalBytes() const
+        {
+            unsigned long long total = 0;
+
+            for(int i=0; i<256; ++i) {
+                total += bytes[i];
+            }
+
+            return total;
+        };
+
+        static double now()
+        {
+            return std::chrono::duration<double>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        };
+    };
+
+    /*
+     *  Adds the time until it goes out of scope to the callback time of the
+     *  statistics, if there are any.
+     */
+    class gdsCallbackTimer
+    {
+    public:
+        gdsCallbackTimer(gdsParseStats *stats) : stats(stats)
+        {
+            if(stats!=NULL) {
+                start = gdsParseStats::now();
+            }
+        };
+
+        ~gdsCallbackTimer()
+        {
+            if(stats!=NULL) {
+                stats->callbackSeconds += gdsParseStats::now() - start;
+            }
+        };
+
+    private:
+        gdsParseStats *stats;
+        double start;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSPARSESTATS_H_
@@ -0,0 +1,610 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsReadAhead.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#if defined(IORING_OFF_SQ_RING) && defined(__NR_io_uring_setup)
+#define GDSFP_HAVE_URING
+#endif
+
+namespace gdsfp
+{
+    static const size_t ALIGNMENT = 4096;
+    static const size_t MINIMUM_BLOCK_SIZE = 64<<10;
+
+    bool gdsReadAhead::uringAllowed = true;
+
+#ifdef GDSFP_HAVE_URING
+    // The submission and completion rings shared with the kernel, set up
+    // with the plain system calls so that liburing isn't needed.
+    struct gdsReadAhead::uringQueue {
+        int fd;
+        void *sqRing;
+        size_t sqSize;
+        void *cqRing;
+        size_t cqSize;
+        io_uring_sqe *sqes;
+        size_t sqesSize;
+        unsigned int *sqTail;
+        unsigned int *sqMask;
+        unsigned int *sqArray;
+        unsigned int *cqHead;
+        unsigned int *cqTail;
+        unsigned int *cqMask;
+        io_uring_cqe *cqes;
+        iovec vectors[RING_SIZE];
+        unsigned int inFlight;
+    };
+#else
+    struct gdsReadAhead::uringQueue {
+        unsigned int inFlight;
+    };
+#endif
+
+    gdsReadAhead::gdsReadAhead()
+        : fd(-1), blockSize(DEFAULT_BLOCK_SIZE), fileSize(0), regular(false),
+          direct(false), how(GDS_READ_THREAD), readOffset(0), uring(NULL),
+          head(0), tail(0), count(0), holding(false), done(false),
+          failed(false), stopping(false)
+    {
+        for(int i=0; i<RING_SIZE; ++i) {
+            ring[i].data = NULL;
+            ring[i].length = 0;
+            ring[i].offset = 0;
+            ring[i].pending = false;
+        }
+    }
+
+    gdsReadAhead::~gdsReadAhead()
+    {
+        close();
+    }
+
+    void gdsReadAhead::allowUring(bool allow)
+    {
+        uringAllowed = allow;
+    }
+
+    gdsReadMethod gdsReadAhead::method() const
+    {
+        return how;
+    }
+
+    bool gdsReadAhead::isDirect() const
+    {
+        return direct;
+    }
+
+    int gdsReadAhead::open(const char *filePath, size_t blockSize,
+                           bool direct)
+    {
+        close();
+        int file = -1;
+
+#ifdef O_DIRECT
+        if(direct) {
+            file = ::open(filePath, O_RDONLY | O_DIRECT);
+        }
+#endif
+
+        if(file<0) {
+            file = ::open(filePath, O_RDONLY);
+            direct = false;
+        }
+
+        if(file<0) {
+            return 1;
+        }
+
+        return attach(file, blockSize, direct);
+    }
+
+    int gdsReadAhead::open(int fd, size_t blockSize, bool direct)
+    {
+        close();
+
+        if(fd<0) {
+            return 1;
+        }
+
+#ifdef O_DIRECT
+        int flags = fcntl(fd, F_GETFL);
+        direct = direct && flags>=0 &&
+                 fcntl(fd, F_SETFL, flags | O_DIRECT)==0;
+#else
+        direct = false;
+#endif
+
+        return attach(fd, blockSize, direct);
+    }
+
+    int gdsReadAhead::attach(int fd, size_t blockSize, bool direct)
+    {
+        if(blockSize<MINIMUM_BLOCK_SIZE) {
+            blockSize = MINIMUM_BLOCK_SIZE;
+        }
+
+        this->fd = fd;
+        this->blockSize = (blockSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        this->direct = direct;
+
+        struct stat info;
+        regular = fstat(fd, &info)==0 && S_ISREG(info.st_mode);
+        fileSize = regular ? info.st_size : 0;
+
+        if(!this->direct) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        for(int i=0; i<RING_SIZE; ++i) {
+            void *data;
+
+            if(posix_memalign(&data, ALIGNMENT, this->blockSize)!=0) {
+                close();
+                return 1;
+            }
+
+            ring[i].data = (unsigned char *)data;
+        }
+
+        if(regular && uringAllowed && setupUring()==0) {
+            how = GDS_READ_URING;
+
+            for(int i=0; i<RING_SIZE && readOffset<fileSize; ++i) {
+                ring[i].offset = readOffset;
+                readOffset += this->blockSize;
+
+                if(submit(i)!=0) {
+                    close();
+                    return 1;
+                }
+            }
+
+            return 0;
+        }
+
+        how = GDS_READ_THREAD;
+        worker = std::thread(&gdsReadAhead::run, this);
+        return 0;
+    }
+
+    void gdsReadAhead::close()
+    {
+        if(worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+
+            emptied.notify_all();
+            worker.join();
+        }
+
+#ifdef GDSFP_HAVE_URING
+        if(uring!=NULL) {
+            // The kernel may still write into the buffers until every read
+            // in flight has completed.
+            while(uring->inFlight>0) {
+                unsigned int cqHead = *uring->cqHead;
+
+                if(cqHead==__atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE)) {
+                    if(syscall(__NR_io_uring_enter, uring->fd, 0, 1,
+                               IORING_ENTER_GETEVENTS, NULL, 0)<0 &&
+                       errno!=EINTR) {
+                        break;
+                    }
+
+                    continue;
+                }
+
+                __atomic_store_n(uring->cqHead, cqHead + 1, __ATOMIC_RELEASE);
+                --uring->inFlight;
+            }
+
+            munmap(uring->sqes, uring->sqesSize);
+
+            if(uring->cqRing!=uring->sqRing) {
+                munmap(uring->cqRing, uring->cqSize);
+            }
+
+            munmap(uring->sqRing, uring->sqSize);
+            ::close(uring->fd);
+        }
+#endif
+
+        delete uring;
+        uring = NULL;
+
+        for(int i=0; i<RING_SIZE; ++i) {
+            free(ring[i].data);
+            ring[i].data = NULL;
+            ring[i].length = 0;
+            ring[i].offset = 0;
+            ring[i].pending = false;
+        }
+
+        if(fd>=0) {
+            ::close(fd);
+            fd = -1;
+        }
+
+        fileSize = 0;
+        regular = direct = false;
+        how = GDS_READ_THREAD;
+        readOffset = 0;
+        head = tail = count = 0;
+        holding = done = failed = stopping = false;
+    }
+
+    // O_DIRECT needs aligned offsets and lengths, and some file systems
+    // refuse it altogether.  Both show up as EINVAL, after which the file
+    // is read through the page cache.
+    bool gdsReadAhead::dropDirect()
+    {
+#ifdef O_DIRECT
+        int flags = fcntl(fd, F_GETFL);
+
+        if(direct && flags>=0 && fcntl(fd, F_SETFL, flags & ~O_DIRECT)==0) {
+            direct = false;
+            return true;
+        }
+#endif
+
+        return false;
+    }
+
+    int gdsReadAhead::next(const unsigned char **data, size_t *length)
+    {
+        if(how==GDS_READ_URING) {
+            return nextUring(data, length);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if(holding) {
+            tail = (tail + 1) % RING_SIZE;
+            --count;
+            holding = false;
+            emptied.notify_one();
+        }
+
+        while(count==0 && !done && !failed) {
+            filled.wait(lock);
+        }
+
+        if(count==0) {
+            return failed ? -1 : 0;
+        }
+
+        (*data) = ring[tail].data;
+        (*length) = ring[tail].length;
+        holding = true;
+        return 1;
+    }
+
+    // Fills a whole block unless the file ends first.  Pipes return what
+    // one read gives, so that slow writers aren't waited for.
+    ssize_t gdsReadAhead::readBlock(unsigned char *data,
+                                    unsigned long long offset)
+    {
+        size_t fill = 0;
+
+        while(fill<blockSize) {
+            ssize_t got;
+
+            if(regular) {
+                got = pread(fd, data + fill, blockSize - fill, offset + fill);
+            } else {
+                got = read(fd, data + fill, blockSize - fill);
+            }
+
+            if(got<0) {
+                if(errno==EINTR || (errno==EINVAL && dropDirect())) {
+                    continue;
+                }
+
+                return -1;
+            }
+
+            if(got==0) {
+                break;
+            }
+
+            fill += got;
+
+            if(!regular) {
+                break;
+            }
+        }
+
+        return fill;
+    }
+
+    void gdsReadAhead::run()
+    {
+        unsigned long long offset = 0;
+
+        for(;;) {
+            unsigned int index;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                while(count==RING_SIZE && !stopping) {
+                    emptied.wait(lock);
+                }
+
+                if(stopping) {
+                    return;
+                }
+
+                index = head;
+            }
+
+            ssize_t got = readBlock(ring[index].data, offset);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if(got<0) {
+                    failed = true;
+                } else if(got==0) {
+                    done = true;
+                } else {
+                    ring[index].length = got;
+                    ring[index].offset = offset;
+                    head = (head + 1) % RING_SIZE;
+                    ++count;
+                }
+            }
+
+            filled.notify_one();
+
+            if(got<=0) {
+                return;
+            }
+
+            offset += got;
+        }
+    }
+
+    int gdsReadAhead::setupUring()
+    {
+#ifdef GDSFP_HAVE_URING
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int ringFd = syscall(__NR_io_uring_setup, RING_SIZE, &params);
+
+        if(ringFd<0) {
+            return 1;   // Not in this kernel, or disabled.
+        }
+
+        uring = new uringQueue;
+        memset(uring, 0, sizeof(*uring));
+        uring->fd = ringFd;
+        uring->sqSize = params.sq_off.array +
+                        params.sq_entries * sizeof(unsigned int);
+        uring->cqSize = params.cq_off.cqes +
+                        params.cq_entries * sizeof(io_uring_cqe);
+
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP)!=0;
+
+        if(single) {
+            uring->sqSize = uring->cqSize = uring->sqSize>uring->cqSize
+                                            ? uring->sqSize : uring->cqSize;
+        }
+
+        uring->sqRing = mmap(NULL, uring->sqSize, PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE, ringFd,
+                             IORING_OFF_SQ_RING);
+        uring->cqRing = uring->sqRing;
+
+        if(uring->sqRing!=MAP_FAILED && !single) {
+            uring->cqRing = mmap(NULL, uring->cqSize, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, ringFd,
+                                 IORING_OFF_CQ_RING);
+        }
+
+        uring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+        if(uring->sqRing==MAP_FAILED || uring->cqRing==MAP_FAILED ||
+           sqes==MAP_FAILED) {
+            if(sqes!=MAP_FAILED) {
+                munmap(sqes, uring->sqesSize);
+            }
+
+            if(uring->cqRing!=MAP_FAILED && uring->cqRing!=uring->sqRing) {
+                munmap(uring->cqRing, uring->cqSize);
+            }
+
+            if(uring->sqRing!=MAP_FAILED) {
+                munmap(uring->sqRing, uring->sqSize);
+            }
+
+            ::close(ringFd);
+            delete uring;
+            uring = NULL;
+            return 1;
+        }
+
+        unsigned char *sq = (unsigned char *)uring->sqRing;
+        unsigned char *cq = (unsigned char *)uring->cqRing;
+        uring->sqes = (io_uring_sqe *)sqes;
+        uring->sqTail = (unsigned int *)(sq + params.sq_off.tail);
+        uring->sqMask = (unsigned int *)(sq + params.sq_off.ring_mask);
+        uring->sqArray = (unsigned int *)(sq + params.sq_off.array);
+        uring->cqHead = (unsigned int *)(cq + params.cq_off.head);
+        uring->cqTail = (unsigned int *)(cq + params.cq_off.tail);
+        uring->cqMask = (unsigned int *)(cq + params.cq_off.ring_mask);
+        uring->cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+        return 0;
+#else
+        return 1;
+#endif
+    }
+
+    // Queues a read of the rest of the block of a slot.
+    int gdsReadAhead::submit(unsigned int index)
+    {
+#ifdef GDSFP_HAVE_URING
+        slot &block = ring[index];
+        iovec &vector = uring->vectors[index];
+        vector.iov_base = block.data + block.length;
+        vector.iov_len = blockSize - block.length;
+
+        unsigned int sqTail = *uring->sqTail;
+        unsigned int entry = sqTail & *uring->sqMask;
+        io_uring_sqe *sqe = &uring->sqes[entry];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->off = block.offset + block.length;
+        sqe->addr = (unsigned long)&vector;
+        sqe->len = 1;
+        sqe->user_data = index;
+        uring->sqArray[entry] = entry;
+        __atomic_store_n(uring->sqTail, sqTail + 1, __ATOMIC_RELEASE);
+
+        while(syscall(__NR_io_uring_enter, uring->fd, 1, 0, 0, NULL, 0)<0) {
+            if(errno!=EINTR && errno!=EAGAIN && errno!=EBUSY) {
+                return 1;
+            }
+        }
+
+        block.pending = true;
+        ++uring->inFlight;
+        return 0;
+#else
+        return 1;
+#endif
+    }
+
+    // Waits for one read to finish.  Short reads before the end of the file
+    // are queued again for the rest of their block.
+    int gdsReadAhead::complete()
+    {
+#ifdef GDSFP_HAVE_URING
+        unsigned int cqHead = *uring->cqHead;
+
+        while(cqHead==__atomic_load_n(uring->cqTail, __ATOMIC_ACQUIRE)) {
+            if(syscall(__NR_io_uring_enter, uring->fd, 0, 1,
+                       IORING_ENTER_GETEVENTS, NULL, 0)<0 && errno!=EINTR) {
+                return 1;
+            }
+        }
+
+        io_uring_cqe *cqe = &uring->cqes[cqHead & *uring->cqMask];
+        unsigned int index = cqe->user_data;
+        int result = cqe->res;
+        __atomic_store_n(uring->cqHead, cqHead + 1, __ATOMIC_RELEASE);
+        --uring->inFlight;
+
+        slot &block = ring[index];
+        block.pending = false;
+
+        if(result==-EINTR || result==-EAGAIN ||
+           (result==-EINVAL && dropDirect())) {
+            return submit(index);
+        }
+
+        if(result<0) {
+            return 1;
+        }
+
+        block.length += result;
+
+        if(result>0 && block.length<blockSize &&
+           block.offset + block.length<fileSize) {
+            return submit(index);
+        }
+
+        return 0;
+#else
+        return 1;
+#endif
+    }
+
+    int gdsReadAhead::nextUring(const unsigned char **data, size_t *length)
+    {
+        if(failed) {
+            return -1;
+        }
+
+        if(holding) {
+            // Hand the block back to the kernel for the next part of the
+            // file.
+            slot &block = ring[tail];
+            block.length = 0;
+            holding = false;
+
+            if(readOffset<fileSize) {
+                block.offset = readOffset;
+                readOffset += blockSize;
+
+                if(submit(tail)!=0) {
+                    failed = true;
+                    return -1;
+                }
+            }
+
+            tail = (tail + 1) % RING_SIZE;
+        }
+
+        slot &block = ring[tail];
+
+        while(block.pending) {
+            if(complete()!=0) {
+                failed = true;
+                return -1;
+            }
+        }
+
+        if(block.length==0) {
+            return 0;
+        }
+
+        (*data) = block.data;
+        (*length) = block.length;
+        holding = true;
+        return 1;
+    }
+} // End namespace gdsfp
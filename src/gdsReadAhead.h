@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSREADAHEAD_H_
+#define GDSREADAHEAD_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <sys/types.h>
+
+namespace gdsfp
+{
+    enum gdsReadMethod {
+        GDS_READ_THREAD,
+        GDS_READ_URING
+    };
+
+    /*
+     *  Reads a file in large blocks ahead of the caller, so that on cold or
+     *  slow storage the next blocks are already on their way while the
+     *  current one is decoded.  A ring of page aligned buffers is kept busy
+     *  with io_uring where the kernel allows it, and by a reader thread
+     *  otherwise.  With direct set the file is opened with O_DIRECT to keep
+     *  it out of the page cache; file systems that refuse it are read the
+     *  usual way.
+     *
+     *      gdsReadAhead input;
+     *      input.open("chip.gds");
+     *      while(input.next(&data, &length)>0) { ... }
+     */
+    class gdsReadAhead
+    {
+    public:
+        static const size_t DEFAULT_BLOCK_SIZE = 8<<20;
+
+        gdsReadAhead();
+        ~gdsReadAhead();
+
+        // The block size is rounded up to a multiple of 4 KB.
+        int open(const char *filePath, size_t blockSize = DEFAULT_BLOCK_SIZE,
+                 bool direct = false);
+        // Takes over an open descriptor, also when it fails.  A regular file
+        // is read from its start.  direct sets O_DIRECT on it.
+        int open(int fd, size_t blockSize = DEFAULT_BLOCK_SIZE,
+                 bool direct = false);
+        void close();
+
+        // Returns 1 with the next block of the file, 0 at its end and -1
+        // when it can not be read.  The data stays valid until the
+        // following call.
+        int next(const unsigned char **data, size_t *length);
+
+        gdsReadMethod method() const;
+        bool isDirect() const;
+
+        // Tries io_uring before the reader thread, on by default.
+        static void allowUring(bool allow);
+
+    private:
+        gdsReadAhead(const gdsReadAhead &);
+        gdsReadAhead &operator=(const gdsReadAhead &);
+
+        static const int RING_SIZE = 4;
+
+        struct slot {
+            unsigned char *data;
+            size_t length;
+            unsigned long long offset;  // File offset of data[0].
+            bool pending;               // A read into it is in flight.
+        };
+
+        struct uringQueue;
+
+        int attach(int fd, size_t blockSize, bool direct);
+        void run();
+        ssize_t readBlock(unsigned char *data, unsigned long long offset);
+        bool dropDirect();
+        int setupUring();
+        int submit(unsigned int index);
+        int complete();
+        int nextUring(const unsigned char **data, size_t *length);
+
+        int fd;
+        size_t blockSize;
+        unsigned long long fileSize;
+        bool regular;
+        bool direct;
+        gdsReadMethod how;
+        slot ring[RING_SIZE];
+        unsigned long long readOffset;  // Where the next block starts.
+        uringQueue *uring;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable filled;
+        std::condition_variable emptied;
+        unsigned int head;      // Next slot the worker fills.
+        unsigned int tail;      // Next slot the reader takes.
+        unsigned int count;     // Filled slots, including the one in use.
+        bool holding;           // The reader still uses the slot at tail.
+        bool done;
+        bool failed;
+        bool stopping;
+
+        static bool uringAllowed;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSREADAHEAD_H_
@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsReal8.h"
+
+namespace gdsfp
+{
+    void encodeReal8(double value, unsigned char *p)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        uint64_t sign = bits & 0x8000000000000000ULL;
+        int biased = (int)((bits>>52) & 0x7ff);
+        uint64_t word = 0;
+
+        if(biased==0x7ff) {
+            word = 0x7fffffffffffffffULL;       // Infinity and NaN saturate.
+        } else if(biased!=0) {                  // Zero and subnormals are 0.
+            // value = significand * 2^(power - 53) with the implicit bit,
+            // power = 4 * exponent + shift and -3 <= shift <= 0.
+            uint64_t significand = (bits & 0x000fffffffffffffULL) |
+                                   0x0010000000000000ULL;
+            int power = biased - 1022;
+            int exponent = (power + 3)>>2;
+            uint64_t fraction = significand<<(3 + power - 4 * exponent);
+            exponent += 64;
+
+            if(exponent>127) {
+                word = 0x7fffffffffffffffULL;
+            } else if(exponent>=0) {
+                word = ((uint64_t)exponent<<56) | fraction;
+            } else if(exponent>-14) {
+                word = fraction>>(-4 * exponent);
+            }
+        }
+
+        word = __builtin_bswap64(word | sign);
+        memcpy(p, &word, sizeof(word));
+    }
+
+    void decodeReal8Array(const unsigned char *input, double *output,
+                          size_t count)
+    {
+        // No loop carried state, so the compiler is free to unroll and
+        // interleave the conversions.
+        for(size_t i=0; i<count; ++i) {
+            output[i] = decodeReal8(input + i * 8);
+        }
+    }
+} // End namespace gdsfp
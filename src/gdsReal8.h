@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSREAL8_H_
+#define GDSREAL8_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace gdsfp
+{
+    /*
+     *  GDSII REAL_8 is the IBM hexadecimal floating point format: a sign bit,
+     *  a 7 bit base 16 exponent in excess 64 and a 56 bit fraction, so the
+     *  value is fraction * 2^(4 * (exponent - 64) - 56).
+     *
+     *  Every such value lies between 2^-312 and 2^252, well inside the range
+     *  of normal IEEE-754 doubles.  Converting the integer fraction to a
+     *  double normalizes it and rounds it from 56 to 53 bits (to nearest,
+     *  ties to even), the power of two is then applied by rebiasing the
+     *  exponent field directly, which is exact.  The result is the correctly
+     *  rounded double, with no pow() and no branches.
+     */
+    inline double decodeReal8(const unsigned char *p)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        word = __builtin_bswap64(word);
+
+        int64_t fraction = word & 0x00ffffffffffffffULL;
+        int scale = 4 * (int)((word>>56) & 0x7f) - 256 - 56;
+        double magnitude = (double)fraction;
+        uint64_t bits;
+        memcpy(&bits, &magnitude, sizeof(bits));
+        bits += (uint64_t)(int64_t)scale<<52;
+        bits &= -(uint64_t)(fraction!=0);       // Zero, whatever the exponent.
+        bits |= word & 0x8000000000000000ULL;
+        memcpy(&magnitude, &bits, sizeof(magnitude));
+        return magnitude;
+    }
+
+    /*
+     *  The reverse.  The 53 bit significand of a double always fits in the
+     *  56 bit fraction, so every double in the REAL_8 range is stored
+     *  exactly and decodes to the same value.  Values beyond the range
+     *  saturate, values below it lose precision down to zero.
+     */
+    void encodeReal8(double value, unsigned char *p);
+
+    // Converts count consecutive REAL_8 values.
+    void decodeReal8Array(const unsigned char *input, double *output,
+                          size_t count);
+
+} // End namespace gdsfp
+
+#endif //GDSREAL8_H_
@@ -0,0 +1,294 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsRecordReader.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gdsfp
+{
+    // A record is at most 65535 bytes, so a block always holds a full one.
+    static const unsigned int BLOCK_SIZE = 4 * 1024 * 1024;
+
+    gdsRecordReader::gdsRecordReader()
+        : fd(-1), ownsFd(false), map(NULL), ownsMap(false), fileSize(0),
+          position(0), buffer(NULL),
+          bufferOffset(0), bufferFill(0), seekable(true)
+    {
+    }
+
+    gdsRecordReader::~gdsRecordReader()
+    {
+        close();
+    }
+
+    int gdsRecordReader::open(const char *filePath, bool useMmap)
+    {
+        close();
+        fd = ::open(filePath, O_RDONLY);
+
+        if(fd<0) {
+            return 1;
+        }
+
+        ownsFd = true;
+        return attach(useMmap);
+    }
+
+    int gdsRecordReader::open(int fd, bool useMmap)
+    {
+        close();
+
+        if(fd<0) {
+            return 1;
+        }
+
+        this->fd = fd;
+
+        if(attach(useMmap)!=0) {
+            return 1;
+        }
+
+        // Start where the caller left the descriptor.  Record offsets stay
+        // file offsets, and the descriptor position itself is not moved.
+        off_t start = lseek(fd, 0, SEEK_CUR);
+
+        if(start>0) {
+            position = start;
+
+            if(map!=NULL && position>fileSize) {
+                position = fileSize;
+            }
+
+            bufferOffset = position;
+        }
+
+        return 0;
+    }
+
+    int gdsRecordReader::open(const void *data, unsigned long long size)
+    {
+        close();
+        map = (const unsigned char *)data;
+        fileSize = size;
+        return 0;
+    }
+
+    int gdsRecordReader::attach(bool useMmap)
+    {
+        struct stat info;
+
+        if(fstat(fd, &info)==0 && S_ISREG(info.st_mode)) {
+            fileSize = info.st_size;
+        }
+
+        if(useMmap && fileSize>0) {
+            void *addr = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if(addr!=MAP_FAILED) {
+                madvise(addr, fileSize, MADV_SEQUENTIAL);
+                map = (const unsigned char *)addr;
+                ownsMap = true;
+                return 0;
+            }
+        }
+
+        buffer = (unsigned char *)malloc(BLOCK_SIZE);
+
+        if(buffer==NULL) {
+            close();
+            return 1;
+        }
+
+        return 0;
+    }
+
+    void gdsRecordReader::close()
+    {
+        if(map!=NULL && ownsMap) {
+            munmap((void *)map, fileSize);
+        }
+
+        if(fd>=0 && ownsFd) {
+            ::close(fd);
+        }
+
+        map = NULL;
+        ownsMap = false;
+        fd = -1;
+        ownsFd = false;
+
+        free(buffer);
+        buffer = NULL;
+        fileSize = 0;
+        position = 0;
+        bufferOffset = 0;
+        bufferFill = 0;
+        seekable = true;
+    }
+
+    bool gdsRecordReader::isMapped() const
+    {
+        return map!=NULL;
+    }
+
+    unsigned long long gdsRecordReader::size() const
+    {
+        return fileSize;
+    }
+
+    int gdsRecordReader::seek(unsigned long long offset)
+    {
+        if(map!=NULL) {
+            if(offset>fileSize) {
+                return 1;
+            }
+
+            position = offset;
+            return 0;
+        }
+
+        if(fd<0 || !seekable) {
+            return 1;
+        }
+
+        position = offset;
+        bufferOffset = offset;
+        bufferFill = 0;
+        return 0;
+    }
+
+    int gdsRecordReader::fill(unsigned int needed)
+    {
+        unsigned int start = position - bufferOffset;
+
+        if(start + needed<=bufferFill) {
+            return 1;
+        }
+
+        // Keep the unread tail and refill the rest of the block behind it.
+        unsigned int tail = bufferFill - start;
+        memmove(buffer, buffer + start, tail);
+        bufferOffset = position;
+        bufferFill = tail;
+
+        while(bufferFill<needed) {
+            ssize_t count;
+
+            if(seekable) {
+                count = pread(fd, buffer + bufferFill, BLOCK_SIZE - bufferFill,
+                              bufferOffset + bufferFill);
+
+                if(count<0 && errno==ESPIPE) {
+                    seekable = false;
+                    continue;
+                }
+            } else {
+                count = read(fd, buffer + bufferFill, BLOCK_SIZE - bufferFill);
+            }
+
+            if(count<0) {
+                if(errno==EINTR) {
+                    continue;
+                }
+
+                return -1;
+            }
+
+            if(count==0) {
+                return 0;   // We have reached the end of the file.
+            }
+
+            bufferFill += count;
+        }
+
+        return 1;
+    }
+
+    int gdsRecordReader::next(gdsRecord *record)
+    {
+        const unsigned char *p;
+        record->offset = position;
+
+        // The file may end between records, but not inside a record
+        // header, as in the push parser.
+        if(map!=NULL) {
+            if(position + 2>fileSize) {
+                return position==fileSize ? 0 : -1;
+            }
+
+            p = map + position;
+        } else {
+            if(fd<0) {
+                return -1;
+            }
+
+            int status = fill(2);
+
+            if(status==0 && bufferFill>position - bufferOffset) {
+                return -1;
+            }
+
+            if(status<=0) {
+                return status;
+            }
+
+            p = buffer + (position - bufferOffset);
+        }
+
+        unsigned int length = (p[0]<<8) | p[1];
+
+        if(length==0) {
+            return 0;   // Zero padding after ENDLIB.
+        }
+
+        if(length<4) {
+            return -1;
+        }
+
+        if(map!=NULL) {
+            if(position + length>fileSize) {
+                return -1;
+            }
+        } else {
+            if(fill(length)<=0) {
+                return -1;
+            }
+
+            p = buffer + (position - bufferOffset);
+        }
+
+        record->recordType = p[2];
+        record->dataType = p[3];
+        record->data = p + 4;
+        record->length = length - 4;
+        position += length;
+        return 1;
+    }
+} // End namespace gdsfp
@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSRECORDREADER_H_
+#define GDSRECORDREADER_H_
+
+namespace gdsfp
+{
+    /*
+     *  A single GDSII record.  The data pointer refers to the payload that
+     *  follows the 4 byte record header and stays valid until the next call
+     *  to gdsRecordReader::next().
+     */
+    struct gdsRecord {
+        const unsigned char *data;
+        unsigned int length;            // Payload length in bytes.
+        unsigned char recordType;
+        unsigned char dataType;
+        unsigned long long offset;      // File offset of the record header.
+    };
+
+    /*
+     *  Reads the records of a GDSII file without copying them.  Regular files
+     *  are memory mapped, anything that can not be mapped is read in large
+     *  blocks with pread() (or read() for pipes).
+     */
+    class gdsRecordReader
+    {
+    public:
+        gdsRecordReader();
+        ~gdsRecordReader();
+
+        int open(const char *filePath, bool useMmap = true);
+        // Reads from a descriptor the caller keeps ownership of, starting at
+        // its current position.
+        int open(int fd, bool useMmap = true);
+        // Reads from a GDSII image already in memory, without copying it.
+        int open(const void *data, unsigned long long size);
+        void close();
+
+        // Returns 1 when a record was read, 0 at the end of the stream and
+        // -1 when the stream is malformed or can not be read.
+        int next(gdsRecord *record);
+
+        // Moves to the record header at the given file offset.
+        int seek(unsigned long long offset);
+
+        bool isMapped() const;
+        unsigned long long size() const;
+
+    private:
+        gdsRecordReader(const gdsRecordReader &);
+        gdsRecordReader &operator=(const gdsRecordReader &);
+
+        int fill(unsigned int needed);
+        int attach(bool useMmap);
+
+        int fd;
+        bool ownsFd;
+        const unsigned char *map;
+        bool ownsMap;
+        unsigned long long fileSize;
+        unsigned long long position;    // Offset of the next record.
+
+        unsigned char *buffer;          // Block buffer for the read fallback.
+        unsigned long long bufferOffset;// File offset of buffer[0].
+        unsigned int bufferFill;
+        bool seekable;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSRECORDREADER_H_
@@ -0,0 +1,909 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsSnapshot.h"
+#include "gdsCalmaRecords.h"
+#include "gdsFileParser.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace gdsfp
+{
+    static const char SNAPSHOT_MAGIC[16] = "gdsfp-snapshot";
+    static const uint32_t SNAPSHOT_VERSION = 2;
+    static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+    static const size_t COLUMN_ALIGNMENT = 64;
+    static const size_t HASHED_BYTES = 1<<20;   // At each end of the file.
+
+    struct snapshotColumn {
+        uint64_t offset;                // From the start of the snapshot.
+        uint64_t count;
+    };
+
+    struct gdsSnapshot::header {
+        char magic[16];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t typeSizes[7];
+        uint64_t snapshotSize;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        int64_t sourceNsec;
+        uint64_t sourceHash;
+        double userUnits;
+        double databaseUnits;
+        uint32_t libName;
+        uint32_t gdsVersion;
+        int16_t libModified[6];
+        int16_t libAccessed[6];
+        snapshotColumn strings;
+        snapshotColumn structures;
+        snapshotColumn ranges;
+        snapshotColumn texts;
+        snapshotColumn references;
+        snapshotColumn properties;
+        snapshotColumn order;
+        snapshotColumn layers;
+    };
+
+    struct gdsSnapshot::layerEntry {
+        uint32_t number;
+        uint32_t reserved;
+        snapshotColumn shapes;
+        snapshotColumn x;
+        snapshotColumn y;
+    };
+
+    static void typeSizes(uint32_t sizes[7])
+    {
+        sizes[0] = sizeof(gdsStructure);
+        sizes[1] = sizeof(gdsLayerRange);
+        sizes[2] = sizeof(gdsText);
+        sizes[3] = sizeof(gdsReference);
+        sizes[4] = sizeof(gdsProperty);
+        sizes[5] = sizeof(gdsShape);
+        sizes[6] = sizeof(gdsElementOrder);
+    }
+
+    static uint64_t hashBytes(uint64_t hash, const unsigned char *data,
+                              size_t length)
+    {
+        for(size_t i=0; i<length; ++i) {
+            hash = (hash ^ data[i]) * 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    // Size, modification time and an FNV-1a hash of the first and the last
+    // megabyte, which catches rewrites that keep both of the others without
+    // reading all of a large file.
+    static int sourceStamp(const char *sourcePath, uint64_t *size,
+                           int64_t *time, int64_t *nsec, uint64_t *hash)
+    {
+        int fd = open(sourcePath, O_RDONLY);
+        struct stat info;
+
+        if(fd<0) {
+            return 1;
+        }
+
+        if(fstat(fd, &info)!=0) {
+            close(fd);
+            return 1;
+        }
+
+        (*size) = info.st_size;
+        (*time) = info.st_mtim.tv_sec;
+        (*nsec) = info.st_mtim.tv_nsec;
+        (*hash) = 0xcbf29ce484222325ULL;
+
+        vector<unsigned char> block(HASHED_BYTES);
+        uint64_t starts[2] = { 0, 0 };
+        int blocks = 1;
+
+        if((*size)>HASHED_BYTES) {
+            starts[1] = (*size)>2 * HASHED_BYTES ? (*size) - HASHED_BYTES
+                                                 : HASHED_BYTES;
+            blocks = 2;
+        }
+
+        for(int b=0; b<blocks; ++b) {
+            ssize_t got = pread(fd, &block[0], HASHED_BYTES, starts[b]);
+
+            if(got<0) {
+                close(fd);
+                return 1;
+            }
+
+            (*hash) = hashBytes(*hash, &block[0], got);
+        }
+
+        close(fd);
+        return 0;
+    }
+
+    // Appends a column at the next aligned offset.
+    static int writeColumn(FILE *file, uint64_t *offset, const void *data,
+                           uint64_t count, size_t size,
+                           snapshotColumn *column)
+    {
+        static const char zeros[COLUMN_ALIGNMENT] = { 0 };
+        size_t padding = (COLUMN_ALIGNMENT - (*offset) % COLUMN_ALIGNMENT) %
+                         COLUMN_ALIGNMENT;
+
+        if(padding>0 && fwrite(zeros, 1, padding, file)!=padding) {
+            return 1;
+        }
+
+        (*offset) += padding;
+        column->offset = (*offset);
+        column->count = count;
+
+        if(count>0 && fwrite(data, size, count, file)!=count) {
+            return 1;
+        }
+
+        (*offset) += count * size;
+        return 0;
+    }
+
+    gdsSnapshot::gdsSnapshot()
+        : map(NULL), mapSize(0), head(NULL), layerTable(NULL)
+    {
+    }
+
+    gdsSnapshot::~gdsSnapshot()
+    {
+        close();
+    }
+
+    std::string gdsSnapshot::sidecarPath(const char *filePath)
+    {
+        return std::string(filePath) + ".gdssnap";
+    }
+
+    // The header, then every column, then the header again with the
+    // offsets of the columns filled in.
+    int gdsSnapshot::writeImage(const gdsLibrary &library,
+                                const char *sourcePath, FILE *file)
+    {
+        header top;
+        memset(&top, 0, sizeof(top));
+        memcpy(top.magic, SNAPSHOT_MAGIC, sizeof(top.magic));
+        top.version = SNAPSHOT_VERSION;
+        top.byteOrder = SNAPSHOT_BYTE_ORDER;
+        typeSizes(top.typeSizes);
+        top.userUnits = library.userUnits();
+        top.databaseUnits = library.databaseUnits();
+        top.libName = library.libName;
+        top.gdsVersion = library.version();
+        memcpy(top.libModified, library.modified(), sizeof(top.libModified));
+        memcpy(top.libAccessed, library.accessed(), sizeof(top.libAccessed));
+
+        if(sourceStamp(sourcePath, &top.sourceSize, &top.sourceTime,
+                       &top.sourceNsec, &top.sourceHash)!=0) {
+            return 1;
+        }
+
+        uint64_t offset = sizeof(top);
+        int status = fwrite(&top, sizeof(top), 1, file)!=1;
+
+        status |= writeColumn(file, &offset, library.strings.data(),
+                              library.strings.length(), sizeof(char),
+                              &top.strings);
+        status |= writeColumn(file, &offset, library.structures().data(),
+                              library.structures().length(),
+                              sizeof(gdsStructure), &top.structures);
+        status |= writeColumn(file, &offset, library.ranges().data(),
+                              library.ranges().length(),
+                              sizeof(gdsLayerRange), &top.ranges);
+        status |= writeColumn(file, &offset, library.texts().data(),
+                              library.texts().length(), sizeof(gdsText),
+                              &top.texts);
+        status |= writeColumn(file, &offset, library.references().data(),
+                              library.references().length(),
+                              sizeof(gdsReference), &top.references);
+        status |= writeColumn(file, &offset, library.properties().data(),
+                              library.properties().length(),
+                              sizeof(gdsProperty), &top.properties);
+        status |= writeColumn(file, &offset, library.order().data(),
+                              library.order().length(),
+                              sizeof(gdsElementOrder), &top.order);
+
+        const vector<gdsLayer> &layers = library.layers();
+        vector<layerEntry> entries(layers.size());
+
+        for(size_t i=0; i<layers.size() && status==0; ++i) {
+            const gdsLayer &layer = layers[i];
+            layerEntry &entry = entries[i];
+            memset(&entry, 0, sizeof(entry));
+            entry.number = layer.number;
+            status |= writeColumn(file, &offset, layer.shapes.data(),
+                                  layer.shapes.length(), sizeof(gdsShape),
+                                  &entry.shapes);
+            status |= writeColumn(file, &offset, layer.x.data(),
+                                  layer.x.length(), sizeof(int), &entry.x);
+            status |= writeColumn(file, &offset, layer.y.data(),
+                                  layer.y.length(), sizeof(int), &entry.y);
+        }
+
+        status |= writeColumn(file, &offset, entries.data(), entries.size(),
+                              sizeof(layerEntry), &top.layers);
+        top.snapshotSize = offset;
+
+        if(status==0) {
+            status = fseek(file, 0, SEEK_SET)!=0 ||
+                     fwrite(&top, sizeof(top), 1, file)!=1 ||
+                     fflush(file)!=0;
+        }
+
+        return status;
+    }
+
+    int gdsSnapshot::write(const gdsLibrary &library, const char *sourcePath,
+                           const char *snapshotPath)
+    {
+        // Written under a unique name and renamed when complete, so that a
+        // reader never maps half a snapshot, even while several processes
+        // save the same one.
+        std::string partial = std::string(snapshotPath) + ".XXXXXX";
+        int fd = mkstemp(&partial[0]);
+
+        if(fd<0) {
+            return 1;
+        }
+
+        fchmod(fd, 0644);
+        FILE *file = fdopen(fd, "wb");
+
+        if(file==NULL) {
+            ::close(fd);
+            unlink(partial.c_str());
+            return 1;
+        }
+
+        int status = writeImage(library, sourcePath, file);
+        status |= fclose(file)!=0;
+
+        if(status!=0 || rename(partial.c_str(), snapshotPath)!=0) {
+            unlink(partial.c_str());
+            return 1;
+        }
+
+        return 0;
+    }
+
+    int gdsSnapshot::load(const char *snapshotPath, const char *sourcePath)
+    {
+        close();
+        int fd = ::open(snapshotPath, O_RDONLY);
+
+        if(fd<0) {
+            return 1;
+        }
+
+        int status = attach(fd, sourcePath);
+        ::close(fd);
+        return status;
+    }
+
+    int gdsSnapshot::attach(int fd, const char *sourcePath)
+    {
+        struct stat info;
+
+        if(fstat(fd, &info)!=0 || (size_t)info.st_size<sizeof(header)) {
+            return 1;
+        }
+
+        // Private and writable, so the XY arrays handed to the callbacks
+        // may be changed by them without touching the file.
+        void *addr = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+
+        if(addr==MAP_FAILED) {
+            return 1;
+        }
+
+        map = (unsigned char *)addr;
+        mapSize = info.st_size;
+        head = (const header *)map;
+
+        uint32_t sizes[7];
+        typeSizes(sizes);
+        uint64_t size;
+        int64_t time, nsec;
+        uint64_t hash;
+
+        if(memcmp(head->magic, SNAPSHOT_MAGIC, sizeof(head->magic))!=0 ||
+           head->version!=SNAPSHOT_VERSION || head->byteOrder!=SNAPSHOT_BYTE_ORDER ||
+           memcmp(head->typeSizes, sizes, sizeof(sizes))!=0 ||
+           head->snapshotSize!=mapSize ||
+           sourceStamp(sourcePath, &size, &time, &nsec, &hash)!=0 ||
+           size!=head->sourceSize || time!=head->sourceTime ||
+           nsec!=head->sourceNsec || hash!=head->sourceHash ||
+           !isConsistent()) {
+            close();
+            return 1;
+        }
+
+        layerTable = column<layerEntry>(head->layers.offset);
+        return 0;
+    }
+
+    // A string offset is good when it lies in the pool, which ends with a
+    // NUL, so that every string in it is terminated.
+    bool gdsSnapshot::isString(uint32_t offset) const
+    {
+        return offset<head->strings.count;
+    }
+
+    // Every column has to lie inside the mapping, and every offset and
+    // index in the columns inside the column it points into, so that the
+    // accessors and replay() never read past the mapping.
+    bool gdsSnapshot::isConsistent() const
+    {
+        struct { const snapshotColumn *column; size_t size; } columns[] = {
+            { &head->strings, sizeof(char) },
+            { &head->structures, sizeof(gdsStructure) },
+            { &head->ranges, sizeof(gdsLayerRange) },
+            { &head->texts, sizeof(gdsText) },
+            { &head->references, sizeof(gdsReference) },
+            { &head->properties, sizeof(gdsProperty) },
+            { &head->order, sizeof(gdsElementOrder) },
+            { &head->layers, sizeof(layerEntry) }
+        };
+
+        for(size_t i=0; i<sizeof(columns) / sizeof(columns[0]); ++i) {
+            const snapshotColumn &column = *columns[i].column;
+
+            if(column.offset % COLUMN_ALIGNMENT!=0 || column.offset>mapSize ||
+               column.count>(mapSize - column.offset) / columns[i].size ||
+               column.count>GDS_NONE) {
+                return false;
+            }
+        }
+
+        if(head->strings.count==0 ||
+           map[head->strings.offset + head->strings.count - 1]!='\0' ||
+           !isString(head->libName)) {
+            return false;
+        }
+
+        const layerEntry *layers = column<layerEntry>(head->layers.offset);
+        uint64_t propertyCount = head->properties.count;
+
+        for(uint32_t i=0; i<head->layers.count; ++i) {
+            const layerEntry &entry = layers[i];
+            const snapshotColumn *parts[3] = { &entry.shapes, &entry.x,
+                                               &entry.y };
+            size_t partSizes[3] = { sizeof(gdsShape), sizeof(int),
+                                    sizeof(int) };
+
+            for(int p=0; p<3; ++p) {
+                if(parts[p]->offset % COLUMN_ALIGNMENT!=0 ||
+                   parts[p]->offset>mapSize ||
+                   parts[p]->count>(mapSize - parts[p]->offset) /
+                                   partSizes[p]) {
+                    return false;
+                }
+            }
+
+            if(entry.x.count!=entry.y.count) {
+                return false;
+            }
+
+            const gdsShape *shapes = column<gdsShape>(entry.shapes.offset);
+
+            for(uint64_t s=0; s<entry.shapes.count; ++s) {
+                const gdsShape &shape = shapes[s];
+
+                if((uint64_t)shape.firstPoint + shape.pointCount>
+                   entry.x.count ||
+                   (uint64_t)shape.firstProperty + shape.propertyCount>
+                   propertyCount) {
+                    return false;
+                }
+            }
+        }
+
+        for(uint32_t i=0; i<head->texts.count; ++i) {
+            const gdsText &text = texts()[i];
+
+            if(!isString(text.string) ||
+               (uint64_t)text.firstProperty + text.propertyCount>
+               propertyCount) {
+                return false;
+            }
+        }
+
+        for(uint32_t i=0; i<head->references.count; ++i) {
+            const gdsReference &reference = references()[i];
+
+            if(!isString(reference.name) ||
+               (reference.structure!=GDS_NONE &&
+                reference.structure>=head->structures.count) ||
+               (uint64_t)reference.firstProperty + reference.propertyCount>
+               propertyCount) {
+                return false;
+            }
+        }
+
+        for(uint32_t i=0; i<propertyCount; ++i) {
+            if(!isString(properties()[i].value)) {
+                return false;
+            }
+        }
+
+        for(uint32_t i=0; i<head->ranges.count; ++i) {
+            const gdsLayerRange &range = ranges()[i];
+
+            if(range.layer>=head->layers.count ||
+               (uint64_t)range.firstShape + range.shapeCount>
+               layers[range.layer].shapes.count) {
+                return false;
+            }
+        }
+
+        // The order of a structure has to name each of its shapes, texts
+        // and references exactly once.
+        vector<uint32_t> shapesLeft;
+
+        for(uint32_t i=0; i<head->structures.count; ++i) {
+            const gdsStructure &structure = structures()[i];
+
+            if(!isString(structure.name) ||
+               (uint64_t)structure.firstRange + structure.rangeCount>
+               head->ranges.count ||
+               (uint64_t)structure.firstText + structure.textCount>
+               head->texts.count ||
+               (uint64_t)structure.firstReference + structure.referenceCount>
+               head->references.count ||
+               (uint64_t)structure.firstElement + structure.elementCount>
+               head->order.count) {
+                return false;
+            }
+
+            shapesLeft.resize(structure.rangeCount);
+            uint64_t textsLeft = structure.textCount;
+            uint64_t referencesLeft = structure.referenceCount;
+
+            for(uint32_t r=0; r<structure.rangeCount; ++r) {
+                shapesLeft[r] = ranges()[structure.firstRange + r].shapeCount;
+            }
+
+            for(uint32_t e=0; e<structure.elementCount; ++e) {
+                const gdsElementOrder &element =
+                    order()[structure.firstElement + e];
+
+                switch(element.type) {
+                    case BOUNDARY:
+                    case PATH:
+                    case BOX:
+                    case NODE:
+                        if(element.range>=structure.rangeCount ||
+                           shapesLeft[element.range]--==0) {
+                            return false;
+                        }
+
+                        break;
+
+                    case TEXT:
+                        if(textsLeft--==0) {
+                            return false;
+                        }
+
+                        break;
+
+                    case SREF:
+                    case AREF:
+                        if(referencesLeft--==0) {
+                            return false;
+                        }
+
+                        break;
+
+                    default:
+                        return false;
+                }
+            }
+
+            if(textsLeft!=0 || referencesLeft!=0) {
+                return false;
+            }
+
+            for(uint32_t r=0; r<structure.rangeCount; ++r) {
+                if(shapesLeft[r]!=0) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    int gdsSnapshot::open(const char *filePath, unsigned int threads)
+    {
+        std::string snapshotPath = sidecarPath(filePath);
+
+        if(load(snapshotPath.c_str(), filePath)==0) {
+            return 0;
+        }
+
+        gdsLibrary library;
+
+        if(library.load(filePath, threads)!=0) {
+            return 1;
+        }
+
+        if(write(library, filePath, snapshotPath.c_str())==0 &&
+           load(snapshotPath.c_str(), filePath)==0) {
+            return 0;
+        }
+
+        // The sidecar can not be saved, which is not an error: map a
+        // snapshot in an unnamed temporary file instead.
+        FILE *file = tmpfile();
+
+        if(file==NULL) {
+            return 1;
+        }
+
+        int status = writeImage(library, filePath, file);
+
+        if(status==0) {
+            status = attach(fileno(file), filePath);
+        }
+
+        fclose(file);
+        return status;
+    }
+
+    void gdsSnapshot::close()
+    {
+        if(map!=NULL) {
+            munmap(map, mapSize);
+        }
+
+        map = NULL;
+        mapSize = 0;
+        head = NULL;
+        layerTable = NULL;
+    }
+
+    const char *gdsSnapshot::name() const
+    {
+        return string(head->libName);
+    }
+
+    unsigned short gdsSnapshot::version() const
+    {
+        return head->gdsVersion;
+    }
+
+    double gdsSnapshot::userUnits() const
+    {
+        return head->userUnits;
+    }
+
+    double gdsSnapshot::databaseUnits() const
+    {
+        return head->databaseUnits;
+    }
+
+    const char *gdsSnapshot::string(uint32_t offset) const
+    {
+        return column<char>(head->strings.offset) + offset;
+    }
+
+    uint32_t gdsSnapshot::structureCount() const
+    {
+        return head!=NULL ? head->structures.count : 0;
+    }
+
+    const gdsStructure *gdsSnapshot::structures() const
+    {
+        return column<gdsStructure>(head->structures.offset);
+    }
+
+    const gdsLayerRange *gdsSnapshot::ranges() const
+    {
+        return column<gdsLayerRange>(head->ranges.offset);
+    }
+
+    const gdsText *gdsSnapshot::texts() const
+    {
+        return column<gdsText>(head->texts.offset);
+    }
+
+    const gdsReference *gdsSnapshot::references() const
+    {
+        return column<gdsReference>(head->references.offset);
+    }
+
+    const gdsProperty *gdsSnapshot::properties() const
+    {
+        return column<gdsProperty>(head->properties.offset);
+    }
+
+    const gdsElementOrder *gdsSnapshot::order() const
+    {
+        return column<gdsElementOrder>(head->order.offset);
+    }
+
+    uint32_t gdsSnapshot::layerCount() const
+    {
+        return head!=NULL ? head->layers.count : 0;
+    }
+
+    unsigned short gdsSnapshot::layerNumber(uint32_t layer) const
+    {
+        return layerTable[layer].number;
+    }
+
+    const gdsShape *gdsSnapshot::shapes(uint32_t layer) const
+    {
+        return column<gdsShape>(layerTable[layer].shapes.offset);
+    }
+
+    const int *gdsSnapshot::x(uint32_t layer) const
+    {
+        return column<int>(layerTable[layer].x.offset);
+    }
+
+    const int *gdsSnapshot::y(uint32_t layer) const
+    {
+        return column<int>(layerTable[layer].y.offset);
+    }
+
+    void gdsSnapshot::replayProperties(gdsFileParser *handler, uint32_t first,
+                                       uint32_t count) const
+    {
+        for(uint32_t i=0; i<count; ++i) {
+            const gdsProperty &property = properties()[first + i];
+            handler->onParsedPropertyNumber(property.attribute);
+            handler->onParsedPropValueView(string(property.value));
+        }
+    }
+
+    // Optional records are given back when the file had them, or when they
+    // hold something other than the default.
+    void gdsSnapshot::replayShape(gdsFileParser *handler, uint32_t layer,
+                                  const gdsShape &shape,
+                                  unsigned char records) const
+    {
+        switch(shape.type) {
+            case BOUNDARY:  handler->onParsedBoundaryStart(); break;
+            case PATH:      handler->onParsedPathStart();     break;
+            case BOX:       handler->onParsedBoxStart();      break;
+            default:        handler->onParsedNodeStart();     break;
+        }
+
+        handler->onParsedLayer(layerNumber(layer));
+
+        switch(shape.type) {
+            case BOX:
+                handler->onParsedBoxType(shape.dataType);
+                break;
+
+            case NODE:
+                handler->onParsedNodeType(shape.dataType);
+                break;
+
+            default:
+                handler->onParsedDataType(shape.dataType);
+                break;
+        }
+
+        if((records & GDS_HAS_PATHTYPE) || shape.pathType!=0) {
+            handler->onParsedPathType(shape.pathType);
+        }
+
+        if((records & GDS_HAS_WIDTH) || shape.width!=0) {
+            handler->onParsedWidth(shape.width);
+        }
+
+        if((records & GDS_HAS_BGNEXTN) || shape.beginExtension!=0) {
+            handler->onParsedBeginExtension32(shape.beginExtension);
+        }
+
+        if((records & GDS_HAS_ENDEXTN) || shape.endExtension!=0) {
+            handler->onParsedEndExtension32(shape.endExtension);
+        }
+
+        handler->onParsedXY(shape.pointCount,
+                            (int *)x(layer) + shape.firstPoint,
+                            (int *)y(layer) + shape.firstPoint);
+        replayProperties(handler, shape.firstProperty, shape.propertyCount);
+        handler->onParsedEndElement();
+    }
+
+    void gdsSnapshot::replayText(gdsFileParser *handler, const gdsText &text,
+                                 unsigned char records) const
+    {
+        gdsText &point = (gdsText &)text;
+        bool mag = (records & GDS_HAS_MAG) || text.mag!=1.0;
+        bool angle = (records & GDS_HAS_ANGLE) || text.angle!=0.0;
+
+        handler->onParsedTextStart();
+        handler->onParsedLayer(text.layer);
+        handler->onParsedTextType(text.textType);
+
+        if((records & GDS_HAS_PRESENTATION) || text.presentation!=0) {
+            handler->onParsedPresentation(text.presentation & 0x30,
+                                          text.presentation & 0x0c,
+                                          text.presentation & 0x03);
+        }
+
+        if((records & GDS_HAS_PATHTYPE) || text.pathType!=0) {
+            handler->onParsedPathType(text.pathType);
+        }
+
+        if((records & GDS_HAS_WIDTH) || text.width!=0) {
+            handler->onParsedWidth(text.width);
+        }
+
+        if((records & GDS_HAS_STRANS) || text.strans!=0 || mag || angle) {
+            handler->onParsedStrans(text.strans);
+
+            if(mag) {
+                handler->onParsedMag(text.mag);
+            }
+
+            if(angle) {
+                handler->onParsedAngle(text.angle);
+            }
+        }
+
+        handler->onParsedXY(1, &point.x, &point.y);
+        handler->onParsedStringView(string(text.string));
+        replayProperties(handler, text.firstProperty, text.propertyCount);
+        handler->onParsedEndElement();
+    }
+
+    void gdsSnapshot::replayReference(gdsFileParser *handler,
+                                      const gdsReference &reference,
+                                      unsigned char records) const
+    {
+        gdsReference &points = (gdsReference &)reference;
+        bool array = reference.type==AREF;
+        bool mag = (records & GDS_HAS_MAG) || reference.mag!=1.0;
+        bool angle = (records & GDS_HAS_ANGLE) || reference.angle!=0.0;
+
+        if(array) {
+            handler->onParsedArefStart();
+        } else {
+            handler->onParsedSrefStart();
+        }
+
+        handler->onParsedSnameView(string(reference.name));
+
+        if((records & GDS_HAS_STRANS) || reference.strans!=0 || mag || angle) {
+            handler->onParsedStrans(reference.strans);
+
+            if(mag) {
+                handler->onParsedMag(reference.mag);
+            }
+
+            if(angle) {
+                handler->onParsedAngle(reference.angle);
+            }
+        }
+
+        if(array) {
+            handler->onParsedColumnsRows(reference.columns, reference.rows);
+        }
+
+        handler->onParsedXY(array ? 3 : 1, points.x, points.y);
+        replayProperties(handler, reference.firstProperty,
+                         reference.propertyCount);
+        handler->onParsedEndElement();
+    }
+
+    // The elements of each structure come back in the order of the file,
+    // so the records match those of the file, apart from the ones listed
+    // in the header.
+    int gdsSnapshot::replay(gdsFileParser *handler) const
+    {
+        if(head==NULL) {
+            return 1;
+        }
+
+        const int16_t *stamp;
+        handler->onParsedGDSVersion(version()!=0 ? version() : 600);
+        stamp = head->libModified;
+        handler->onParsedModTime(stamp[0], stamp[1], stamp[2], stamp[3],
+                                 stamp[4], stamp[5]);
+        stamp = head->libAccessed;
+        handler->onParsedAccessTime(stamp[0], stamp[1], stamp[2], stamp[3],
+                                    stamp[4], stamp[5]);
+        handler->onParsedLibNameView(name());
+        handler->onParsedUnits(userUnits(), databaseUnits());
+
+        vector<uint32_t> nextShape;
+
+        for(uint32_t s=0; s<structureCount(); ++s) {
+            const gdsStructure &structure = structures()[s];
+            uint32_t nextText = structure.firstText;
+            uint32_t nextReference = structure.firstReference;
+
+            stamp = structure.modified;
+            handler->onParsedModTime(stamp[0], stamp[1], stamp[2], stamp[3],
+                                     stamp[4], stamp[5]);
+            stamp = structure.accessed;
+            handler->onParsedAccessTime(stamp[0], stamp[1], stamp[2],
+                                        stamp[3], stamp[4], stamp[5]);
+            handler->onParsedStrNameView(string(structure.name));
+
+            nextShape.resize(structure.rangeCount);
+
+            for(uint32_t r=0; r<structure.rangeCount; ++r) {
+                nextShape[r] = ranges()[structure.firstRange + r].firstShape;
+            }
+
+            // load() has checked that the order names every element once.
+            for(uint32_t e=0; e<structure.elementCount; ++e) {
+                const gdsElementOrder &element =
+                    order()[structure.firstElement + e];
+
+                switch(element.type) {
+                    case TEXT:
+                        replayText(handler, texts()[nextText++],
+                                   element.records);
+                        break;
+
+                    case SREF:
+                    case AREF:
+                        replayReference(handler,
+                                        references()[nextReference++],
+                                        element.records);
+                        break;
+
+                    default: {
+                        uint32_t layer =
+                            ranges()[structure.firstRange + element.range].layer;
+                        replayShape(handler, layer,
+                                    shapes(layer)[nextShape[element.range]++],
+                                    element.records);
+                        break;
+                    }
+                }
+            }
+
+            handler->onParsedEndStructure();
+        }
+
+        handler->onParsedEndLib();
+        return 0;
+    }
+} // End namespace gdsfp
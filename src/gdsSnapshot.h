@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSSNAPSHOT_H_
+#define GDSSNAPSHOT_H_
+
+#include "gdsLibrary.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace gdsfp
+{
+    class gdsFileParser;
+
+    /*
+     *  A gdsLibrary saved in a binary file that is memory mapped back as it
+     *  is.  Every array of the library (structures, layer ranges, texts,
+     *  references, properties, the element order, the string pool, and the
+     *  shapes and the x and y columns of each layer) is one aligned column
+     *  of the file, so loading does no decoding at all and the accessors
+     *  point straight into the mapping.
+     *
+     *  A snapshot records the size, modification time and a hash of the
+     *  first and last megabyte of the GDSII file it was made from, and is
+     *  only loaded while they still match.  It also records the sizes of
+     *  the column types, so one written by a build with another layout is
+     *  rejected, and every offset and index in it is checked on loading,
+     *  so a damaged one is rejected too.
+     *
+     *      gdsSnapshot snapshot;
+     *      snapshot.open("chip.gds");      // Parses only the first time.
+     *      snapshot.replay(&myParser);
+     */
+    class gdsSnapshot
+    {
+    public:
+        gdsSnapshot();
+        ~gdsSnapshot();
+
+        static int write(const gdsLibrary &library, const char *sourcePath,
+                         const char *snapshotPath);
+
+        int load(const char *snapshotPath, const char *sourcePath);
+        // Loads the sidecar snapshot of the file, or loads the file into a
+        // gdsLibrary, saves the snapshot and maps that.  When the sidecar
+        // can not be saved, e.g. in a read-only directory, the snapshot is
+        // made in an unnamed temporary file instead.
+        int open(const char *filePath, unsigned int threads = 1);
+        void close();
+
+        /*
+         *  Fires the callbacks of the library into a parser, with the time
+         *  stamps, the elements in the order of the file and the optional
+         *  records the elements had, so a gdsFileRewriter writes the file
+         *  again.  Records a gdsLibrary doesn't keep (ELFLAGS, PLEX, and
+         *  elements without XY) are not replayed, and the parser's filters
+         *  don't apply.  The XY arrays point into the mapping.
+         */
+        int replay(gdsFileParser *handler) const;
+
+        const char *name() const;
+        unsigned short version() const;
+        double userUnits() const;
+        double databaseUnits() const;
+        const char *string(uint32_t offset) const;
+
+        uint32_t structureCount() const;
+        const gdsStructure *structures() const;
+        const gdsLayerRange *ranges() const;
+        const gdsText *texts() const;
+        const gdsReference *references() const;
+        const gdsProperty *properties() const;
+        const gdsElementOrder *order() const;
+
+        uint32_t layerCount() const;
+        unsigned short layerNumber(uint32_t layer) const;
+        const gdsShape *shapes(uint32_t layer) const;
+        const int *x(uint32_t layer) const;
+        const int *y(uint32_t layer) const;
+
+        static std::string sidecarPath(const char *filePath);
+
+    private:
+        gdsSnapshot(const gdsSnapshot &);
+        gdsSnapshot &operator=(const gdsSnapshot &);
+
+        struct header;
+        struct layerEntry;
+
+        template<class T> const T *column(uint64_t offset) const {
+            return (const T *)(map + offset);
+        };
+
+        static int writeImage(const gdsLibrary &library,
+                              const char *sourcePath, FILE *file);
+        int attach(int fd, const char *sourcePath);
+        bool isConsistent() const;
+        bool isString(uint32_t offset) const;
+
+        void replayProperties(gdsFileParser *handler, uint32_t first,
+                              uint32_t count) const;
+        void replayShape(gdsFileParser *handler, uint32_t layer,
+                         const gdsShape &shape, unsigned char records) const;
+        void replayText(gdsFileParser *handler, const gdsText &text,
+                        unsigned char records) const;
+        void replayReference(gdsFileParser *handler,
+                             const gdsReference &reference,
+                             unsigned char records) const;
+
+        unsigned char *map;
+        size_t mapSize;
+        const header *head;
+        const layerEntry *layerTable;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSSNAPSHOT_H_
@@ -0,0 +1,537 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsSpatialIndex.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace gdsfp
+{
+    static const uint32_t FANOUT = 16;
+
+    gdsBox gdsBox::empty()
+    {
+        gdsBox box = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+        return box;
+    }
+
+    bool gdsBox::isEmpty() const
+    {
+        return left>right;
+    }
+
+    void gdsBox::add(int x, int y)
+    {
+        left = std::min(left, x);
+        bottom = std::min(bottom, y);
+        right = std::max(right, x);
+        top = std::max(top, y);
+    }
+
+    void gdsBox::add(const gdsBox &other)
+    {
+        if(!other.isEmpty()) {
+            add(other.left, other.bottom);
+            add(other.right, other.top);
+        }
+    }
+
+    bool gdsBox::intersects(const gdsBox &other) const
+    {
+        return left<=other.right && other.left<=right &&
+               bottom<=other.top && other.bottom<=top;
+    }
+
+    // A NaN widens the box to everything rather than reaching the cast.
+    static int clampFloor(double value)
+    {
+        value = floor(value);
+        return !(value>INT_MIN) ? INT_MIN : value>INT_MAX ? INT_MAX :
+               (int)value;
+    }
+
+    static int clampCeil(double value)
+    {
+        value = ceil(value);
+        return value<INT_MIN ? INT_MIN : !(value<INT_MAX) ? INT_MAX :
+               (int)value;
+    }
+
+    gdsBox gdsBox::transformed(const gdsTransform &t) const
+    {
+        if(isEmpty()) {
+            return *this;
+        }
+
+        double xs[2] = { (double)left, (double)right };
+        double ys[2] = { (double)bottom, (double)top };
+        double minX = HUGE_VAL, minY = HUGE_VAL;
+        double maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+
+        for(int i=0; i<2; ++i) {
+            for(int j=0; j<2; ++j) {
+                double x = t.a * xs[i] + t.b * ys[j] + t.tx;
+                double y = t.c * xs[i] + t.d * ys[j] + t.ty;
+                minX = std::min(minX, x);
+                minY = std::min(minY, y);
+                maxX = std::max(maxX, x);
+                maxY = std::max(maxY, y);
+            }
+        }
+
+        gdsBox box = { clampFloor(minX), clampFloor(minY),
+                       clampCeil(maxX), clampCeil(maxY) };
+        return box;
+    }
+
+    // Position along a Hilbert curve over a 65536 x 65536 grid.
+    static uint64_t hilbert(uint32_t x, uint32_t y)
+    {
+        uint64_t d = 0;
+
+        for(uint32_t s=1U<<15; s>0; s>>=1) {
+            uint32_t rx = (x & s)>0;
+            uint32_t ry = (y & s)>0;
+            d += (uint64_t)s * s * ((3 * rx) ^ ry);
+
+            if(ry==0) {
+                if(rx==1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+
+                std::swap(x, y);
+            }
+        }
+
+        return d;
+    }
+
+    // PATHs are grown by half their width on every side, which also covers
+    // square ends.
+    static gdsBox shapeBox(const gdsLayer &layer, const gdsShape &shape)
+    {
+        gdsBox box = gdsBox::empty();
+        const int *x = layer.x.data() + shape.firstPoint;
+        const int *y = layer.y.data() + shape.firstPoint;
+
+        for(uint32_t p=0; p<shape.pointCount; ++p) {
+            box.add(x[p], y[p]);
+        }
+
+        if(shape.type==PATH && shape.width!=0 && !box.isEmpty()) {
+            int half = (int)std::min(std::abs((long long)shape.width) / 2 + 1,
+                                     (long long)INT_MAX / 2);
+            box.left = std::max((long long)INT_MIN, (long long)box.left - half);
+            box.bottom = std::max((long long)INT_MIN,
+                                  (long long)box.bottom - half);
+            box.right = std::min((long long)INT_MAX,
+                                 (long long)box.right + half);
+            box.top = std::min((long long)INT_MAX, (long long)box.top + half);
+        }
+
+        return box;
+    }
+
+    gdsSpatialIndex::gdsSpatialIndex(const gdsLibrary &library)
+        : library(library)
+    {
+    }
+
+    void gdsSpatialIndex::build()
+    {
+        uint32_t count = library.structures().length();
+        std::vector<unsigned char> state(count, 0);
+        boxes.assign(count, gdsBox::empty());
+        cells.assign(count, cell());
+        items.clear();
+        nodes.clear();
+
+        for(uint32_t i=0; i<count; ++i) {
+            computeBox(i, &state);
+        }
+
+        for(uint32_t i=0; i<count; ++i) {
+            buildTree(i);
+        }
+    }
+
+    const gdsBox &gdsSpatialIndex::structureBox(uint32_t structure) const
+    {
+        return boxes[structure];
+    }
+
+    // Children first, each structure once.  A structure that refers back
+    // to itself counts as empty at the point of the cycle.
+    const gdsBox &gdsSpatialIndex::computeBox(
+        uint32_t structure, std::vector<unsigned char> *state)
+    {
+        if((*state)[structure]!=0) {
+            return boxes[structure];
+        }
+
+        (*state)[structure] = 1;
+        const gdsStructure &cell = library.structures()[structure];
+        gdsBox box = gdsBox::empty();
+
+        for(uint32_t r=0; r<cell.rangeCount; ++r) {
+            const gdsLayerRange &range = library.ranges()[cell.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                box.add(shapeBox(layer, layer.shapes[range.firstShape + s]));
+            }
+        }
+
+        for(uint32_t i=0; i<cell.referenceCount; ++i) {
+            const gdsReference &reference =
+                library.references()[cell.firstReference + i];
+
+            if(reference.structure!=GDS_NONE) {
+                computeBox(reference.structure, state);
+                box.add(referenceBox(reference));
+            }
+        }
+
+        boxes[structure] = box;
+        (*state)[structure] = 2;
+        return boxes[structure];
+    }
+
+    // Box of all instances, which for an AREF is the box of its four
+    // corner instances since the lattice is affine.
+    gdsBox gdsSpatialIndex::referenceBox(const gdsReference &reference) const
+    {
+        const gdsBox &child = boxes[reference.structure];
+        gdsBox box = child.transformed(gdsTransform::placement(reference));
+
+        if(reference.type==AREF && reference.columns>0 && reference.rows>0) {
+            unsigned int columns = reference.columns - 1;
+            unsigned int rows = reference.rows - 1;
+            box.add(child.transformed(
+                gdsTransform::placement(reference, columns, 0)));
+            box.add(child.transformed(
+                gdsTransform::placement(reference, 0, rows)));
+            box.add(child.transformed(
+                gdsTransform::placement(reference, columns, rows)));
+        }
+
+        return box;
+    }
+
+    void gdsSpatialIndex::buildTree(uint32_t structure)
+    {
+        const gdsStructure &source = library.structures()[structure];
+        cell &target = cells[structure];
+        target.firstItem = items.size();
+
+        for(uint32_t r=0; r<source.rangeCount; ++r) {
+            const gdsLayerRange &range =
+                library.ranges()[source.firstRange + r];
+            const gdsLayer &layer = library.layers()[range.layer];
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                item entry;
+                entry.box = shapeBox(layer, layer.shapes[range.firstShape + s]);
+                entry.index = range.firstShape + s;
+                entry.layer = range.layer;
+
+                if(!entry.box.isEmpty()) {
+                    items.push_back(entry);
+                }
+            }
+        }
+
+        for(uint32_t i=0; i<source.referenceCount; ++i) {
+            const gdsReference &reference =
+                library.references()[source.firstReference + i];
+
+            if(reference.structure==GDS_NONE) {
+                continue;
+            }
+
+            item entry;
+            entry.box = referenceBox(reference);
+            entry.index = source.firstReference + i;
+            entry.layer = GDS_NONE;
+
+            if(!entry.box.isEmpty()) {
+                items.push_back(entry);
+            }
+        }
+
+        target.itemCount = items.size() - target.firstItem;
+        target.root = GDS_NONE;
+
+        if(target.itemCount==0) {
+            return;
+        }
+
+        // Sort the items by the Hilbert value of their centers, scaled to
+        // the extent of the structure.
+        const gdsBox &extent = boxes[structure];
+        double width = (double)extent.right - extent.left + 1.0;
+        double height = (double)extent.top - extent.bottom + 1.0;
+        std::vector<std::pair<uint64_t, item> > order;
+        order.reserve(target.itemCount);
+
+        for(uint32_t i=0; i<target.itemCount; ++i) {
+            const item &entry = items[target.firstItem + i];
+            double cx = ((double)entry.box.left + entry.box.right) / 2.0;
+            double cy = ((double)entry.box.bottom + entry.box.top) / 2.0;
+            uint32_t hx = (uint32_t)((cx - extent.left) / width * 65535.0);
+            uint32_t hy = (uint32_t)((cy - extent.bottom) / height * 65535.0);
+            order.push_back(std::make_pair(hilbert(std::min(hx, 65535U),
+                                                   std::min(hy, 65535U)),
+                                           entry));
+        }
+
+        std::stable_sort(order.begin(), order.end(),
+                         [](const std::pair<uint64_t, item> &a,
+                            const std::pair<uint64_t, item> &b) {
+                             return a.first<b.first;
+                         });
+
+        for(uint32_t i=0; i<target.itemCount; ++i) {
+            items[target.firstItem + i] = order[i].second;
+        }
+
+        // Pack the leaves, then each level above them, until one node is
+        // left.
+        uint32_t levelStart = nodes.size();
+        uint32_t levelCount = 0;
+
+        for(uint32_t i=0; i<target.itemCount; i+=FANOUT) {
+            node leaf;
+            leaf.box = gdsBox::empty();
+            leaf.first = target.firstItem + i;
+            leaf.count = std::min(FANOUT, target.itemCount - i);
+            leaf.leaf = true;
+
+            for(uint32_t j=0; j<leaf.count; ++j) {
+                leaf.box.add(items[leaf.first + j].box);
+            }
+
+            nodes.push_back(leaf);
+            ++levelCount;
+        }
+
+        while(levelCount>1) {
+            uint32_t nextStart = nodes.size();
+            uint32_t nextCount = 0;
+
+            for(uint32_t i=0; i<levelCount; i+=FANOUT) {
+                node parent;
+                parent.box = gdsBox::empty();
+                parent.first = levelStart + i;
+                parent.count = std::min(FANOUT, levelCount - i);
+                parent.leaf = false;
+
+                for(uint32_t j=0; j<parent.count; ++j) {
+                    parent.box.add(nodes[parent.first + j].box);
+                }
+
+                nodes.push_back(parent);
+                ++nextCount;
+            }
+
+            levelStart = nextStart;
+            levelCount = nextCount;
+        }
+
+        target.root = levelStart;
+    }
+
+    unsigned long long gdsSpatialIndex::query(uint32_t structure,
+                                              const gdsBox &window,
+                                              gdsWindowSink *sink) const
+    {
+        unsigned long long hits = 0;
+
+        if(structure<cells.size()) {
+            queryCell(structure, gdsTransform::identity(), window, 0, sink,
+                      &hits);
+        }
+
+        return hits;
+    }
+
+    void gdsSpatialIndex::queryCell(uint32_t structure,
+                                    const gdsTransform &transform,
+                                    const gdsBox &window, unsigned int depth,
+                                    gdsWindowSink *sink,
+                                    unsigned long long *hits) const
+    {
+        const cell &target = cells[structure];
+
+        // An instance with MAG 0 has no area, and no inverse to bring the
+        // window into its coordinates.
+        if(target.root==GDS_NONE || depth>gdsFlattener::MAX_DEPTH ||
+           transform.isSingular()) {
+            return;
+        }
+
+        gdsBox local = window.transformed(transform.inverse());
+        uint32_t stack[64 * FANOUT];
+        unsigned int top = 0;
+        stack[top++] = target.root;
+
+        while(top>0) {
+            const node &current = nodes[stack[--top]];
+
+            if(!current.box.intersects(local)) {
+                continue;
+            }
+
+            if(!current.leaf) {
+                for(uint32_t i=0; i<current.count; ++i) {
+                    stack[top++] = current.first + i;
+                }
+
+                continue;
+            }
+
+            for(uint32_t i=0; i<current.count; ++i) {
+                const item &entry = items[current.first + i];
+
+                if(!entry.box.intersects(local)) {
+                    continue;
+                }
+
+                if(entry.layer==GDS_NONE) {
+                    queryReference(library.references()[entry.index],
+                                   transform, window, depth, sink, hits);
+                } else if(entry.box.transformed(transform).intersects(
+                              window)) {
+                    const gdsLayer &layer = library.layers()[entry.layer];
+                    gdsWindowHit hit;
+                    hit.layer = &layer;
+                    hit.shape = &layer.shapes[entry.index];
+                    hit.structure = structure;
+                    hit.transform = transform;
+                    sink->onWindowShape(hit);
+                    ++(*hits);
+                }
+            }
+        }
+    }
+
+    // Instances k of a lattice whose interval [low, high] + k * step
+    // overlaps [windowLow, windowHigh].
+    static bool latticeRange(double low, double high, double step,
+                             unsigned int count, double windowLow,
+                             double windowHigh, unsigned int *first,
+                             unsigned int *last)
+    {
+        double from = 0.0, to = count - 1.0;
+
+        if(step==0.0) {
+            if(high<windowLow || low>windowHigh) {
+                return false;
+            }
+        } else {
+            double a = (windowLow - high) / step;
+            double b = (windowHigh - low) / step;
+            from = std::max(from, ceil(std::min(a, b)));
+            to = std::min(to, floor(std::max(a, b)));
+        }
+
+        if(from>to) {
+            return false;
+        }
+
+        (*first) = (unsigned int)from;
+        (*last) = (unsigned int)to;
+        return true;
+    }
+
+    void gdsSpatialIndex::queryReference(const gdsReference &reference,
+                                         const gdsTransform &transform,
+                                         const gdsBox &window,
+                                         unsigned int depth,
+                                         gdsWindowSink *sink,
+                                         unsigned long long *hits) const
+    {
+        unsigned int columns = 1, rows = 1;
+
+        if(reference.type==AREF) {
+            columns = reference.columns;
+            rows = reference.rows;
+        }
+
+        unsigned int firstColumn = 0, lastColumn = columns - 1;
+        unsigned int firstRow = 0, lastRow = rows - 1;
+
+        if(columns==0 || rows==0) {
+            return;
+        }
+
+        if(columns * rows>1) {
+            double cx = (double)(reference.x[1] - reference.x[0]) / columns;
+            double cy = (double)(reference.y[1] - reference.y[0]) / columns;
+            double rx = (double)(reference.x[2] - reference.x[0]) / rows;
+            double ry = (double)(reference.y[2] - reference.y[0]) / rows;
+            gdsBox local = window.transformed(transform.inverse());
+            gdsBox base = boxes[reference.structure].transformed(
+                gdsTransform::placement(reference));
+
+            // Columns along x and rows along y, or the other way around.
+            if(cy==0.0 && rx==0.0) {
+                if(!latticeRange(base.left, base.right, cx, columns,
+                                 local.left, local.right, &firstColumn,
+                                 &lastColumn) ||
+                   !latticeRange(base.bottom, base.top, ry, rows,
+                                 local.bottom, local.top, &firstRow,
+                                 &lastRow)) {
+                    return;
+                }
+            } else if(cx==0.0 && ry==0.0) {
+                if(!latticeRange(base.bottom, base.top, cy, columns,
+                                 local.bottom, local.top, &firstColumn,
+                                 &lastColumn) ||
+                   !latticeRange(base.left, base.right, rx, rows,
+                                 local.left, local.right, &firstRow,
+                                 &lastRow)) {
+                    return;
+                }
+            }
+        }
+
+        const gdsBox &child = boxes[reference.structure];
+
+        for(unsigned int row=firstRow; row<=lastRow; ++row) {
+            for(unsigned int column=firstColumn; column<=lastColumn;
+                ++column) {
+                gdsTransform placed = transform * gdsTransform::placement(
+                    reference, column, row);
+
+                if(child.transformed(placed).intersects(window)) {
+                    queryCell(reference.structure, placed, window, depth + 1,
+                              sink, hits);
+                }
+            }
+        }
+    }
+} // End namespace gdsfp
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSSPATIALINDEX_H_
+#define GDSSPATIALINDEX_H_
+
+#include "gdsFlattener.h"
+#include "gdsLibrary.h"
+#include <cstdint>
+#include <vector>
+
+namespace gdsfp
+{
+    struct gdsBox {
+        int left, bottom, right, top;
+
+        static gdsBox empty();
+        bool isEmpty() const;
+        void add(int x, int y);
+        void add(const gdsBox &other);
+        bool intersects(const gdsBox &other) const;
+
+        // Smallest box around the transformed corners.
+        gdsBox transformed(const gdsTransform &transform) const;
+    };
+
+    // A shape of the library that lies in the window, with the transform
+    // that places it in the queried structure.
+    struct gdsWindowHit {
+        const gdsLayer *layer;
+        const gdsShape *shape;
+        uint32_t structure;             // Where the shape is defined.
+        gdsTransform transform;
+    };
+
+    class gdsWindowSink
+    {
+    public:
+        virtual ~gdsWindowSink() {};
+        virtual void onWindowShape(const gdsWindowHit &hit) = 0;
+    };
+
+    /*
+     *  Window queries on a gdsLibrary without flattening it.  build()
+     *  computes the bounding box of every structure once, bottom-up, so a
+     *  structure placed a million times is measured once, and packs the
+     *  shapes and references of each structure into a static R-tree with
+     *  a fan-out of 16, sorted along a Hilbert curve.
+     *
+     *  A query walks the tree of the structure, and for each reference
+     *  that overlaps the window descends into the referenced structure with
+     *  the window mapped into its coordinates.  The instances of an AREF
+     *  with an axis-aligned lattice are narrowed down to the columns and
+     *  rows that can overlap, so big arrays cost nothing outside the
+     *  window.  A shape is reported when its transformed bounding box
+     *  overlaps the window; PATH boxes are grown by half the width.
+     */
+    class gdsSpatialIndex
+    {
+    public:
+        explicit gdsSpatialIndex(const gdsLibrary &library);
+
+        void build();
+
+        const gdsBox &structureBox(uint32_t structure) const;
+
+        // Reports the shapes below structure that overlap window, given in
+        // the coordinates of structure, and returns how many there were.
+        unsigned long long query(uint32_t structure, const gdsBox &window,
+                                 gdsWindowSink *sink) const;
+
+    private:
+        struct item {
+            gdsBox box;
+            uint32_t index;             // Shape of the layer, or reference.
+            uint32_t layer;             // Layer index, GDS_NONE for refs.
+        };
+
+        struct node {
+            gdsBox box;
+            uint32_t first;             // First child node or item.
+            uint32_t count;
+            bool leaf;                  // Children are items.
+        };
+
+        struct cell {
+            uint32_t firstItem;
+            uint32_t itemCount;
+            uint32_t root;              // GDS_NONE for an empty structure.
+        };
+
+        const gdsBox &computeBox(uint32_t structure,
+                                 std::vector<unsigned char> *state);
+        gdsBox referenceBox(const gdsReference &reference) const;
+        void buildTree(uint32_t structure);
+        void queryCell(uint32_t structure, const gdsTransform &transform,
+                       const gdsBox &window, unsigned int depth,
+                       gdsWindowSink *sink, unsigned long long *hits) const;
+        void queryReference(const gdsReference &reference,
+                            const gdsTransform &transform,
+                            const gdsBox &window, unsigned int depth,
+                            gdsWindowSink *sink,
+                            unsigned long long *hits) const;
+
+        const gdsLibrary &library;
+        std::vector<gdsBox> boxes;
+        std::vector<cell> cells;
+        std::vector<item> items;
+        std::vector<node> nodes;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSSPATIALINDEX_H_
@@ -0,0 +1,366 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsStructureHash.h"
+#include "gdsCalmaRecords.h"
+#include "gdsHierarchyOrder.h"
+#include <cstring>
+
+namespace gdsfp
+{
+    static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    static const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    // Folded in for an SNAME that closes a cycle.
+    static const uint64_t CYCLE = 0x6379636c65ULL;
+    // Seed of the hash of an SNAME no structure is defined for.
+    static const uint64_t UNDEFINED_SEED = 0x756e646566ULL;
+
+    static inline uint64_t rotate(uint64_t value, int bits)
+    {
+        return (value<<bits) | (value>>(64 - bits));
+    }
+
+    // XXH64 reads little endian words; the shifts compile to plain loads.
+    static inline uint64_t read64(const unsigned char *p)
+    {
+        return (uint64_t)p[0] | ((uint64_t)p[1]<<8) | ((uint64_t)p[2]<<16) |
+               ((uint64_t)p[3]<<24) | ((uint64_t)p[4]<<32) |
+               ((uint64_t)p[5]<<40) | ((uint64_t)p[6]<<48) |
+               ((uint64_t)p[7]<<56);
+    }
+
+    static inline uint64_t read32(const unsigned char *p)
+    {
+        return (uint64_t)p[0] | ((uint64_t)p[1]<<8) | ((uint64_t)p[2]<<16) |
+               ((uint64_t)p[3]<<24);
+    }
+
+    static inline uint64_t round(uint64_t lane, uint64_t input)
+    {
+        lane += input * PRIME2;
+        lane = rotate(lane, 31);
+        return lane * PRIME1;
+    }
+
+    static inline uint64_t merge(uint64_t hash, uint64_t lane)
+    {
+        hash ^= round(0, lane);
+        return hash * PRIME1 + PRIME4;
+    }
+
+    // Runs whole 32 byte stripes and returns the bytes used.
+    static size_t stripes(uint64_t lanes[4], const unsigned char *p,
+                          size_t length)
+    {
+        const unsigned char *start = p;
+        const unsigned char *end = p + (length & ~(size_t)31);
+        uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+
+        for(; p<end; p+=32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+
+        lanes[0] = v1;
+        lanes[1] = v2;
+        lanes[2] = v3;
+        lanes[3] = v4;
+        return p - start;
+    }
+
+    gdsHash64::gdsHash64(uint64_t seed) : seed(seed), total(0), fill(0)
+    {
+        lanes[0] = seed + PRIME1 + PRIME2;
+        lanes[1] = seed + PRIME2;
+        lanes[2] = seed;
+        lanes[3] = seed - PRIME1;
+    }
+
+    void gdsHash64::update(const void *data, size_t length)
+    {
+        const unsigned char *p = (const unsigned char *)data;
+        total += length;
+
+        if(fill>0) {
+            size_t take = 32 - fill;
+
+            if(length<take) {
+                memcpy(stripe + fill, p, length);
+                fill += length;
+                return;
+            }
+
+            memcpy(stripe + fill, p, take);
+            stripes(lanes, stripe, 32);
+            p += take;
+            length -= take;
+            fill = 0;
+        }
+
+        size_t used = stripes(lanes, p, length);
+        memcpy(stripe, p + used, length - used);
+        fill = length - used;
+    }
+
+    uint64_t gdsHash64::digest() const
+    {
+        uint64_t h;
+
+        if(total>=32) {
+            h = rotate(lanes[0], 1) + rotate(lanes[1], 7) +
+                rotate(lanes[2], 12) + rotate(lanes[3], 18);
+            h = merge(h, lanes[0]);
+            h = merge(h, lanes[1]);
+            h = merge(h, lanes[2]);
+            h = merge(h, lanes[3]);
+        } else {
+            h = seed + PRIME5;
+        }
+
+        h += total;
+
+        const unsigned char *p = stripe;
+        const unsigned char *end = stripe + fill;
+
+        for(; p + 8<=end; p+=8) {
+            h ^= round(0, read64(p));
+            h = rotate(h, 27) * PRIME1 + PRIME4;
+        }
+
+        if(p + 4<=end) {
+            h ^= read32(p) * PRIME1;
+            h = rotate(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+
+        for(; p<end; ++p) {
+            h ^= (*p) * PRIME5;
+            h = rotate(h, 11) * PRIME1;
+        }
+
+        h ^= h>>33;
+        h *= PRIME2;
+        h ^= h>>29;
+        h *= PRIME3;
+        h ^= h>>32;
+        return h;
+    }
+
+    uint64_t gdsHash64::hash(const void *data, size_t length, uint64_t seed)
+    {
+        gdsHash64 state(seed);
+        state.update(data, length);
+        return state.digest();
+    }
+
+    // Hashes are folded in as little endian bytes so that they don't depend
+    // on the byte order of the machine.
+    static void update64(gdsHash64 *state, uint64_t value)
+    {
+        unsigned char bytes[8];
+
+        for(int i=0; i<8; ++i) {
+            bytes[i] = (unsigned char)(value>>(8*i));
+        }
+
+        state->update(bytes, 8);
+    }
+
+    gdsStructureHasher::gdsStructureHasher()
+    {
+    }
+
+    int gdsStructureHasher::hash(const char *filePath)
+    {
+        gdsRecordReader reader;
+        found.clear();
+
+        if(reader.open(filePath)!=0) {
+            return 1;
+        }
+
+        return run(&reader);
+    }
+
+    int gdsStructureHasher::hash(int fd)
+    {
+        gdsRecordReader reader;
+        found.clear();
+
+        if(reader.open(fd)!=0) {
+            return 1;
+        }
+
+        return run(&reader);
+    }
+
+    int gdsStructureHasher::hash(const void *data, size_t size)
+    {
+        gdsRecordReader reader;
+        found.clear();
+        reader.open(data, size);
+        return run(&reader);
+    }
+
+    const std::vector<gdsStructureHash> &gdsStructureHasher::structures() const
+    {
+        return found;
+    }
+
+    const gdsStructureHash *gdsStructureHasher::find(
+        const std::string &name) const
+    {
+        unsigned int id;
+
+        if(names.find(name, &id)!=0 || definitions[id]<0) {
+            return NULL;
+        }
+
+        return &found[definitions[id]];
+    }
+
+    // Strings are padded with a NUL to an even length.
+    static std::string_view nameOf(const gdsRecord &record)
+    {
+        return std::string_view((const char *)record.data,
+                                strnlen((const char *)record.data,
+                                        record.length));
+    }
+
+    int gdsStructureHasher::run(gdsRecordReader *reader)
+    {
+        names.clear();
+        definitions.clear();
+        children.clear();
+        childStarts.clear();
+
+        // The structure that last referenced a name id, plus one, so that
+        // each child is listed once per structure.
+        std::vector<size_t> lastParent;
+        gdsHash64 state;
+        bool inStructure = false;
+        gdsRecord record;
+        int status;
+
+        while((status = reader->next(&record))>0) {
+            if(record.recordType==BGNSTR) {
+                gdsStructureHash entry = { std::string(), 0, 0,
+                                           record.offset, false };
+                found.push_back(entry);
+                childStarts.push_back(children.size());
+                state = gdsHash64();
+                inStructure = true;
+                continue;
+            }
+
+            if(!inStructure) {
+                continue;
+            }
+
+            // The header is in front of the payload, mapped or buffered.
+            state.update(record.data - 4, record.length + 4);
+
+            if(record.recordType==STRNAME) {
+                std::string_view name = nameOf(record);
+                unsigned int id = names.intern(name);
+
+                if(id>=definitions.size()) {
+                    definitions.resize(id + 1, -1);
+                }
+
+                definitions[id] = found.size() - 1;
+                found.back().name.assign(name.data(), name.size());
+            } else if(record.recordType==SNAME) {
+                unsigned int id = names.intern(nameOf(record));
+
+                if(id>=lastParent.size()) {
+                    lastParent.resize(id + 1, 0);
+                }
+
+                if(lastParent[id]!=found.size()) {
+                    lastParent[id] = found.size();
+                    children.push_back(id);
+                }
+            } else if(record.recordType==ENDSTR) {
+                found.back().content = state.digest();
+                inStructure = false;
+            }
+        }
+
+        childStarts.push_back(children.size());
+        definitions.resize(names.size(), -1);
+
+        if(status<0 || inStructure) {
+            return 1;
+        }
+
+        resolve();
+        return 0;
+    }
+
+    // Children before their parents.
+    void gdsStructureHasher::resolve()
+    {
+        std::vector<int64_t> targets(children.size());
+        std::vector<size_t> order, rank;
+        std::vector<bool> cyclic;
+
+        for(size_t i=0; i<children.size(); ++i) {
+            targets[i] = definitions[children[i]];
+        }
+
+        orderHierarchy(childStarts, targets, &order, &rank, &cyclic);
+
+        for(size_t o=0; o<order.size(); ++o) {
+            size_t s = order[o];
+            gdsHash64 fold;
+            update64(&fold, found[s].content);
+
+            for(size_t i=childStarts[s]; i<childStarts[s + 1]; ++i) {
+                int64_t child = targets[i];
+
+                if(child<0) {
+                    std::string_view name = names.name(children[i]);
+                    update64(&fold, gdsHash64::hash(name.data(), name.size(),
+                                                    UNDEFINED_SEED));
+                } else if(rank[child]<o) {
+                    update64(&fold, found[child].hierarchy);
+                } else {
+                    update64(&fold, CYCLE);
+                }
+            }
+
+            found[s].hierarchy = fold.digest();
+            found[s].cyclic = cyclic[s];
+        }
+    }
+
+} // End namespace gdsfp
@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSSTRUCTUREHASH_H_
+#define GDSSTRUCTUREHASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gdsNameTable.h"
+#include "gdsRecordReader.h"
+
+namespace gdsfp
+{
+    /*
+     *  Streaming XXH64.  The digest is the same as the reference
+     *  implementation's for the same bytes and seed, whatever the size of
+     *  the pieces passed to update().
+     */
+    class gdsHash64
+    {
+    public:
+        explicit gdsHash64(uint64_t seed = 0);
+
+        void update(const void *data, size_t length);
+        uint64_t digest() const;
+
+        static uint64_t hash(const void *data, size_t length,
+                             uint64_t seed = 0);
+
+    private:
+        uint64_t lanes[4];
+        uint64_t seed;
+        unsigned long long total;
+        unsigned char stripe[32];
+        unsigned int fill;
+    };
+
+    struct gdsStructureHash {
+        std::string name;
+        uint64_t content;               // Of its own records.
+        uint64_t hierarchy;             // Including everything it references.
+        unsigned long long offset;      // Of its BGNSTR record.
+        bool cyclic;                    // References itself, maybe indirectly.
+    };
+
+    /*
+     *  Hashes every structure of a GDSII stream in one pass over its
+     *  records, so two revisions of a layout can be compared cell by cell.
+     *
+     *  The content hash covers the records from STRNAME to ENDSTR as they
+     *  are in the file, headers included; only the BGNSTR timestamps are
+     *  left out, so saving an unchanged cell again keeps its hash.  The
+     *  hierarchy hash of a structure folds the hierarchy hashes of the
+     *  structures its SNAMEs name, in the order of their first reference,
+     *  into its content hash.  Two structures with the same hierarchy hash
+     *  flatten to the same geometry, so the whole subtree under them can
+     *  be skipped.  A reference to a structure the file doesn't define
+     *  only folds in the name; references that close a cycle fold in a
+     *  fixed value, and the structures on the cycle are marked cyclic.
+     *
+     *  When a name is defined more than once the last definition is the
+     *  one references resolve to.
+     */
+    class gdsStructureHasher
+    {
+    public:
+        gdsStructureHasher();
+
+        // Return 0 on success and 1 when the stream can not be read or is
+        // malformed.
+        int hash(const char *filePath);
+        int hash(int fd);
+        int hash(const void *data, size_t size);
+
+        // In file order.
+        const std::vector<gdsStructureHash> &structures() const;
+        // NULL when the stream defines no structure of that name.
+        const gdsStructureHash *find(const std::string &name) const;
+
+    private:
+        gdsStructureHasher(const gdsStructureHasher &);
+        gdsStructureHasher &operator=(const gdsStructureHasher &);
+
+        int run(gdsRecordReader *reader);
+        void resolve();
+
+        std::vector<gdsStructureHash> found;
+        gdsNameTable names;
+        std::vector<int64_t> definitions;       // By name id, -1 if none.
+        std::vector<uint32_t> children;         // Name ids, per structure.
+        std::vector<size_t> childStarts;        // One past the end at the end.
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSSTRUCTUREHASH_H_
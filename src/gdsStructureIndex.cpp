@@ -0,0 +1,315 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsStructureIndex.h"
+#include "gdsCalmaRecords.h"
+#include "gdsRecordReader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace gdsfp
+{
+    static const char *INDEX_MAGIC = "gdsFileParser-index 1";
+
+    // Same character filter as gdsFileParser::readString().
+    static void readName(const gdsRecord &record, string *name)
+    {
+        name->clear();
+
+        for(unsigned int i=0; i<record.length; ++i) {
+            if(record.data[i]<32||record.data[i]>127) {
+                continue;
+            }
+
+            (*name)+=(char)record.data[i];
+        }
+    }
+
+    static int fileStamp(const char *filePath, unsigned long long *size,
+                         long long *time, long *nsec)
+    {
+        struct stat info;
+
+        if(stat(filePath, &info)!=0) {
+            return 1;
+        }
+
+        (*size) = info.st_size;
+        (*time) = info.st_mtim.tv_sec;
+        (*nsec) = info.st_mtim.tv_nsec;
+        return 0;
+    }
+
+    gdsStructureIndex::gdsStructureIndex()
+        : fileSize(0), fileTime(0), fileTimeNsec(0), header(0)
+    {
+    }
+
+    void gdsStructureIndex::clear()
+    {
+        entries.clear();
+        lookup.clear();
+        fileSize = 0;
+        fileTime = 0;
+        fileTimeNsec = 0;
+        header = 0;
+    }
+
+    void gdsStructureIndex::addLookup(size_t entry)
+    {
+        lookup[entries[entry].name] = entry;
+    }
+
+    int gdsStructureIndex::build(const char *filePath)
+    {
+        clear();
+        gdsRecordReader reader;
+
+        if(reader.open(filePath)!=0 ||
+           fileStamp(filePath, &fileSize, &fileTime, &fileTimeNsec)!=0) {
+            return 1;
+        }
+
+        gdsRecord record;
+        gdsStructureEntry *current = NULL;
+        unordered_set<string> seen;
+        string name;
+        bool inHeader = true;
+        int status;
+
+        while((status = reader.next(&record))>0) {
+            unsigned long long end = record.offset + record.length + 4;
+
+            if(inHeader && record.recordType!=BGNSTR) {
+                header = end;
+            }
+
+            switch(record.recordType) {
+                case BGNSTR:
+                    inHeader = false;
+                    entries.push_back(gdsStructureEntry());
+                    current = &entries.back();
+                    current->offset = record.offset;
+                    current->length = 0;
+                    seen.clear();
+                    break;
+
+                case STRNAME:
+                    if(current!=NULL) {
+                        readName(record, &current->name);
+                    }
+
+                    break;
+
+                case SNAME:
+                    if(current!=NULL) {
+                        readName(record, &name);
+
+                        if(seen.insert(name).second) {
+                            current->references.push_back(name);
+                        }
+                    }
+
+                    break;
+
+                case ENDSTR:
+                    if(current!=NULL) {
+                        current->length = end - current->offset;
+                        addLookup(entries.size() - 1);
+                        current = NULL;
+                    }
+
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        if(status<0 || current!=NULL) {
+            return 1;   // Malformed or truncated file.
+        }
+
+        return 0;
+    }
+
+    int gdsStructureIndex::save(const char *indexPath) const
+    {
+        // A unique name next to the index, so that processes saving the
+        // same index at once do not write into each other's file.
+        string partial = string(indexPath) + ".XXXXXX";
+        int fd = mkstemp(&partial[0]);
+
+        if(fd<0) {
+            return 1;
+        }
+
+        fchmod(fd, 0644);
+        FILE *file = fdopen(fd, "w");
+
+        if(file==NULL) {
+            close(fd);
+            unlink(partial.c_str());
+            return 1;
+        }
+
+        fprintf(file, "%s\n%llu %lld %ld %llu %zu\n", INDEX_MAGIC, fileSize,
+                fileTime, fileTimeNsec, header, entries.size());
+
+        for(size_t i=0; i<entries.size(); ++i) {
+            const gdsStructureEntry &entry = entries[i];
+            fprintf(file, "S %llu %llu %zu %s\n", entry.offset, entry.length,
+                    entry.references.size(), entry.name.c_str());
+
+            for(size_t j=0; j<entry.references.size(); ++j) {
+                fprintf(file, "R %s\n", entry.references[j].c_str());
+            }
+        }
+
+        int status = ferror(file)!=0;
+        status |= fclose(file)!=0;
+
+        if(status!=0 || rename(partial.c_str(), indexPath)!=0) {
+            unlink(partial.c_str());
+            return 1;
+        }
+
+        return 0;
+    }
+
+    int gdsStructureIndex::load(const char *indexPath, const char *filePath)
+    {
+        clear();
+        unsigned long long size;
+        long long time;
+        long nsec;
+
+        if(fileStamp(filePath, &size, &time, &nsec)!=0) {
+            return 1;
+        }
+
+        std::ifstream file(indexPath);
+        string line;
+        size_t count = 0;
+
+        if(!getline(file, line) || line!=INDEX_MAGIC || !getline(file, line) ||
+           sscanf(line.c_str(), "%llu %lld %ld %llu %zu", &fileSize, &fileTime,
+                  &fileTimeNsec, &header, &count)!=5) {
+            clear();
+            return 1;
+        }
+
+        if(fileSize!=size || fileTime!=time || fileTimeNsec!=nsec) {
+            clear();
+            return 1;   // The GDSII file changed since the index was saved.
+        }
+
+        entries.resize(count);
+
+        for(size_t i=0; i<count; ++i) {
+            gdsStructureEntry &entry = entries[i];
+            size_t references = 0;
+            int nameStart = 0;
+
+            // The name follows a single space and may itself start with
+            // spaces, so it is not left to sscanf().
+            if(!getline(file, line) ||
+               sscanf(line.c_str(), "S %llu %llu %zu%n", &entry.offset,
+                      &entry.length, &references, &nameStart)!=3 ||
+               line.compare(nameStart, 1, " ")!=0) {
+                clear();
+                return 1;
+            }
+
+            entry.name = line.substr(nameStart + 1);
+            entry.references.resize(references);
+
+            for(size_t j=0; j<references; ++j) {
+                if(!getline(file, line) || line.compare(0, 2, "R ")!=0) {
+                    clear();
+                    return 1;
+                }
+
+                entry.references[j] = line.substr(2);
+            }
+
+            addLookup(i);
+        }
+
+        return 0;
+    }
+
+    int gdsStructureIndex::open(const char *filePath, bool keep)
+    {
+        string indexPath = sidecarPath(filePath);
+
+        if(load(indexPath.c_str(), filePath)==0) {
+            return 0;
+        }
+
+        bool stale = access(indexPath.c_str(), F_OK)==0;
+
+        if(build(filePath)!=0) {
+            return 1;
+        }
+
+        if(keep || stale) {
+            save(indexPath.c_str());    // A read-only directory is not an error.
+        }
+
+        return 0;
+    }
+
+    const gdsStructureEntry *gdsStructureIndex::find(const char *name) const
+    {
+        unordered_map<string, size_t>::const_iterator it = lookup.find(name);
+
+        if(it==lookup.end()) {
+            return NULL;
+        }
+
+        return &entries[it->second];
+    }
+
+    const vector<gdsStructureEntry> &gdsStructureIndex::structures() const
+    {
+        return entries;
+    }
+
+    unsigned long long gdsStructureIndex::headerLength() const
+    {
+        return header;
+    }
+
+    string gdsStructureIndex::sidecarPath(const char *filePath)
+    {
+        return string(filePath) + ".gdsidx";
+    }
+} // End namespace gdsfp
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSSTRUCTUREINDEX_H_
+#define GDSSTRUCTUREINDEX_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gdsfp
+{
+    /*
+     *  Location of one structure in a GDSII file.  The byte range starts at
+     *  the BGNSTR record and ends after the ENDSTR record.
+     */
+    struct gdsStructureEntry {
+        std::string name;
+        unsigned long long offset;
+        unsigned long long length;
+        std::vector<std::string> references;    // Distinct SNAMEs, in order.
+    };
+
+    /*
+     *  Offsets of every structure in a GDSII file.  Building the index only
+     *  looks at record headers and the STRNAME and SNAME records, everything
+     *  else is skipped by its record length.  The index can be kept next to
+     *  the GDSII file and is only reused while the file size and
+     *  modification time still match.  It is written under a unique
+     *  temporary name and renamed into place, so a reader never sees half
+     *  of it, not even while several processes save it at once.
+     */
+    class gdsStructureIndex
+    {
+    public:
+        gdsStructureIndex();
+
+        int build(const char *filePath);
+        int save(const char *indexPath) const;
+        int load(const char *indexPath, const char *filePath);
+
+        // Loads the sidecar index of the file, or builds the index when the
+        // sidecar is missing or out of date.  The sidecar is only written
+        // with keep, or to bring an existing one up to date.
+        int open(const char *filePath, bool keep = false);
+
+        const gdsStructureEntry *find(const char *name) const;
+        const std::vector<gdsStructureEntry> &structures() const;
+
+        // Offset of the first BGNSTR, everything before it is the library
+        // header (HEADER, BGNLIB, LIBNAME, UNITS, ...).
+        unsigned long long headerLength() const;
+
+        static std::string sidecarPath(const char *filePath);
+
+    private:
+        void clear();
+        void addLookup(size_t entry);
+
+        std::vector<gdsStructureEntry> entries;
+        std::unordered_map<std::string, size_t> lookup;
+        unsigned long long fileSize;
+        long long fileTime;
+        long fileTimeNsec;
+        unsigned long long header;
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSSTRUCTUREINDEX_H_
@@ -0,0 +1,626 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "gdsValidator.h"
+#include "gdsCalmaRecords.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace gdsfp
+{
+    static const unsigned char UNDEFINED = 0xff;
+    static const int ANY_LENGTH = -1;
+
+    struct recordRule {
+        unsigned char dataType;
+        int length;                     // Of the payload, or ANY_LENGTH.
+    };
+
+    // Indexed by record type, up to LIBSECUR.
+    static const recordRule rules[] = {
+        { INTEGER_2, 2 },           // HEADER
+        { INTEGER_2, 24 },          // BGNLIB
+        { ASCII_STRING, ANY_LENGTH },   // LIBNAME
+        { REAL_8, 16 },             // UNITS
+        { NO_DATA, 0 },             // ENDLIB
+        { INTEGER_2, 24 },          // BGNSTR
+        { ASCII_STRING, ANY_LENGTH },   // STRNAME
+        { NO_DATA, 0 },             // ENDSTR
+        { NO_DATA, 0 },             // BOUNDARY
+        { NO_DATA, 0 },             // PATH
+        { NO_DATA, 0 },             // SREF
+        { NO_DATA, 0 },             // AREF
+        { NO_DATA, 0 },             // TEXT
+        { INTEGER_2, 2 },           // LAYER
+        { INTEGER_2, 2 },           // DATATYPE
+        { INTEGER_4, 4 },           // WIDTH
+        { INTEGER_4, ANY_LENGTH },  // XY
+        { NO_DATA, 0 },             // ENDEL
+        { ASCII_STRING, ANY_LENGTH },   // SNAME
+        { INTEGER_2, 4 },           // COLROW
+        { NO_DATA, 0 },             // TEXTNODE
+        { NO_DATA, 0 },             // NODE
+        { INTEGER_2, 2 },           // TEXTTYPE
+        { BIT_ARRAY, 2 },           // PRESENTATION
+        { UNDEFINED, ANY_LENGTH },  // SPACING
+        { ASCII_STRING, ANY_LENGTH },   // STRING
+        { BIT_ARRAY, 2 },           // STRANS
+        { REAL_8, 8 },              // MAG
+        { REAL_8, 8 },              // ANGLE
+        { UNDEFINED, ANY_LENGTH },  // UINTEGER
+        { UNDEFINED, ANY_LENGTH },  // USTRING
+        { ASCII_STRING, ANY_LENGTH },   // REFLIBS
+        { ASCII_STRING, ANY_LENGTH },   // FONTS
+        { INTEGER_2, 2 },           // PATHTYPE
+        { INTEGER_2, 2 },           // GENERATIONS
+        { ASCII_STRING, ANY_LENGTH },   // ATTRTABLE
+        { ASCII_STRING, ANY_LENGTH },   // STYPTABLE
+        { INTEGER_2, 2 },           // STRTYPE
+        { BIT_ARRAY, 2 },           // ELFLAGS
+        { INTEGER_4, 4 },           // ELKEY
+        { UNDEFINED, ANY_LENGTH },  // LINKTYPE
+        { UNDEFINED, ANY_LENGTH },  // LINKKEYS
+        { INTEGER_2, 2 },           // NODETYPE
+        { INTEGER_2, 2 },           // PROPATTR
+        { ASCII_STRING, ANY_LENGTH },   // PROPVALUE
+        { NO_DATA, 0 },             // BOX
+        { INTEGER_2, 2 },           // BOXTYPE
+        { INTEGER_4, 4 },           // PLEX
+        { INTEGER_4, 4 },           // BGNEXTN
+        { INTEGER_4, 4 },           // ENDEXTN
+        { INTEGER_2, 2 },           // TAPENUM
+        { INTEGER_2, 12 },          // TAPECODE
+        { BIT_ARRAY, 2 },           // STRCLASS
+        { INTEGER_4, ANY_LENGTH },  // RESERVED
+        { INTEGER_2, 2 },           // FORMAT
+        { ASCII_STRING, ANY_LENGTH },   // MASK
+        { NO_DATA, 0 },             // ENDMASKS
+        { INTEGER_2, 2 },           // LIBDIRSIZE
+        { ASCII_STRING, ANY_LENGTH },   // SRFNAME
+        { INTEGER_2, ANY_LENGTH }   // LIBSECUR
+    };
+
+    static const unsigned int RULE_COUNT = sizeof(rules) / sizeof(rules[0]);
+
+    static unsigned long long bit(unsigned char type)
+    {
+        return 1ULL<<type;
+    }
+
+    // Discontinued or never released record types.
+    static const unsigned long long UNSUPPORTED =
+        bit(TEXTNODE) | bit(SPACING) | bit(UINTEGER) | bit(USTRING) |
+        bit(STYPTABLE) | bit(STRTYPE) | bit(ELKEY) | bit(LINKTYPE) |
+        bit(LINKKEYS) | bit(RESERVED);
+
+    // Records between BGNLIB and UNITS.  Only MASK may repeat.
+    static const unsigned long long LIBRARY_HEADER =
+        bit(LIBDIRSIZE) | bit(SRFNAME) | bit(LIBSECUR) | bit(LIBNAME) |
+        bit(REFLIBS) | bit(FONTS) | bit(ATTRTABLE) | bit(GENERATIONS) |
+        bit(FORMAT) | bit(MASK) | bit(ENDMASKS) | bit(TAPENUM) |
+        bit(TAPECODE);
+
+    static const unsigned long long ELEMENT_COMMON =
+        bit(ELFLAGS) | bit(PLEX) | bit(XY) | bit(PROPATTR) | bit(PROPVALUE);
+
+    static const unsigned long long TRANSFORM =
+        bit(STRANS) | bit(MAG) | bit(ANGLE);
+
+    static unsigned long long allowedRecords(unsigned char element)
+    {
+        switch(element) {
+            case BOUNDARY:
+                return ELEMENT_COMMON | bit(LAYER) | bit(DATATYPE);
+            case PATH:
+                return ELEMENT_COMMON | bit(LAYER) | bit(DATATYPE) |
+                       bit(PATHTYPE) | bit(WIDTH) | bit(BGNEXTN) |
+                       bit(ENDEXTN);
+            case SREF:
+                return ELEMENT_COMMON | bit(SNAME) | TRANSFORM;
+            case AREF:
+                return ELEMENT_COMMON | bit(SNAME) | TRANSFORM | bit(COLROW);
+            case TEXT:
+                return ELEMENT_COMMON | bit(LAYER) | bit(TEXTTYPE) |
+                       bit(PRESENTATION) | bit(PATHTYPE) | bit(WIDTH) |
+                       TRANSFORM | bit(STRING);
+            case NODE:
+                return ELEMENT_COMMON | bit(LAYER) | bit(NODETYPE);
+            default:
+                return ELEMENT_COMMON | bit(LAYER) | bit(BOXTYPE);
+        }
+    }
+
+    static unsigned long long requiredRecords(unsigned char element)
+    {
+        switch(element) {
+            case BOUNDARY:
+            case PATH:      return bit(LAYER) | bit(DATATYPE) | bit(XY);
+            case SREF:      return bit(SNAME) | bit(XY);
+            case AREF:      return bit(SNAME) | bit(COLROW) | bit(XY);
+            case TEXT:
+                return bit(LAYER) | bit(TEXTTYPE) | bit(XY) | bit(STRING);
+            case NODE:      return bit(LAYER) | bit(NODETYPE) | bit(XY);
+            default:        return bit(LAYER) | bit(BOXTYPE) | bit(XY);
+        }
+    }
+
+    static bool isElementStart(unsigned char type)
+    {
+        return type==BOUNDARY || type==PATH || type==SREF || type==AREF ||
+               type==TEXT || type==NODE || type==BOX;
+    }
+
+    static const char *dataTypeName(unsigned char dataType)
+    {
+        static const char *const names[] = {
+            "NO_DATA", "BIT_ARRAY", "INTEGER_2", "INTEGER_4", "REAL_4",
+            "REAL_8", "ASCII_STRING"
+        };
+
+        return dataType<7 ? names[dataType] : "an unknown data type";
+    }
+
+    gdsValidator::gdsValidator()
+        : limit(0)
+    {
+    }
+
+    int gdsValidator::validate(const char *filePath)
+    {
+        gdsRecordReader reader;
+        found.clear();
+
+        if(reader.open(filePath)!=0) {
+            error(0, "the file can not be read");
+            return 1;
+        }
+
+        return run(&reader);
+    }
+
+    int gdsValidator::validate(int fd)
+    {
+        gdsRecordReader reader;
+        found.clear();
+
+        if(reader.open(fd)!=0) {
+            error(0, "the stream can not be read");
+            return 1;
+        }
+
+        return run(&reader);
+    }
+
+    int gdsValidator::validate(const void *data, size_t size)
+    {
+        gdsRecordReader reader;
+        found.clear();
+        reader.open(data, size);
+        return run(&reader);
+    }
+
+    const std::vector<gdsValidationError> &gdsValidator::errors() const
+    {
+        return found;
+    }
+
+    void gdsValidator::setErrorLimit(size_t limit)
+    {
+        this->limit = limit;
+    }
+
+    void gdsValidator::error(unsigned long long offset,
+                             const std::string &message)
+    {
+        if(limit==0 || found.size()<limit) {
+            gdsValidationError entry = { offset, message };
+            found.push_back(entry);
+        }
+    }
+
+    // Strings are padded with a NUL to an even length.
+    size_t gdsValidator::nameLength(const gdsRecord &record)
+    {
+        return strnlen((const char *)record.data, record.length);
+    }
+
+    void gdsValidator::addName(const gdsRecord &record, bool definition)
+    {
+        std::string_view name((const char *)record.data, nameLength(record));
+        unsigned int id = names.intern(name);
+
+        if(id==defined.size()) {
+            defined.push_back(false);
+            referenced.push_back(false);
+            references.push_back(0);
+        }
+
+        if(!definition) {
+            if(!referenced[id]) {
+                referenced[id] = true;
+                references[id] = record.offset;
+            }
+        } else if(defined[id]) {
+            error(record.offset, "second structure named " +
+                  std::string(name));
+        } else {
+            defined[id] = true;
+        }
+    }
+
+    std::string gdsValidator::typeName(unsigned char type)
+    {
+        const char *known = recordTypeName(type);
+
+        if(known!=NULL) {
+            return known;
+        }
+
+        char unknown[8];
+        snprintf(unknown, sizeof(unknown), "0x%02x", type);
+        return unknown;
+    }
+
+    int gdsValidator::run(gdsRecordReader *reader)
+    {
+        current = EXPECT_HEADER;
+        libraryRecords = 0;
+        element = 0;
+        elementOffset = 0;
+        elementRecords = 0;
+        previous = UNDEFINED;
+        points = 0;
+        names.clear();
+        defined.clear();
+        referenced.clear();
+        references.clear();
+
+        gdsRecord record;
+        int status;
+
+        while((status = reader->next(&record))>0) {
+            check(record);
+            previous = record.recordType;
+
+            if(limit>0 && found.size()>=limit) {
+                return 1;
+            }
+        }
+
+        if(status<0) {
+            error(record.offset, "the record header is malformed or the "
+                  "record runs past the end of the stream");
+        } else if(current!=AFTER_ENDLIB) {
+            error(record.offset, "the stream ends without ENDLIB");
+        }
+
+        for(unsigned int i=0; i<names.size(); ++i) {
+            if(referenced[i] && !defined[i]) {
+                error(references[i], "SNAME " + std::string(names.name(i)) +
+                      " names no structure");
+            }
+        }
+
+        std::stable_sort(found.begin(), found.end(),
+                         [](const gdsValidationError &a,
+                            const gdsValidationError &b) {
+                             return a.offset<b.offset;
+                         });
+        return found.empty() ? 0 : 1;
+    }
+
+    void gdsValidator::check(const gdsRecord &record)
+    {
+        unsigned char type = record.recordType;
+        unsigned long long offset = record.offset;
+
+        if(record.length & 1) {
+            error(offset, typeName(type) + " has an odd length");
+        }
+
+        if(type>=RULE_COUNT) {
+            error(offset, "unknown record type " + typeName(type));
+            return;
+        }
+
+        if(bit(type) & UNSUPPORTED) {
+            error(offset, typeName(type) + " is not part of the stream format");
+            return;
+        }
+
+        const recordRule &rule = rules[type];
+
+        if(record.dataType!=rule.dataType) {
+            error(offset, typeName(type) + " has data type " +
+                  dataTypeName(record.dataType) + " instead of " +
+                  dataTypeName(rule.dataType));
+        } else if(rule.length!=ANY_LENGTH) {
+            if(record.length!=(unsigned int)rule.length) {
+                error(offset, typeName(type) + " has " +
+                      std::to_string(record.length) + " bytes of data "
+                      "instead of " + std::to_string(rule.length));
+            }
+        } else if((rule.dataType==INTEGER_4 && record.length % 4!=0) ||
+                  (rule.dataType==REAL_8 && record.length % 8!=0) ||
+                  (type==XY && record.length % 8!=0)) {
+            error(offset, typeName(type) + " has " +
+                  std::to_string(record.length) + " bytes of data, which "
+                  "is not a whole number of values");
+        }
+
+        // The grammar.  A record out of place is reported and then taken
+        // where it most likely belongs, so one mistake gives one error.
+        switch(current) {
+            case EXPECT_HEADER:
+                if(type==HEADER) {
+                    current = EXPECT_BGNLIB;
+                    return;
+                }
+
+                error(offset, "the stream does not start with HEADER");
+                current = EXPECT_BGNLIB;
+
+                if(type!=BGNLIB) {
+                    return;
+                }
+
+                // Fall through.
+            case EXPECT_BGNLIB:
+                current = IN_LIBRARY_HEADER;
+
+                if(type!=BGNLIB) {
+                    error(offset, "HEADER is not followed by BGNLIB");
+                    break;
+                }
+
+                return;
+
+            default:
+                break;
+        }
+
+        if(current==IN_LIBRARY_HEADER) {
+            if(bit(type) & LIBRARY_HEADER) {
+                if((libraryRecords & bit(type)) && type!=MASK) {
+                    error(offset, "second " + typeName(type) +
+                          " in the library header");
+                }
+
+                libraryRecords |= bit(type);
+                return;
+            }
+
+            if(type==UNITS) {
+                if(!(libraryRecords & bit(LIBNAME))) {
+                    error(offset, "the library has no LIBNAME");
+                }
+
+                current = IN_LIBRARY;
+                return;
+            }
+
+            error(offset, "the library header has no UNITS");
+            current = IN_LIBRARY;
+        }
+
+        if(current==EXPECT_STRNAME) {
+            current = IN_STRUCTURE;
+
+            if(type==STRNAME) {
+                addName(record, true);
+                return;
+            }
+
+            error(offset, "BGNSTR is not followed by STRNAME");
+        }
+
+        if(current==IN_ELEMENT) {
+            if(type==ENDEL) {
+                endElement(record);
+                current = IN_STRUCTURE;
+                return;
+            }
+
+            if(!isElementStart(type) && type!=ENDSTR && type!=BGNSTR &&
+               type!=ENDLIB) {
+                checkElementRecord(record);
+                return;
+            }
+
+            error(elementOffset, typeName(element) + " has no ENDEL");
+            endElement(record);
+            current = IN_STRUCTURE;
+        }
+
+        if(current==IN_STRUCTURE) {
+            if(isElementStart(type)) {
+                current = IN_ELEMENT;
+                element = type;
+                elementOffset = offset;
+                elementRecords = 0;
+                points = 0;
+            } else if(type==ENDSTR) {
+                current = IN_LIBRARY;
+            } else if(type==STRCLASS && previous==STRNAME) {
+                // Allowed right after the name.
+            } else if(type==BGNSTR) {
+                error(offset, "the structure before has no ENDSTR");
+                current = EXPECT_STRNAME;
+            } else if(type==ENDLIB) {
+                error(offset, "the last structure has no ENDSTR");
+                current = AFTER_ENDLIB;
+            } else {
+                error(offset, typeName(type) + " outside of an element");
+            }
+
+            return;
+        }
+
+        if(current==IN_LIBRARY) {
+            if(type==BGNSTR) {
+                current = EXPECT_STRNAME;
+            } else if(type==ENDLIB) {
+                current = AFTER_ENDLIB;
+            } else if(isElementStart(type)) {
+                error(offset, typeName(type) + " outside of a structure");
+            } else {
+                error(offset, typeName(type) + " between structures");
+            }
+
+            return;
+        }
+
+        error(offset, typeName(type) + " after ENDLIB");
+    }
+
+    void gdsValidator::checkElementRecord(const gdsRecord &record)
+    {
+        unsigned char type = record.recordType;
+        unsigned long long offset = record.offset;
+
+        if(previous==PROPATTR && type!=PROPVALUE) {
+            error(offset, "PROPATTR is not followed by PROPVALUE");
+        }
+
+        if(!(allowedRecords(element) & bit(type))) {
+            error(offset, typeName(type) + " is not allowed in " +
+                  typeName(element));
+            return;
+        }
+
+        bool hasPoints = elementRecords & bit(XY);
+
+        switch(type) {
+            case XY:
+                if(hasPoints && previous!=XY) {
+                    error(offset, "second XY in " + typeName(element));
+                }
+
+                if(record.length>=8) {
+                    if(points==0) {
+                        memcpy(firstPoint, record.data, 8);
+                    }
+
+                    memcpy(lastPoint, record.data + record.length / 8 * 8 - 8,
+                           8);
+                }
+
+                points += record.length / 8;
+                break;
+
+            case PROPATTR:
+                if(!hasPoints) {
+                    error(offset, "PROPATTR before XY");
+                }
+
+                break;
+
+            case PROPVALUE:
+                if(previous!=PROPATTR) {
+                    error(offset, "PROPVALUE without PROPATTR");
+                }
+
+                break;
+
+            case ELFLAGS:
+            case PLEX:
+                if(elementRecords & ~(bit(ELFLAGS) | bit(PLEX))) {
+                    error(offset, typeName(type) + " must directly follow " +
+                          typeName(element));
+                } else if(elementRecords & bit(type)) {
+                    error(offset, "second " + typeName(type) + " in " +
+                          typeName(element));
+                }
+
+                break;
+
+            default:
+                if(elementRecords & bit(type)) {
+                    error(offset, "second " + typeName(type) + " in " +
+                          typeName(element));
+                } else if(hasPoints && type!=STRING) {
+                    error(offset, typeName(type) + " after XY");
+                }
+
+                if((type==MAG || type==ANGLE) &&
+                   !(elementRecords & bit(STRANS))) {
+                    error(offset, typeName(type) + " without STRANS");
+                } else if(type==SNAME) {
+                    addName(record, false);
+                } else if(type==COLROW && record.length==4) {
+                    int columns = (record.data[0]<<8) | record.data[1];
+                    int rows = (record.data[2]<<8) | record.data[3];
+
+                    if(columns<1 || columns>32767 || rows<1 || rows>32767) {
+                        error(offset, "COLROW is not 1 to 32767 columns "
+                              "and rows");
+                    }
+                }
+
+                break;
+        }
+
+        elementRecords |= bit(type);
+    }
+
+    void gdsValidator::endElement(const gdsRecord &record)
+    {
+        if(previous==PROPATTR) {
+            error(record.offset, "PROPATTR is not followed by PROPVALUE");
+        }
+
+        unsigned long long missing = requiredRecords(element) &
+                                     ~elementRecords;
+
+        for(unsigned char type=0; missing!=0; ++type, missing>>=1) {
+            if(missing & 1) {
+                error(elementOffset, typeName(element) + " has no " +
+                      typeName(type));
+            }
+        }
+
+        if(!(elementRecords & bit(XY))) {
+            return;
+        }
+
+        unsigned long long least = 1, most = 1;
+
+        switch(element) {
+            case BOUNDARY:  least = 4; most = ~0ULL;    break;
+            case PATH:      least = 2; most = ~0ULL;    break;
+            case AREF:      least = most = 3;           break;
+            case NODE:      least = 1; most = 50;       break;
+            case BOX:       least = most = 5;           break;
+        }
+
+        if(points<least || points>most) {
+            error(elementOffset, typeName(element) + " has " +
+                  std::to_string(points) + " points");
+        } else if(element==BOUNDARY && memcmp(firstPoint, lastPoint, 8)!=0) {
+            error(elementOffset, "BOUNDARY is not closed");
+        }
+    }
+} // End namespace gdsfp
@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef GDSVALIDATOR_H_
+#define GDSVALIDATOR_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "gdsNameTable.h"
+#include "gdsRecordReader.h"
+
+namespace gdsfp
+{
+    struct gdsValidationError {
+        unsigned long long offset;      // Of the offending record header.
+        std::string message;
+    };
+
+    /*
+     *  Checks a GDSII stream against the record grammar without decoding
+     *  it for callbacks:
+     *
+     *      HEADER BGNLIB <library records> LIBNAME ... UNITS
+     *          { BGNSTR STRNAME [STRCLASS] { element } ENDSTR } ENDLIB
+     *      element: BOUNDARY | PATH | SREF | AREF | TEXT | NODE | BOX,
+     *          [ELFLAGS] [PLEX], its own records, XY, [STRING],
+     *          { PROPATTR PROPVALUE }, ENDEL
+     *
+     *  Every record is also checked for an even length, the data type byte
+     *  of its record type and the payload size that type needs.  XY point
+     *  counts must suit the element (BOUNDARY at least 4 and closed, PATH
+     *  at least 2, NODE 1 to 50, BOX 5, TEXT and SREF 1, AREF 3); an element
+     *  may split its points over consecutive XY records.  SNAMEs that name
+     *  no structure of the file are reported at their first use.
+     *
+     *  All errors are collected with the byte offset of the record, except
+     *  that a record header that can not be read ends the check, since the
+     *  records after it can not be found.
+     */
+    class gdsValidator
+    {
+    public:
+        gdsValidator();
+
+        // Return 0 when the stream is valid and 1 when it is not or can not
+        // be read.
+        int validate(const char *filePath);
+        int validate(int fd);
+        int validate(const void *data, size_t size);
+
+        const std::vector<gdsValidationError> &errors() const;
+
+        // Stops collecting after this many errors, 0 (the default) keeps
+        // all of them.
+        void setErrorLimit(size_t limit);
+
+    private:
+        gdsValidator(const gdsValidator &);
+        gdsValidator &operator=(const gdsValidator &);
+
+        enum state {
+            EXPECT_HEADER,
+            EXPECT_BGNLIB,
+            IN_LIBRARY_HEADER,
+            IN_LIBRARY,
+            EXPECT_STRNAME,
+            IN_STRUCTURE,
+            IN_ELEMENT,
+            AFTER_ENDLIB
+        };
+
+        int run(gdsRecordReader *reader);
+        void check(const gdsRecord &record);
+        void checkElementRecord(const gdsRecord &record);
+        void endElement(const gdsRecord &record);
+        void error(unsigned long long offset, const std::string &message);
+        void addName(const gdsRecord &record, bool definition);
+        static size_t nameLength(const gdsRecord &record);
+        static std::string typeName(unsigned char type);
+
+        std::vector<gdsValidationError> found;
+        size_t limit;
+
+        state current;
+        unsigned long long libraryRecords;  // Bits of the header records.
+        unsigned char element;
+        unsigned long long elementOffset;
+        unsigned long long elementRecords;  // Bits seen in this element.
+        unsigned char previous;             // Record type before this one.
+        unsigned long long points;
+        unsigned char firstPoint[8];
+        unsigned char lastPoint[8];
+
+        // Structure names and SNAMEs, interned so that the lookups stay
+        // cheap on files with many structures, and what is known about
+        // each by its id.
+        gdsNameTable names;
+        std::vector<bool> defined;
+        std::vector<bool> referenced;
+        std::vector<unsigned long long> references; // First SNAME offsets.
+    };
+
+} // End namespace gdsfp
+
+#endif //GDSVALIDATOR_H_
@@ -0,0 +1,171 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "gdsXYDecoder.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GDSFP_X86 1
+#endif
+
+namespace gdsfp
+{
+    static const size_t ALIGNMENT = 64;
+
+    gdsCoordinateBuffer::gdsCoordinateBuffer()
+        : xData(NULL), yData(NULL), size(0)
+    {
+    }
+
+    gdsCoordinateBuffer::~gdsCoordinateBuffer()
+    {
+        free(xData);
+    }
+
+    void gdsCoordinateBuffer::reserve(size_t count)
+    {
+        reserve(count, 0);
+    }
+
+    void gdsCoordinateBuffer::reserve(size_t count, size_t used)
+    {
+        if(count<=size) {
+            return;
+        }
+
+        // Grow geometrically and keep a multiple of 16 points, so each array
+        // is a whole number of cache lines.
+        size_t grown = size * 2;
+
+        if(grown<count) {
+            grown = count;
+        }
+
+        grown = (grown + 15) & ~(size_t)15;
+        void *block = NULL;
+
+        if(posix_memalign(&block, ALIGNMENT, 2 * grown * sizeof(int))!=0) {
+            throw std::bad_alloc();
+        }
+
+        if(used>0) {
+            memcpy(block, xData, used * sizeof(int));
+            memcpy((int *)block + grown, yData, used * sizeof(int));
+        }
+
+        free(xData);
+        xData = (int *)block;
+        yData = xData + grown;
+        size = grown;
+    }
+
+    static void decodeXYScalar(const unsigned char *input, int *x, int *y,
+                               size_t count)
+    {
+        for(size_t i=0; i<count; ++i) {
+            uint32_t pair[2];
+            memcpy(pair, input + i * 8, sizeof(pair));
+            x[i] = (int)__builtin_bswap32(pair[0]);
+            y[i] = (int)__builtin_bswap32(pair[1]);
+        }
+    }
+
+#ifdef GDSFP_X86
+    __attribute__((target("ssse3")))
+    static void decodeXYSsse3(const unsigned char *input, int *x, int *y,
+                              size_t count)
+    {
+        // Byte swap every integer and gather the two x values of a register
+        // in the low half and the two y values in the high half.
+        const __m128i order = _mm_setr_epi8(3, 2, 1, 0, 11, 10, 9, 8,
+                                            7, 6, 5, 4, 15, 14, 13, 12);
+        size_t i = 0;
+
+        for(; i + 4<=count; i+=4) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(input + i * 8));
+            __m128i b = _mm_loadu_si128((const __m128i *)(input + i * 8 + 16));
+            a = _mm_shuffle_epi8(a, order);
+            b = _mm_shuffle_epi8(b, order);
+            _mm_storeu_si128((__m128i *)(x + i), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128((__m128i *)(y + i), _mm_unpackhi_epi64(a, b));
+        }
+
+        decodeXYScalar(input + i * 8, x + i, y + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void decodeXYAvx2(const unsigned char *input, int *x, int *y,
+                             size_t count)
+    {
+        const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                              11, 10, 9, 8, 15, 14, 13, 12,
+                                              3, 2, 1, 0, 7, 6, 5, 4,
+                                              11, 10, 9, 8, 15, 14, 13, 12);
+        const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+        size_t i = 0;
+
+        for(; i + 8<=count; i+=8) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)(input + i * 8));
+            __m256i b = _mm256_loadu_si256((const __m256i *)(input + i * 8 + 32));
+            a = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(a, swap), split);
+            b = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(b, swap), split);
+            _mm256_storeu_si256((__m256i *)(x + i),
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)(y + i),
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+
+        decodeXYScalar(input + i * 8, x + i, y + i, count - i);
+    }
+#endif
+
+    typedef void (*decodeXYFunction)(const unsigned char *, int *, int *,
+                                     size_t);
+
+    static decodeXYFunction selectDecodeXY()
+    {
+#ifdef GDSFP_X86
+        __builtin_cpu_init();
+
+        if(__builtin_cpu_supports("avx2")) {
+            return decodeXYAvx2;
+        }
+
+        if(__builtin_cpu_supports("ssse3")) {
+            return decodeXYSsse3;
+        }
+#endif
+        return decodeXYScalar;
+    }
+
+    void decodeXY(const unsigned char *input, int *x, int *y, size_t count)
+    {
+        static const decodeXYFunction best = selectDecodeXY();
+        best(input, x, y, count);
+    }
+} // End namespace gdsfp
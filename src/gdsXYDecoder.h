@@ -0,0 +1,85 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2017 EDDR Software, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GDSXYDECODER_H_
+#define GDSXYDECODER_H_
+
+#include <cstddef>
+
+namespace gdsfp
+{
+    /*
+     *  Growable structure-of-arrays coordinate buffer.  Both arrays start on
+     *  a 64 byte boundary and the memory is kept between records, so once it
+     *  has grown to the largest XY record of a file no more allocation
+     *  happens.
+     */
+    class gdsCoordinateBuffer
+    {
+    public:
+        gdsCoordinateBuffer();
+        ~gdsCoordinateBuffer();
+
+        void reserve(size_t count);
+        // As reserve(), but the first used points survive a reallocation.
+        void reserve(size_t count, size_t used);
+        int *x() const;
+        int *y() const;
+        size_t capacity() const;
+
+    private:
+        gdsCoordinateBuffer(const gdsCoordinateBuffer &);
+        gdsCoordinateBuffer &operator=(const gdsCoordinateBuffer &);
+
+        int *xData;
+        int *yData;
+        size_t size;
+    };
+
+    // Inline, as the parser asks for them once per XY record.
+    inline int *gdsCoordinateBuffer::x() const
+    {
+        return xData;
+    }
+
+    inline int *gdsCoordinateBuffer::y() const
+    {
+        return yData;
+    }
+
+    inline size_t gdsCoordinateBuffer::capacity() const
+    {
+        return size;
+    }
+
+    /*
+     *  Byte swaps and deinterleaves count big-endian INTEGER_4 (x, y) pairs.
+     *  Uses AVX2 or SSSE3 when the CPU has them, which is checked once at
+     *  run time, and plain C++ otherwise.
+     */
+    void decodeXY(const unsigned char *input, int *x, int *y, size_t count);
+
+} // End namespace gdsfp
+
+#endif //GDSXYDECODER_H_
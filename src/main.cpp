@@ -31,13 +31,30 @@
 
 #include <stdlib.h>
 
+#include <cctype>
 #include <cstdio>
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <iomanip>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "gdsBatchParser.h"
+#include "gdsDensityMap.h"
 #include "gdsFileParser.h"
+#include "gdsFileWriter.h"
+#include "gdsFlattener.h"
+#include "gdsLayerStats.h"
+#include "gdsLibrary.h"
+#include "gdsParallelParser.h"
+#include "gdsSnapshot.h"
+#include "gdsSpatialIndex.h"
+#include "gdsStructureHash.h"
+#include "gdsStructureIndex.h"
+#include "gdsValidator.h"
 
 using namespace std;
 
@@ -165,10 +182,12 @@ protected:
     virtual void onParsedMag(double mag) {
         cout << "Mag: " << mag << endl;
     };
-    virtual void onParsedBeginExtension(unsigned short bext) {
+    virtual void onParsedBeginExtension(unsigned short bext) {};
+    virtual void onParsedEndExtension(unsigned short eext) {};
+    virtual void onParsedBeginExtension32(int bext) {
         cout << "Begin Extension: " << bext << endl;
     };
-    virtual void onParsedEndExtension(unsigned short eext) {
+    virtual void onParsedEndExtension32(int eext) {
         cout << "End Extension: " << eext << endl;
     };
     virtual void onParsedPropertyNumber(unsigned short propNum) {
@@ -182,6 +201,717 @@ protected:
     };
 };
 
+// Decodes everything and prints nothing, for --stats.
+class QuietParser : public gdsfp::gdsFileParser
+{
+protected:
+    virtual void onParsedGDSVersion(unsigned short version) {};
+    virtual void onParsedModTime(short year, short month, short day,
+                                 short hour, short minute, short sec) {};
+    virtual void onParsedAccessTime(short year, short month, short day,
+                                    short hour, short minute, short sec) {};
+    virtual void onParsedLibName(const char *libName) {};
+    virtual void onParsedUnits(double userUnits, double dbUnits) {};
+    virtual void onParsedStrName(const char *strName) {};
+    virtual void onParsedBoundaryStart() {};
+    virtual void onParsedPathStart() {};
+    virtual void onParsedBoxStart() {};
+    virtual void onParsedEndElement() {};
+    virtual void onParsedEndStructure() {};
+    virtual void onParsedEndLib() {};
+    virtual void onParsedColumnsRows(unsigned short columns,
+                                     unsigned short rows) {};
+    virtual void onParsedPathType(unsigned short pathType) {};
+    virtual void onParsedStrans(short strans) {};
+    virtual void onParsedPresentation(short font, short valign,
+                                      short halign) {};
+    virtual void onParsedNodeStart() {};
+    virtual void onParsedTextStart() {};
+    virtual void onParsedSrefStart() {};
+    virtual void onParsedArefStart() {};
+    virtual void onParsedSname(const char *sname) {};
+    virtual void onParsedString(const char *str) {};
+    virtual void onParsedPropValue(const char *propValue) {};
+    virtual void onParsedXY(int count, int x[], int y[]) {};
+    virtual void onParsedLayer(unsigned short layer) {};
+    virtual void onParsedWidth(int width) {};
+    virtual void onParsedDataType(unsigned short dataType) {};
+    virtual void onParsedTextType(unsigned short textType) {};
+    virtual void onParsedAngle(double angle) {};
+    virtual void onParsedMag(double mag) {};
+    virtual void onParsedBeginExtension(unsigned short bext) {};
+    virtual void onParsedEndExtension(unsigned short eext) {};
+    virtual void onParsedPropertyNumber(unsigned short propNum) {};
+    virtual void onParsedNodeType(unsigned short nodeType) {};
+    virtual void onParsedBoxType(unsigned short boxType) {};
+};
+
+
+// Prints one line per element from the assembled element callback.
+class ElementPrinter : public QuietParser
+{
+protected:
+    virtual void onParsedElement(const gdsfp::gdsElement &element) {
+        cout << gdsfp::recordTypeName(element.type) << " " << element.layer
+             << "/" << element.dataType << ", " << element.count
+             << " points";
+
+        if(element.count>0) {
+            cout << " from (" << element.x[0] << "," << element.y[0] << ")"
+                 << " to (" << element.x[element.count - 1] << ","
+                 << element.y[element.count - 1] << ")";
+        }
+
+        if(element.nameLength>0) {
+            cout << " " << element.name;
+        }
+
+        for(unsigned int i=0; i<element.propertyCount; ++i) {
+            cout << " [" << element.properties[i].attribute << "="
+                 << element.properties[i].value << "]";
+        }
+
+        cout << endl;
+    };
+};
+
+// Counts the references to each structure by its interned name id.
+class NameCounter : public QuietParser
+{
+public:
+    std::vector<unsigned long long> references;
+    std::vector<bool> defined;
+
+protected:
+    virtual void onParsedStrNameId(unsigned int id, std::string_view name) {
+        grow(id);
+        defined[id] = true;
+    };
+    virtual void onParsedSnameId(unsigned int id, std::string_view name) {
+        grow(id);
+        ++references[id];
+    };
+
+private:
+    void grow(unsigned int id) {
+        if(id>=references.size()) {
+            references.resize(id + 1);
+            defined.resize(id + 1);
+        }
+    };
+};
+
+// Counts what one file of a batch holds.
+class FileCounter : public QuietParser
+{
+public:
+    FileCounter() : structures(0), elements(0), points(0) {};
+
+    unsigned long long structures;
+    unsigned long long elements;
+    unsigned long long points;
+
+protected:
+    virtual void onParsedStrName(const char *strName) { ++structures; };
+    virtual void onParsedEndElement() { ++elements; };
+    virtual void onParsedXY(int count, int x[], int y[]) { points += count; };
+};
+
+// Gives every file of a batch its own FileCounter and keeps its counts.
+class BatchCounter : public gdsfp::gdsBatchJob
+{
+public:
+    explicit BatchCounter(size_t files)
+        : structures(files), elements(files), points(files) {};
+
+    virtual gdsfp::gdsFileParser *createParser(unsigned int thread,
+                                               size_t file) {
+        return new FileCounter;
+    };
+    virtual void onFileParsed(unsigned int thread, size_t file,
+                              gdsfp::gdsFileParser *parser,
+                              const gdsfp::gdsBatchResult &result) {
+        FileCounter *counter = static_cast<FileCounter *>(parser);
+        structures[file] = counter->structures;
+        elements[file] = counter->elements;
+        points[file] = counter->points;
+        delete counter;
+    };
+
+    std::vector<unsigned long long> structures;
+    std::vector<unsigned long long> elements;
+    std::vector<unsigned long long> points;
+};
+
+// Parses without printing the records and prints the statistics instead.
+static int printStats(const char *filePath, const MyTestParser &options)
+{
+    QuietParser parser;
+    parser.enableStats();
+
+    if(options.hasLayerFilter()) {
+        parser.setLayerFilter(options.layerFilter());
+    }
+
+    double start = gdsfp::gdsParseStats::now();
+    int status;
+
+    if(strcmp(filePath, "-")==0) {
+        status = parser.parse(0);
+    } else {
+        status = parser.parse(filePath);
+    }
+
+    double elapsed = gdsfp::gdsParseStats::now() - start;
+    const gdsfp::gdsParseStats &stats = parser.getStats();
+    unsigned long long bytes = stats.totalBytes();
+
+    cout << "Records: " << stats.totalRecords() << ", " << bytes
+         << " bytes, " << stats.structures << " structures, longest record "
+         << stats.maxRecordLength << " bytes" << endl;
+    cout << setprecision(6) << fixed << "Time: " << elapsed << " s, decode "
+         << stats.decodeSeconds << " s, callbacks " << stats.callbackSeconds
+         << " s, " << setprecision(1) << bytes / elapsed / 1e6 << " MB/s"
+         << endl;
+
+    for(int type=0; type<256; ++type) {
+        if(stats.records[type]>0) {
+            const char *name = gdsfp::recordTypeName(type);
+            cout << "    " << left << setw(12) << (name!=NULL ? name : "?")
+                 << right << setw(12) << stats.records[type] << " records"
+                 << setw(14) << stats.bytes[type] << " bytes" << endl;
+        }
+    }
+
+    for(int type=0; type<64; ++type) {
+        if(stats.points[type]>0) {
+            cout << "    XY points in " << gdsfp::recordTypeName(type) << ": "
+                 << stats.points[type] << endl;
+        }
+    }
+
+    return status;
+}
+
+// Checks the record grammar and prints every error.
+static int validate(const char *filePath)
+{
+    gdsfp::gdsValidator validator;
+    int status = strcmp(filePath, "-")==0 ? validator.validate(0)
+                                          : validator.validate(filePath);
+    const std::vector<gdsfp::gdsValidationError> &errors = validator.errors();
+
+    for(size_t i=0; i<errors.size(); ++i) {
+        cout << "Error at offset " << errors[i].offset << ": "
+             << errors[i].message << endl;
+    }
+
+    cout << filePath << (status==0 ? " is valid" : " is not valid") << endl;
+    return status;
+}
+
+// Prints the content and hierarchy hash of every structure, one per line,
+// so that the output of two revisions can be diffed.
+static int printHashes(const char *filePath)
+{
+    gdsfp::gdsStructureHasher hasher;
+    int status = strcmp(filePath, "-")==0 ? hasher.hash(0)
+                                          : hasher.hash(filePath);
+
+    if(status!=0) {
+        cerr << "Error: something is wrong with the file." << endl;
+        return 1;
+    }
+
+    const std::vector<gdsfp::gdsStructureHash> &hashes = hasher.structures();
+
+    for(size_t i=0; i<hashes.size(); ++i) {
+        cout << hex << setfill('0') << setw(16) << hashes[i].content << " "
+             << setw(16) << hashes[i].hierarchy << dec << " "
+             << hashes[i].name << (hashes[i].cyclic ? " (cyclic)" : "")
+             << endl;
+    }
+
+    return 0;
+}
+
+static void printLayerTotals(const std::vector<gdsfp::gdsLayerTotals> &list)
+{
+    for(size_t i=0; i<list.size(); ++i) {
+        const gdsfp::gdsLayerTotals &t = list[i];
+        cout << "    " << t.layer << "/" << t.dataType << ": "
+             << t.boundaries << " boundaries, " << t.paths << " paths, "
+             << t.boxes << " boxes, " << t.nodes << " nodes, " << t.texts
+             << " texts, " << t.vertices << " vertices, area " << t.area
+             << ", path length " << t.pathLength;
+
+        if(t.left<=t.right) {
+            cout << ", box (" << t.left << "," << t.bottom << ")-("
+                 << t.right << "," << t.top << ")";
+        }
+
+        cout << endl;
+    }
+}
+
+// Prints the per layer totals of the whole library, flat and expanded
+// through the hierarchy, or of one structure with --structure.
+static int printLayerStats(const char *filePath, int threads,
+                           const char *structure)
+{
+    gdsfp::gdsLayerReport report(threads);
+
+    if(strcmp(filePath, "-")==0) {
+        gdsfp::gdsLayerStats stats;
+
+        if(stats.parse(0)!=0) {
+            return 1;
+        }
+
+        gdsfp::gdsLayerStats *const all[] = { &stats };
+        report.merge(all, 1);
+    } else if(report.collect(filePath)!=0) {
+        return 1;
+    }
+
+    if(structure!=NULL) {
+        const gdsfp::gdsStructureLayers *layers = report.find(structure);
+
+        if(layers==NULL) {
+            cerr << "Error: no structure " << structure << endl;
+            return 1;
+        }
+
+        cout << "Flat " << layers->name << endl;
+        printLayerTotals(layers->flat);
+        cout << "Hierarchy " << layers->name
+             << (layers->cyclic ? " (cyclic)" : "") << endl;
+        printLayerTotals(layers->hierarchy);
+        return 0;
+    }
+
+    cout << "Flat" << endl;
+    printLayerTotals(report.flatTotals());
+    cout << "Hierarchy" << endl;
+    printLayerTotals(report.hierarchyTotals());
+    return 0;
+}
+
+// Parses with element assembly, in batches of the given size.
+static int printElements(const char *filePath, int batch,
+                         const MyTestParser &options)
+{
+    ElementPrinter printer;
+    printer.enableElements(batch);
+
+    if(options.hasLayerFilter()) {
+        printer.setLayerFilter(options.layerFilter());
+    }
+
+    return strcmp(filePath, "-")==0 ? printer.parse(0)
+                                    : printer.parse(filePath);
+}
+
+// Parses many files at once and prints what each holds and the throughput.
+static int parseBatch(const std::vector<std::string> &files, int threads)
+{
+    gdsfp::gdsBatchParser batch(threads);
+    BatchCounter counter(files.size());
+    double start = gdsfp::gdsParseStats::now();
+    int status = batch.parse(files, &counter);
+    double elapsed = gdsfp::gdsParseStats::now() - start;
+    const std::vector<gdsfp::gdsBatchResult> &results = batch.results();
+    unsigned long long bytes = 0;
+    size_t failures = 0;
+
+    for(size_t i=0; i<files.size(); ++i) {
+        const gdsfp::gdsBatchResult &result = results[i];
+        cout << files[i] << ": ";
+
+        if(result.status!=0) {
+            cout << "failed" << endl;
+            ++failures;
+            continue;
+        }
+
+        cout << result.bytes << " bytes, " << counter.structures[i]
+             << " structures, " << counter.elements[i] << " elements, "
+             << counter.points[i] << " points, " << setprecision(3) << fixed
+             << result.seconds * 1e3 << " ms" << endl;
+        bytes += result.bytes;
+    }
+
+    cout << files.size() << " files, " << failures << " failed, " << bytes
+         << " bytes in " << setprecision(6) << elapsed << " s on "
+         << batch.threadCount() << " threads, " << setprecision(1)
+         << bytes / elapsed / 1e6 << " MB/s, " << files.size() / elapsed
+         << " files/s" << endl;
+    return status;
+}
+
+// Replays the snapshot next to the file, which is made on first use.
+static int replaySnapshot(const char *filePath, int threads,
+                          MyTestParser *parser)
+{
+    gdsfp::gdsSnapshot snapshot;
+
+    if(snapshot.open(filePath, threads>0 ? threads : 1)!=0) {
+        cerr << "Error: cannot load or make the snapshot of " << filePath
+             << endl;
+        return 1;
+    }
+
+    return snapshot.replay(parser);
+}
+
+// Prints every structure name with its id and how often it is referenced.
+static int printNames(const char *filePath, int threads)
+{
+    NameCounter counter;
+    counter.enableNameIds();
+    int status;
+
+    if(threads>0) {
+        gdsfp::gdsParallelParser parallel(threads);
+        status = parallel.parseOrdered(filePath, &counter);
+    } else {
+        status = strcmp(filePath, "-")==0 ? counter.parse(0)
+                                          : counter.parse(filePath);
+    }
+
+    const gdsfp::gdsNameTable &names = counter.nameTable();
+
+    for(unsigned int id=0; id<names.size(); ++id) {
+        cout << id << " " << names.name(id) << ": " << counter.references[id]
+             << " references" << (counter.defined[id] ? "" : ", undefined")
+             << endl;
+    }
+
+    return status;
+}
+
+// Loads the file into a gdsLibrary and prints what it holds.
+static int printLibrary(const char *filePath, int threads,
+                        const MyTestParser &options)
+{
+    gdsfp::gdsLibrary library;
+    gdsfp::gdsLibraryBuilder builder(&library);
+    int status;
+
+    if(options.hasLayerFilter()) {
+        builder.setLayerFilter(options.layerFilter());
+    }
+
+    if(threads>0) {
+        gdsfp::gdsParallelParser parallel(threads);
+        status = parallel.parseOrdered(filePath, &builder);
+    } else {
+        status = builder.parse(filePath);
+    }
+
+    if(status!=0) {
+        return status;
+    }
+
+    const gdsfp::gdsArray<gdsfp::gdsStructure> &structures =
+        library.structures();
+    cout << "Library " << library.name() << ", " << structures.length()
+         << " structures, " << library.layers().size() << " layers, "
+         << library.memoryUsage() << " bytes" << endl;
+
+    for(uint32_t i=0; i<structures.length(); ++i) {
+        const gdsfp::gdsStructure &structure = structures[i];
+        cout << "Structure " << library.string(structure.name) << ": "
+             << structure.textCount << " texts, "
+             << structure.referenceCount << " references" << endl;
+
+        for(uint32_t r=0; r<structure.rangeCount; ++r) {
+            const gdsfp::gdsLayerRange &range =
+                library.ranges()[structure.firstRange + r];
+            const gdsfp::gdsLayer &layer = library.layers()[range.layer];
+            uint32_t points = 0;
+
+            for(uint32_t s=0; s<range.shapeCount; ++s) {
+                points += layer.shapes[range.firstShape + s].pointCount;
+            }
+
+            cout << "    Layer " << layer.number << ": " << range.shapeCount
+                 << " shapes, " << points << " points" << endl;
+        }
+    }
+
+    return 0;
+}
+
+// Writes the file back out, either record by record or, with --library,
+// from the in-memory model with one serializer per thread.
+static int rewrite(const char *filePath, const char *outPath, bool library,
+                   int threads, const MyTestParser &options)
+{
+    gdsfp::gdsFileWriter writer;
+
+    if(writer.open(outPath)!=0) {
+        cerr << "Error: cannot create " << outPath << endl;
+        return 1;
+    }
+
+    int status;
+
+    if(library) {
+        gdsfp::gdsLibrary model;
+        status = model.load(filePath, threads>0 ? threads : 1);
+
+        if(status==0) {
+            status = writer.writeLibrary(model, threads>0 ? threads : 1);
+        }
+    } else {
+        gdsfp::gdsFileRewriter rewriter(&writer);
+
+        if(options.hasLayerFilter()) {
+            rewriter.setLayerFilter(options.layerFilter());
+        }
+
+        status = rewriter.parse(filePath);
+    }
+
+    if(writer.close()!=0) {
+        cerr << "Error: cannot write " << outPath << endl;
+        return 1;
+    }
+
+    return status;
+}
+
+// Counts flattened shapes per layer, with one set of counters per thread.
+class FlatCounter : public gdsfp::gdsFlatSink
+{
+public:
+    FlatCounter(unsigned int threads)
+        : shapes(threads, std::vector<unsigned long long>(65536)),
+          points(threads, std::vector<unsigned long long>(65536)) {};
+
+    void onFlatShape(unsigned int thread, const gdsfp::gdsFlatShape &shape)
+    {
+        ++shapes[thread][shape.layer];
+        points[thread][shape.layer] += shape.count;
+    };
+
+    std::vector<std::vector<unsigned long long> > shapes;
+    std::vector<std::vector<unsigned long long> > points;
+};
+
+// Flattens one structure, or every top structure for an empty name.
+static int printFlat(const char *filePath, const char *strName, int threads)
+{
+    gdsfp::gdsLibrary library;
+
+    if(library.load(filePath)!=0) {
+        return 1;
+    }
+
+    gdsfp::gdsFlattener flattener(library, threads);
+    std::vector<uint32_t> tops;
+
+    if(strName[0]=='\0') {
+        flattener.topStructures(&tops);
+    } else {
+        tops.push_back(library.findStructure(strName));
+
+        if(tops[0]==gdsfp::GDS_NONE) {
+            cerr << "Error: structure " << strName
+                 << " is not in the library." << endl;
+            return 1;
+        }
+    }
+
+    for(size_t t=0; t<tops.size(); ++t) {
+        FlatCounter counter(flattener.threadCount());
+
+        if(flattener.flatten(tops[t], &counter)!=0) {
+            return 1;
+        }
+
+        cout << "Flat " << library.string(library.structures()[tops[t]].name)
+             << endl;
+
+        for(unsigned int layer=0; layer<65536; ++layer) {
+            unsigned long long shapes = 0, points = 0;
+
+            for(size_t i=0; i<counter.shapes.size(); ++i) {
+                shapes += counter.shapes[i][layer];
+                points += counter.points[i][layer];
+            }
+
+            if(shapes>0) {
+                cout << "    Layer " << layer << ": " << shapes
+                     << " shapes, " << points << " points" << endl;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// The output of one of several top structures: the structure name goes
+// before the extension, with anything but letters, digits, '-' and '_'
+// replaced, so that the name can not leave the directory of the output.
+static std::string densityPath(const char *output, const char *name)
+{
+    std::string path = output;
+    size_t start = path.rfind('/')==std::string::npos ? 0
+                                                      : path.rfind('/') + 1;
+    size_t dot = path.rfind('.');
+
+    // No extension, or a leading dot of a hidden file.
+    if(dot==std::string::npos || dot<=start) {
+        dot = path.size();
+    }
+
+    std::string safe = name;
+
+    for(size_t i=0; i<safe.size(); ++i) {
+        if(!isalnum((unsigned char)safe[i]) && safe[i]!='-' &&
+           safe[i]!='_') {
+            safe[i] = '_';
+        }
+    }
+
+    return path.substr(0, dot) + "." + safe + path.substr(dot);
+}
+
+// Computes the density grid of a structure, or of each top structure, and
+// writes it as CSV, or as binary unless the output name ends in .csv.
+static int printDensity(const char *filePath, double microns,
+                        const char *strName, const char *output, int threads,
+                        const MyTestParser &options)
+{
+    gdsfp::gdsLibrary library;
+    gdsfp::gdsLibraryBuilder builder(&library);
+
+    if(options.hasLayerFilter()) {
+        builder.setLayerFilter(options.layerFilter());
+    }
+
+    if(builder.parse(filePath)!=0) {
+        return 1;
+    }
+
+    std::vector<uint32_t> tops;
+
+    if(strName==NULL) {
+        gdsfp::gdsFlattener(library, 1).topStructures(&tops);
+    } else {
+        tops.push_back(library.findStructure(strName));
+
+        if(tops[0]==gdsfp::GDS_NONE) {
+            cerr << "Error: structure " << strName
+                 << " is not in the library." << endl;
+            return 1;
+        }
+    }
+
+    gdsfp::gdsDensityMap density(library, threads);
+    density.setTileSize(microns);
+
+    for(size_t t=0; t<tops.size(); ++t) {
+        if(density.compute(tops[t])!=0) {
+            return 1;
+        }
+
+        const char *name = library.string(library.structures()[tops[t]].name);
+        cerr << "Density " << name << ": " << density.columns() << " x "
+             << density.rows() << " tiles, " << density.layers().size()
+             << " layers" << endl;
+
+        std::string path = output!=NULL ? output : "/dev/stdout";
+        bool csv = output==NULL || (path.size()>4 &&
+                   path.compare(path.size() - 4, 4, ".csv")==0);
+
+        // Several top structures get a file each.
+        if(output!=NULL && tops.size()>1) {
+            path = densityPath(output, name);
+        }
+
+        int status = csv ? density.writeCsv(path.c_str())
+                         : density.writeBinary(path.c_str());
+
+        if(status!=0) {
+            cerr << "Error: cannot write " << path << endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+class WindowPrinter : public gdsfp::gdsWindowSink
+{
+public:
+    WindowPrinter(const gdsfp::gdsLibrary &library) : library(library) {};
+
+    void onWindowShape(const gdsfp::gdsWindowHit &hit)
+    {
+        cout << "    " << library.string(
+                    library.structures()[hit.structure].name)
+             << " layer " << hit.layer->number << ", "
+             << hit.shape->pointCount << " points at ("
+             << hit.transform.tx << "," << hit.transform.ty << ")" << endl;
+    };
+
+    const gdsfp::gdsLibrary &library;
+};
+
+// Lists the shapes of every top structure that overlap a window.
+static int printWindow(const char *filePath, const char *spec)
+{
+    gdsfp::gdsBox window;
+
+    if(sscanf(spec, "%d,%d,%d,%d", &window.left, &window.bottom,
+              &window.right, &window.top)!=4) {
+        cerr << "Error: bad window " << spec << endl;
+        return 1;
+    }
+
+    gdsfp::gdsLibrary library;
+
+    if(library.load(filePath)!=0) {
+        return 1;
+    }
+
+    gdsfp::gdsSpatialIndex index(library);
+    index.build();
+
+    gdsfp::gdsFlattener flattener(library, 1);
+    std::vector<uint32_t> tops;
+    flattener.topStructures(&tops);
+    WindowPrinter printer(library);
+
+    for(size_t t=0; t<tops.size(); ++t) {
+        cout << "Window " << library.string(
+                    library.structures()[tops[t]].name) << endl;
+        index.query(tops[t], window, &printer);
+    }
+
+    return 0;
+}
+
+// Options that are followed by a value.
+static bool takesValue(const char *option)
+{
+    static const char *const options[] = {
+        "--structure", "--window", "--rewrite", "--elements", "--flatten",
+        "--threads", "--chunk", "--density", "--density-out", "--read-ahead",
+        "--list", "--layers"
+    };
+
+    for(size_t i=0; i<sizeof(options) / sizeof(options[0]); ++i) {
+        if(strcmp(option, options[i])==0) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
 // ****************************************************************************
 // main()
@@ -192,11 +922,246 @@ int main(int argc, char *argv[])
 {
     if(argc<2) {
         cerr << "Missing GDSII file as the only parameter." << endl;
-        cerr << "Usage: ./testParser /path/to/file.gds" << endl;
+        cerr << "Usage: ./testParser /path/to/file.gds [--structure NAME]"
+             " [--threads N] [--layers SPEC] [--chunk BYTES] [--index]"
+                " [--library] [--flatten NAME|--top]"
+                " [--window LEFT,BOTTOM,RIGHT,TOP] [--rewrite OUT] [--stats]"
+                " [--validate] [--elements BATCH] [--names]"
+                " [--read-ahead MB] [--direct] [--snapshot] [--hash]"
+                " [--layer-stats] [--density MICRONS [--density-out FILE]]"
+             << endl;
+        cerr << "       ./testParser file.gds... [--batch] [--list FILE]"
+                " [--threads N]"
+             << endl;
+        cerr << "A path of - reads the GDSII stream from stdin." << endl;
         return 1;
     }
 
     MyTestParser parser;
-    return parser.parse(argv[1]);
-}
+    const char *structure = NULL;
+    int threads = 0;
+    int chunk = 0;
+    bool library = false;
+    const char *flatten = NULL;
+    const char *window = NULL;
+    const char *output = NULL;
+    bool stats = false;
+    bool check = false;
+    bool names = false;
+    int readAhead = 0;
+    bool direct = false;
+    bool snapshot = false;
+    bool hashes = false;
+    bool layerStats = false;
+    bool keepIndex = false;
+    double densityTile = 0.0;
+    const char *densityOutput = NULL;
+    int batch = 0;
+    std::vector<std::string> files;
+    bool many = false;
+    const char *singleOption = NULL;    // One that needs a single file.
+
+    for(int i=1; i<argc; ++i) {
+        if(strncmp(argv[i], "--", 2)==0 && singleOption==NULL &&
+           strcmp(argv[i], "--threads")!=0 && strcmp(argv[i], "--batch")!=0 &&
+           strcmp(argv[i], "--list")!=0) {
+            singleOption = argv[i];
+        }
+
+        if(takesValue(argv[i]) && i + 1==argc) {
+            cerr << "Error: " << argv[i] << " needs a value." << endl;
+            return 1;
+        }
+
+        if(strcmp(argv[i], "--library")==0) {
+            library = true;
+        } else if(strcmp(argv[i], "--validate")==0) {
+            check = true;
+        } else if(strcmp(argv[i], "--stats")==0) {
+            stats = true;
+        } else if(strcmp(argv[i], "--names")==0) {
+            names = true;
+        } else if(strcmp(argv[i], "--direct")==0) {
+            direct = true;
+        } else if(strcmp(argv[i], "--snapshot")==0) {
+            snapshot = true;
+        } else if(strcmp(argv[i], "--hash")==0) {
+            hashes = true;
+        } else if(strcmp(argv[i], "--layer-stats")==0) {
+            layerStats = true;
+        } else if(strcmp(argv[i], "--index")==0) {
+            keepIndex = true;
+        } else if(strcmp(argv[i], "--top")==0) {
+            flatten = "";
+        } else if(strcmp(argv[i], "--batch")==0) {
+            many = true;
+        } else if(strncmp(argv[i], "--", 2)!=0) {
+            files.push_back(argv[i]);
+        } else if(strcmp(argv[i], "--structure")==0) {
+            structure = argv[++i];
+        } else if(strcmp(argv[i], "--window")==0) {
+            window = argv[++i];
+        } else if(strcmp(argv[i], "--rewrite")==0) {
+            output = argv[++i];
+        } else if(strcmp(argv[i], "--elements")==0) {
+            batch = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--flatten")==0) {
+            flatten = argv[++i];
+        } else if(strcmp(argv[i], "--threads")==0) {
+            threads = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--chunk")==0) {
+            chunk = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--density")==0) {
+            densityTile = atof(argv[++i]);
+        } else if(strcmp(argv[i], "--density-out")==0) {
+            densityOutput = argv[++i];
+        } else if(strcmp(argv[i], "--read-ahead")==0) {
+            readAhead = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--list")==0) {
+            many = true;
+
+            if(gdsfp::gdsBatchParser::readList(argv[++i], &files)!=0) {
+                cerr << "Error: cannot read the file list " << argv[i]
+                     << endl;
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--layers")==0) {
+            gdsfp::gdsLayerFilter filter;
+
+            if(filter.parse(argv[++i])!=0) {
+                cerr << "Error: bad layer filter " << argv[i] << endl;
+                return 1;
+            }
+
+            parser.setLayerFilter(filter);
+        } else {
+            cerr << "Error: unknown option " << argv[i] << endl;
+            return 1;
+        }
+    }
+
+    if(many || files.size()>1) {
+        if(singleOption!=NULL) {
+            cerr << "Error: " << singleOption << " works on a single file,"
+                    " not on a batch." << endl;
+            return 1;
+        }
+
+        return parseBatch(files, threads);
+    }
+
+    if(files.empty()) {
+        cerr << "Error: missing GDSII file." << endl;
+        return 1;
+    }
+
+    const char *filePath = files[0].c_str();
+
+    // Later runs with --threads or --structure reuse the sidecar index.
+    if(keepIndex && gdsfp::gdsStructureIndex().open(filePath, true)!=0) {
+        cerr << "Error: cannot index " << filePath << endl;
+        return 1;
+    }
+
+    if(check) {
+        return validate(filePath);
+    }
+
+    if(hashes) {
+        return printHashes(filePath);
+    }
+
+    if(densityTile>0.0) {
+        return printDensity(filePath, densityTile, structure, densityOutput,
+                            threads, parser);
+    }
+
+    if(layerStats) {
+        return printLayerStats(filePath, threads, structure);
+    }
+
+    if(batch>0) {
+        return printElements(filePath, batch, parser);
+    }
+
+    if(stats) {
+        return printStats(filePath, parser);
+    }
+
+    if(names) {
+        return printNames(filePath, threads);
+    }
+
+    if(snapshot) {
+        return replaySnapshot(filePath, threads, &parser);
+    }
+
+    if(output!=NULL) {
+        return rewrite(filePath, output, library, threads, parser);
+    }
+
+    if(library) {
+        return printLibrary(filePath, threads, parser);
+    }
+
+    if(window!=NULL) {
+        return printWindow(filePath, window);
+    }
+
+    if(flatten!=NULL) {
+        return printFlat(filePath, flatten, threads);
+    }
+
+    if(structure!=NULL) {
+        return parser.parseStructure(filePath, structure);
+    }
+
+    if(threads>0) {
+        gdsfp::gdsParallelParser parallel(threads);
+        return parallel.parseOrdered(filePath, &parser);
+    }
 
+    bool useStdin = strcmp(filePath, "-")==0;
+
+    if(chunk>0) {
+        // Push the file through feed() in pieces of the given size.
+        int fd = useStdin ? 0 : open(filePath, O_RDONLY);
+
+        if(fd<0) {
+            cerr << "Error: something is wrong with the file." << endl;
+            return 1;
+        }
+
+        std::vector<char> buffer(chunk);
+        ssize_t got;
+        int status = 0;
+
+        while((got = read(fd, &buffer[0], chunk))>0) {
+            status |= parser.feed(&buffer[0], got);
+        }
+
+        status |= parser.finish();
+
+        if(!useStdin) {
+            close(fd);
+        }
+
+        return got<0 ? 1 : status;
+    }
+
+    if(useStdin) {
+        return parser.parse(0);
+    }
+
+    if(readAhead>0 || direct) {
+        size_t block = gdsfp::gdsReadAhead::DEFAULT_BLOCK_SIZE;
+
+        if(readAhead>0) {
+            block = (size_t)readAhead<<20;
+        }
+
+        parser.enableReadAhead(block, direct);
+    }
+
+    return parser.parse(filePath);
+}